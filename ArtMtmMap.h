@@ -0,0 +1,981 @@
+#ifndef ARTMTMMAP_H_
+#define ARTMTMMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "Exceptions.h"
+#include "MtmMap.h"
+
+#define artMapTemplate <KeyType, ValueType>
+
+namespace mtm {
+/**
+ * The bytes of a key of an ArtMtmMap, ordered as memcmp orders them: the
+ * order of the keys under std::less.
+ * Integers are written in big endian, with the sign bit of signed ones
+ * flipped so that negative numbers come first. A std::string is its own
+ * bytes (std::string compares as unsigned chars).
+ */
+struct ArtKeyBytes {
+	const unsigned char* _data;
+	size_t _size;
+	unsigned char _buffer[16];
+	ArtKeyBytes() : _data(NULL), _size(0) {}
+	ArtKeyBytes(const ArtKeyBytes& bytes) = delete;
+	ArtKeyBytes& operator=(const ArtKeyBytes& bytes) = delete;
+};
+
+/**
+ * Tells if a key type can be stored by an ArtMtmMap, and writes its bytes.
+ */
+template<class KeyType, class Enable = void>
+struct ArtKey {
+	static const bool supported = false;
+};
+
+template<class KeyType>
+struct ArtKey<KeyType, typename std::enable_if<std::is_integral<KeyType>::value>::type> {
+	static const bool supported = true;
+	static void encode(const KeyType& key, ArtKeyBytes& bytes) {
+		typedef typename std::make_unsigned<KeyType>::type Unsigned;
+		Unsigned value = (Unsigned)key;
+		if(std::is_signed<KeyType>::value) {
+			value ^= (Unsigned)((Unsigned)1 << (sizeof(KeyType) * 8 - 1));
+		}
+		for(size_t i = sizeof(KeyType); i > 0; i--) {
+			bytes._buffer[i - 1] = (unsigned char)(value & 0xff);
+			value = (Unsigned)(value >> 4 >> 4);
+		}
+		bytes._data = bytes._buffer;
+		bytes._size = sizeof(KeyType);
+	}
+};
+
+template<>
+struct ArtKey<std::string> {
+	static const bool supported = true;
+	static void encode(const std::string& key, ArtKeyBytes& bytes) {
+		bytes._data = reinterpret_cast<const unsigned char*>(key.data());
+		bytes._size = key.size();
+	}
+};
+
+/**
+ * An MtmMap stored in an adaptive radix tree, for integral and std::string
+ * keys: a search follows the bytes of the key, one tree level per byte, so
+ * it costs O(key length) whatever the size of the map, without comparing
+ * keys on the way. Paths that don't branch are compressed into a prefix of
+ * their node, and each node grows from 4 children to 16, 48 and 256 as it
+ * fills up (the 16 keys of a Node16 are compared at once with SSE2).
+ *
+ * The elements are also chained in key order, so iteration and range scans
+ * from lower_bound walk that chain, and the order is the one of std::less.
+ * The API is the one of MtmMap, with size() in O(1); the map is selected
+ * for the key types that allow it by OrderedMtmMap.
+ */
+template<class KeyType, class ValueType>
+class ArtMtmMap {
+	static_assert(ArtKey<KeyType>::supported,
+			"ArtMtmMap takes integral or std::string keys");
+public:
+	class iterator;
+	/**
+	 * Couples together a pair of key and value which may be of different types.
+	 */
+	class Pair {
+	public:
+		Pair(const KeyType& key, const ValueType& value) :
+				first(key), second(value) {
+		}
+		Pair(const Pair& pair) :
+				first(pair.first), second(pair.second) {
+		}
+		const KeyType first;
+		ValueType second;
+	};
+private:
+	enum NodeType {
+		LEAF, NODE4, NODE16, NODE48, NODE256
+	};
+	struct NodeBase {
+		uint8_t _type;
+		explicit NodeBase(uint8_t type) : _type(type) {}
+	};
+	struct Leaf : NodeBase {
+		Pair _pair;
+		Leaf* _previous;
+		Leaf* _next;
+		explicit Leaf(const Pair& pair)
+		: NodeBase(LEAF), _pair(pair), _previous(NULL), _next(NULL) {}
+	};
+	struct Inner : NodeBase {
+		uint16_t _count;
+		// the bytes every key below shares after the byte leading here
+		std::string _prefix;
+		// the element whose key ends at this node, for keys of any length
+		Leaf* _value;
+		explicit Inner(uint8_t type) : NodeBase(type), _count(0), _value(NULL) {}
+	};
+	struct Node4 : Inner {
+		unsigned char _keys[4];
+		NodeBase* _children[4];
+		Node4() : Inner(NODE4) {}
+	};
+	struct Node16 : Inner {
+		unsigned char _keys[16];
+		NodeBase* _children[16];
+		Node16() : Inner(NODE16) {
+			std::memset(_keys, 0, sizeof(_keys));
+		}
+	};
+	struct Node48 : Inner {
+		// 0 for no child, else the slot of the child plus 1
+		unsigned char _index[256];
+		NodeBase* _children[48];
+		Node48() : Inner(NODE48) {
+			std::memset(_index, 0, sizeof(_index));
+		}
+	};
+	struct Node256 : Inner {
+		NodeBase* _children[256];
+		Node256() : Inner(NODE256) {
+			std::memset(_children, 0, sizeof(_children));
+		}
+	};
+
+	NodeBase* _root;
+	Leaf* _first;
+	Leaf* _last;
+	unsigned int _size;
+	ValueType _defaultValue;
+
+	static void keyOf(const Leaf* leaf, ArtKeyBytes& bytes) {
+		ArtKey<KeyType>::encode(leaf->_pair.first, bytes);
+	}
+	static bool sameKey(const ArtKeyBytes& a, const ArtKeyBytes& b) {
+		return a._size == b._size && std::memcmp(a._data, b._data, a._size) == 0;
+	}
+	static NodeBase** findChild(Inner* node, unsigned char byte);
+	static NodeBase* firstChildAfter(const Inner* node, int byte);
+	static Leaf* minimum(NodeBase* node);
+	static void addChild(NodeBase*& reference, Inner* node, unsigned char byte,
+			NodeBase* child);
+	static void removeChild(NodeBase*& reference, Inner* node, unsigned char byte);
+	static void shrink(NodeBase*& reference, Inner* node);
+	template<class Big, class Small>
+	static Big* copyHeader(Small* node);
+	static void destroy(NodeBase* node);
+
+	Leaf* findLeaf(const KeyType& key) const;
+	Leaf* lowerBoundLeaf(NodeBase* node, const ArtKeyBytes& key, size_t depth) const;
+	void insertLeaf(NodeBase*& reference, Leaf* leaf, const ArtKeyBytes& key, size_t depth);
+	Leaf* removeLeaf(NodeBase*& reference, const ArtKeyBytes& key, size_t depth);
+	void link(Leaf* leaf, Leaf* successor);
+public:
+	/**
+	 * Map Constructor.
+	 * creates an empty map giving @defaultValue to the keys it doesn't hold.
+	 */
+	explicit ArtMtmMap(const ValueType& defaultValue)
+	: _root(NULL), _first(NULL), _last(NULL), _size(0), _defaultValue(defaultValue) {}
+	ArtMtmMap(const ArtMtmMap& map);
+	~ArtMtmMap() {
+		clear();
+	}
+	ArtMtmMap& operator=(const ArtMtmMap& map);
+	/**
+	 * De-allocates all the elements that were inserted to the map.
+	 */
+	void clear() {
+		destroy(_root);
+		_root = NULL;
+		_first = NULL;
+		_last = NULL;
+		_size = 0;
+	}
+	/**
+	 * Inserts the given pair into the map, in O(key length).
+	 * IF given key already exists in the map, replaces the old value of
+	 * the element with the new given value.
+	 */
+	void insert(const Pair& pair);
+	void insert(const KeyType& key, const ValueType& value) {
+		insert(Pair(key, value));
+	}
+	/**
+	 * Removes an element from the map.
+	 * if the given key does not match any element's key in the map -
+	 * throws MapElementNotFoundException.
+	 */
+	void remove(const KeyType& key);
+	/**
+	 * Returns an iterator to the element with the requested key, or end()
+	 * if no such element was found.
+	 */
+	iterator find(const KeyType& key) const {
+		return iterator(this, findLeaf(key));
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not smaller than
+	 * the given key, or end() if there is none.
+	 */
+	iterator lower_bound(const KeyType& key) const {
+		ArtKeyBytes bytes;
+		ArtKey<KeyType>::encode(key, bytes);
+		return iterator(this, lowerBoundLeaf(_root, bytes, 0));
+	}
+	iterator begin() const {
+		return iterator(this, _first);
+	}
+	iterator end() const {
+		return iterator(this, NULL);
+	}
+	bool containsKey(const KeyType& key) const {
+		return findLeaf(key) != NULL;
+	}
+	unsigned int size() const {
+		return _size;
+	}
+	/**
+	 * Returns a reference to the value of the element according to the key,
+	 * inserting it with the default value if it is not in the map.
+	 */
+	ValueType& operator[](const KeyType& key);
+	/**
+	 * Returns a const reference to the value of the element according to the
+	 * key, or to the default value if it is not in the map (for const maps).
+	 */
+	const ValueType& operator[](const KeyType& key) const {
+		Leaf* leaf = findLeaf(key);
+		return leaf ? leaf->_pair.second : _defaultValue;
+	}
+	const ValueType& defaultValue() const {
+		return _defaultValue;
+	}
+};
+
+/**
+ * ArtMtmMap for the key types it takes, MtmMap for the others.
+ */
+template<class KeyType, class ValueType>
+using OrderedMtmMap = typename std::conditional<ArtKey<KeyType>::supported,
+		ArtMtmMap<KeyType, ValueType>, MtmMap<KeyType, ValueType> >::type;
+
+template<class KeyType, class ValueType>
+class ArtMtmMap artMapTemplate::iterator {
+	const ArtMtmMap* _map;
+	Leaf* _current;
+	friend class ArtMtmMap;
+public:
+	explicit iterator(const ArtMtmMap* map = NULL, Leaf* current = NULL)
+	: _map(map), _current(current) {}
+	iterator& operator++() {
+		if(_current) {
+			_current = _current->_next;
+		}
+		return *this;
+	}
+	iterator operator++(int) {
+		iterator tmp_iter = *this;
+		++(*this);
+		return tmp_iter;
+	}
+	/**
+	 * throws MapElementNotFoundException if iterator is pointing to the
+	 * end of the container.
+	 */
+	Pair& operator*() const {
+		if(!_current) {
+			throw MapElementNotFoundException();
+		}
+		return _current->_pair;
+	}
+	bool operator==(const iterator& iterator) const {
+		return (_map == iterator._map && _current == iterator._current);
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+};
+
+template<class KeyType, class ValueType>
+ArtMtmMap artMapTemplate::ArtMtmMap(const ArtMtmMap& map)
+: _root(NULL), _first(NULL), _last(NULL), _size(0), _defaultValue(map._defaultValue) {
+	for(Leaf* leaf = map._first; leaf; leaf = leaf->_next) {
+		insert(leaf->_pair);
+	}
+}
+
+template<class KeyType, class ValueType>
+ArtMtmMap artMapTemplate& ArtMtmMap artMapTemplate::operator=(const ArtMtmMap& map) {
+	if(this == &map) {
+		return *this;
+	}
+	clear();
+	for(Leaf* leaf = map._first; leaf; leaf = leaf->_next) {
+		insert(leaf->_pair);
+	}
+	_defaultValue = map._defaultValue;
+	return *this;
+}
+
+template<class KeyType, class ValueType>
+typename ArtMtmMap artMapTemplate::NodeBase** ArtMtmMap artMapTemplate::findChild(
+		Inner* node, unsigned char byte) {
+	switch(node->_type) {
+	case NODE4: {
+		Node4* node4 = static_cast<Node4*>(node);
+		for(int i = 0; i < node4->_count; i++) {
+			if(node4->_keys[i] == byte) {
+				return &node4->_children[i];
+			}
+		}
+		return NULL;
+	}
+	case NODE16: {
+		Node16* node16 = static_cast<Node16*>(node);
+#ifdef __SSE2__
+		__m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8((char)byte),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(node16->_keys)));
+		int mask = _mm_movemask_epi8(matches) & ((1 << node16->_count) - 1);
+		return mask ? &node16->_children[__builtin_ctz(mask)] : NULL;
+#else
+		for(int i = 0; i < node16->_count; i++) {
+			if(node16->_keys[i] == byte) {
+				return &node16->_children[i];
+			}
+		}
+		return NULL;
+#endif
+	}
+	case NODE48: {
+		Node48* node48 = static_cast<Node48*>(node);
+		int slot = node48->_index[byte];
+		return slot ? &node48->_children[slot - 1] : NULL;
+	}
+	default: {
+		Node256* node256 = static_cast<Node256*>(node);
+		return node256->_children[byte] ? &node256->_children[byte] : NULL;
+	}
+	}
+}
+
+/**
+ * The child of node with the smallest byte greater than byte, NULL if none
+ * (byte -1 gives the first child).
+ */
+template<class KeyType, class ValueType>
+typename ArtMtmMap artMapTemplate::NodeBase* ArtMtmMap artMapTemplate::firstChildAfter(
+		const Inner* node, int byte) {
+	switch(node->_type) {
+	case NODE4: {
+		const Node4* node4 = static_cast<const Node4*>(node);
+		for(int i = 0; i < node4->_count; i++) {
+			if(node4->_keys[i] > byte) {
+				return node4->_children[i];
+			}
+		}
+		return NULL;
+	}
+	case NODE16: {
+		const Node16* node16 = static_cast<const Node16*>(node);
+		for(int i = 0; i < node16->_count; i++) {
+			if(node16->_keys[i] > byte) {
+				return node16->_children[i];
+			}
+		}
+		return NULL;
+	}
+	case NODE48: {
+		const Node48* node48 = static_cast<const Node48*>(node);
+		for(int i = byte + 1; i < 256; i++) {
+			if(node48->_index[i]) {
+				return node48->_children[node48->_index[i] - 1];
+			}
+		}
+		return NULL;
+	}
+	default: {
+		const Node256* node256 = static_cast<const Node256*>(node);
+		for(int i = byte + 1; i < 256; i++) {
+			if(node256->_children[i]) {
+				return node256->_children[i];
+			}
+		}
+		return NULL;
+	}
+	}
+}
+
+template<class KeyType, class ValueType>
+typename ArtMtmMap artMapTemplate::Leaf* ArtMtmMap artMapTemplate::minimum(NodeBase* node) {
+	while(node && node->_type != LEAF) {
+		Inner* inner = static_cast<Inner*>(node);
+		if(inner->_value) {
+			return inner->_value;
+		}
+		node = firstChildAfter(inner, -1);
+	}
+	return static_cast<Leaf*>(node);
+}
+
+/**
+ * Copies the count, prefix and value of node into a new node of type Big,
+ * for growing or shrinking it.
+ */
+template<class KeyType, class ValueType>
+template<class Big, class Small>
+Big* ArtMtmMap artMapTemplate::copyHeader(Small* node) {
+	Big* copy = new Big();
+	copy->_count = node->_count;
+	copy->_prefix.swap(node->_prefix);
+	copy->_value = node->_value;
+	return copy;
+}
+
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::addChild(NodeBase*& reference, Inner* node,
+		unsigned char byte, NodeBase* child) {
+	switch(node->_type) {
+	case NODE4: {
+		Node4* node4 = static_cast<Node4*>(node);
+		if(node4->_count < 4) {
+			int position = 0;
+			while(position < node4->_count && node4->_keys[position] < byte) {
+				position++;
+			}
+			for(int i = node4->_count; i > position; i--) {
+				node4->_keys[i] = node4->_keys[i - 1];
+				node4->_children[i] = node4->_children[i - 1];
+			}
+			node4->_keys[position] = byte;
+			node4->_children[position] = child;
+			node4->_count++;
+			return;
+		}
+		Node16* grown = copyHeader<Node16>(node4);
+		std::memcpy(grown->_keys, node4->_keys, 4);
+		std::memcpy(grown->_children, node4->_children, 4 * sizeof(NodeBase*));
+		reference = grown;
+		delete node4;
+		addChild(reference, grown, byte, child);
+		return;
+	}
+	case NODE16: {
+		Node16* node16 = static_cast<Node16*>(node);
+		if(node16->_count < 16) {
+			int position = 0;
+			while(position < node16->_count && node16->_keys[position] < byte) {
+				position++;
+			}
+			for(int i = node16->_count; i > position; i--) {
+				node16->_keys[i] = node16->_keys[i - 1];
+				node16->_children[i] = node16->_children[i - 1];
+			}
+			node16->_keys[position] = byte;
+			node16->_children[position] = child;
+			node16->_count++;
+			return;
+		}
+		Node48* grown = copyHeader<Node48>(node16);
+		for(int i = 0; i < 16; i++) {
+			grown->_index[node16->_keys[i]] = (unsigned char)(i + 1);
+			grown->_children[i] = node16->_children[i];
+		}
+		reference = grown;
+		delete node16;
+		addChild(reference, grown, byte, child);
+		return;
+	}
+	case NODE48: {
+		Node48* node48 = static_cast<Node48*>(node);
+		if(node48->_count < 48) {
+			// the slots of removed children are reused, the slots stay dense
+			node48->_index[byte] = (unsigned char)(node48->_count + 1);
+			node48->_children[node48->_count] = child;
+			node48->_count++;
+			return;
+		}
+		Node256* grown = copyHeader<Node256>(node48);
+		for(int i = 0; i < 256; i++) {
+			if(node48->_index[i]) {
+				grown->_children[i] = node48->_children[node48->_index[i] - 1];
+			}
+		}
+		reference = grown;
+		delete node48;
+		addChild(reference, grown, byte, child);
+		return;
+	}
+	default: {
+		Node256* node256 = static_cast<Node256*>(node);
+		node256->_children[byte] = child;
+		node256->_count++;
+		return;
+	}
+	}
+}
+
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::removeChild(NodeBase*& reference, Inner* node,
+		unsigned char byte) {
+	switch(node->_type) {
+	case NODE4:
+	case NODE16: {
+		unsigned char* keys;
+		NodeBase** children;
+		if(node->_type == NODE4) {
+			keys = static_cast<Node4*>(node)->_keys;
+			children = static_cast<Node4*>(node)->_children;
+		} else {
+			keys = static_cast<Node16*>(node)->_keys;
+			children = static_cast<Node16*>(node)->_children;
+		}
+		int position = 0;
+		while(keys[position] != byte) {
+			position++;
+		}
+		for(int i = position + 1; i < node->_count; i++) {
+			keys[i - 1] = keys[i];
+			children[i - 1] = children[i];
+		}
+		node->_count--;
+		break;
+	}
+	case NODE48: {
+		Node48* node48 = static_cast<Node48*>(node);
+		int slot = node48->_index[byte] - 1;
+		int last = node48->_count - 1;
+		node48->_index[byte] = 0;
+		if(slot != last) {
+			// the last slot moves into the freed one
+			for(int i = 0; i < 256; i++) {
+				if(node48->_index[i] == last + 1) {
+					node48->_index[i] = (unsigned char)(slot + 1);
+					break;
+				}
+			}
+			node48->_children[slot] = node48->_children[last];
+		}
+		node48->_count--;
+		break;
+	}
+	default: {
+		Node256* node256 = static_cast<Node256*>(node);
+		node256->_children[byte] = NULL;
+		node256->_count--;
+		break;
+	}
+	}
+	shrink(reference, node);
+}
+
+/**
+ * Replaces node by a smaller one when it holds few children: a Node4 left
+ * with only its value becomes that leaf, and one left with a single child
+ * is merged into that child.
+ */
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::shrink(NodeBase*& reference, Inner* node) {
+	switch(node->_type) {
+	case NODE4: {
+		Node4* node4 = static_cast<Node4*>(node);
+		if(node4->_count == 0 && node4->_value) {
+			reference = node4->_value;
+			delete node4;
+		} else if(node4->_count == 0) {
+			reference = NULL;
+			delete node4;
+		} else if(node4->_count == 1 && !node4->_value) {
+			NodeBase* child = node4->_children[0];
+			if(child->_type != LEAF) {
+				Inner* inner = static_cast<Inner*>(child);
+				inner->_prefix = node4->_prefix + (char)node4->_keys[0] + inner->_prefix;
+			}
+			reference = child;
+			delete node4;
+		}
+		return;
+	}
+	case NODE16: {
+		Node16* node16 = static_cast<Node16*>(node);
+		if(node16->_count > 3) {
+			return;
+		}
+		Node4* shrunk = copyHeader<Node4>(node16);
+		std::memcpy(shrunk->_keys, node16->_keys, node16->_count);
+		std::memcpy(shrunk->_children, node16->_children, node16->_count * sizeof(NodeBase*));
+		reference = shrunk;
+		delete node16;
+		return;
+	}
+	case NODE48: {
+		Node48* node48 = static_cast<Node48*>(node);
+		if(node48->_count > 12) {
+			return;
+		}
+		Node16* shrunk = copyHeader<Node16>(node48);
+		int count = 0;
+		for(int i = 0; i < 256; i++) {
+			if(node48->_index[i]) {
+				shrunk->_keys[count] = (unsigned char)i;
+				shrunk->_children[count] = node48->_children[node48->_index[i] - 1];
+				count++;
+			}
+		}
+		reference = shrunk;
+		delete node48;
+		return;
+	}
+	default: {
+		Node256* node256 = static_cast<Node256*>(node);
+		if(node256->_count > 37) {
+			return;
+		}
+		Node48* shrunk = copyHeader<Node48>(node256);
+		int count = 0;
+		for(int i = 0; i < 256; i++) {
+			if(node256->_children[i]) {
+				shrunk->_index[i] = (unsigned char)(count + 1);
+				shrunk->_children[count] = node256->_children[i];
+				count++;
+			}
+		}
+		reference = shrunk;
+		delete node256;
+		return;
+	}
+	}
+}
+
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::destroy(NodeBase* node) {
+	if(!node) {
+		return;
+	}
+	if(node->_type == LEAF) {
+		delete static_cast<Leaf*>(node);
+		return;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	delete inner->_value;
+	switch(inner->_type) {
+	case NODE4: {
+		Node4* node4 = static_cast<Node4*>(inner);
+		for(int i = 0; i < node4->_count; i++) {
+			destroy(node4->_children[i]);
+		}
+		delete node4;
+		break;
+	}
+	case NODE16: {
+		Node16* node16 = static_cast<Node16*>(inner);
+		for(int i = 0; i < node16->_count; i++) {
+			destroy(node16->_children[i]);
+		}
+		delete node16;
+		break;
+	}
+	case NODE48: {
+		Node48* node48 = static_cast<Node48*>(inner);
+		for(int i = 0; i < node48->_count; i++) {
+			destroy(node48->_children[i]);
+		}
+		delete node48;
+		break;
+	}
+	default: {
+		Node256* node256 = static_cast<Node256*>(inner);
+		for(int i = 0; i < 256; i++) {
+			destroy(node256->_children[i]);
+		}
+		delete node256;
+		break;
+	}
+	}
+}
+
+template<class KeyType, class ValueType>
+typename ArtMtmMap artMapTemplate::Leaf* ArtMtmMap artMapTemplate::findLeaf(
+		const KeyType& key) const {
+	ArtKeyBytes bytes;
+	ArtKey<KeyType>::encode(key, bytes);
+	NodeBase* node = _root;
+	size_t depth = 0;
+	while(node) {
+		if(node->_type == LEAF) {
+			// the prefixes skipped bytes, the whole key is compared
+			Leaf* leaf = static_cast<Leaf*>(node);
+			ArtKeyBytes leafBytes;
+			keyOf(leaf, leafBytes);
+			return sameKey(leafBytes, bytes) ? leaf : NULL;
+		}
+		Inner* inner = static_cast<Inner*>(node);
+		const std::string& prefix = inner->_prefix;
+		if(bytes._size - depth < prefix.size()
+				|| std::memcmp(bytes._data + depth, prefix.data(), prefix.size()) != 0) {
+			return NULL;
+		}
+		depth += prefix.size();
+		if(depth == bytes._size) {
+			return inner->_value;
+		}
+		NodeBase** child = findChild(inner, bytes._data[depth]);
+		if(!child) {
+			return NULL;
+		}
+		node = *child;
+		depth++;
+	}
+	return NULL;
+}
+
+/**
+ * The leaf of the smallest key of node's subtree that is not smaller than
+ * key, NULL if they are all smaller. depth bytes of key led to node.
+ */
+template<class KeyType, class ValueType>
+typename ArtMtmMap artMapTemplate::Leaf* ArtMtmMap artMapTemplate::lowerBoundLeaf(
+		NodeBase* node, const ArtKeyBytes& key, size_t depth) const {
+	if(!node) {
+		return NULL;
+	}
+	if(node->_type == LEAF) {
+		Leaf* leaf = static_cast<Leaf*>(node);
+		ArtKeyBytes leafBytes;
+		keyOf(leaf, leafBytes);
+		size_t common = leafBytes._size < key._size ? leafBytes._size : key._size;
+		int order = std::memcmp(leafBytes._data, key._data, common);
+		bool notSmaller = order > 0 || (order == 0 && leafBytes._size >= key._size);
+		return notSmaller ? leaf : NULL;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	const std::string& prefix = inner->_prefix;
+	size_t remaining = key._size - depth;
+	size_t common = prefix.size() < remaining ? prefix.size() : remaining;
+	int order = std::memcmp(prefix.data(), key._data + depth, common);
+	if(order > 0 || (order == 0 && remaining <= prefix.size())) {
+		// every key below is greater, or key ends here and they extend it
+		return minimum(node);
+	}
+	if(order < 0) {
+		return NULL;
+	}
+	depth += prefix.size();
+	unsigned char byte = key._data[depth];
+	NodeBase** child = findChild(inner, byte);
+	if(child) {
+		Leaf* found = lowerBoundLeaf(*child, key, depth + 1);
+		if(found) {
+			return found;
+		}
+	}
+	NodeBase* next = firstChildAfter(inner, byte);
+	return next ? minimum(next) : NULL;
+}
+
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::insertLeaf(NodeBase*& reference, Leaf* leaf,
+		const ArtKeyBytes& key, size_t depth) {
+	NodeBase* node = reference;
+	if(!node) {
+		reference = leaf;
+		return;
+	}
+	if(node->_type == LEAF) {
+		// two keys share this path now, a node parts them where they differ
+		Leaf* other = static_cast<Leaf*>(node);
+		ArtKeyBytes otherBytes;
+		keyOf(other, otherBytes);
+		size_t common = 0;
+		while(depth + common < key._size && depth + common < otherBytes._size
+				&& key._data[depth + common] == otherBytes._data[depth + common]) {
+			common++;
+		}
+		Node4* split = new Node4();
+		split->_prefix.assign(reinterpret_cast<const char*>(key._data + depth), common);
+		depth += common;
+		NodeBase* splitReference = split;
+		if(otherBytes._size == depth) {
+			split->_value = other;
+		} else {
+			addChild(splitReference, split, otherBytes._data[depth], other);
+		}
+		if(key._size == depth) {
+			split->_value = leaf;
+		} else {
+			addChild(splitReference, split, key._data[depth], leaf);
+		}
+		reference = split;
+		return;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	const std::string& prefix = inner->_prefix;
+	size_t mismatch = 0;
+	while(mismatch < prefix.size() && depth + mismatch < key._size
+			&& (unsigned char)prefix[mismatch] == key._data[depth + mismatch]) {
+		mismatch++;
+	}
+	if(mismatch < prefix.size()) {
+		// the key leaves the compressed path, which is cut where it does
+		Node4* split = new Node4();
+		NodeBase* splitReference = split;
+		split->_prefix = prefix.substr(0, mismatch);
+		unsigned char byte = (unsigned char)prefix[mismatch];
+		inner->_prefix.erase(0, mismatch + 1);
+		addChild(splitReference, split, byte, inner);
+		if(key._size == depth + mismatch) {
+			split->_value = leaf;
+		} else {
+			addChild(splitReference, split, key._data[depth + mismatch], leaf);
+		}
+		reference = split;
+		return;
+	}
+	depth += prefix.size();
+	if(depth == key._size) {
+		inner->_value = leaf;
+		return;
+	}
+	NodeBase** child = findChild(inner, key._data[depth]);
+	if(child) {
+		insertLeaf(*child, leaf, key, depth + 1);
+	} else {
+		addChild(reference, inner, key._data[depth], leaf);
+	}
+}
+
+/**
+ * Takes the leaf of key out of node's subtree and returns it, NULL if it
+ * is not there.
+ */
+template<class KeyType, class ValueType>
+typename ArtMtmMap artMapTemplate::Leaf* ArtMtmMap artMapTemplate::removeLeaf(
+		NodeBase*& reference, const ArtKeyBytes& key, size_t depth) {
+	NodeBase* node = reference;
+	if(!node) {
+		return NULL;
+	}
+	if(node->_type == LEAF) {
+		Leaf* leaf = static_cast<Leaf*>(node);
+		ArtKeyBytes leafBytes;
+		keyOf(leaf, leafBytes);
+		if(!sameKey(leafBytes, key)) {
+			return NULL;
+		}
+		reference = NULL;
+		return leaf;
+	}
+	Inner* inner = static_cast<Inner*>(node);
+	const std::string& prefix = inner->_prefix;
+	if(key._size - depth < prefix.size()
+			|| std::memcmp(key._data + depth, prefix.data(), prefix.size()) != 0) {
+		return NULL;
+	}
+	depth += prefix.size();
+	if(depth == key._size) {
+		Leaf* leaf = inner->_value;
+		if(leaf) {
+			inner->_value = NULL;
+			shrink(reference, inner);
+		}
+		return leaf;
+	}
+	unsigned char byte = key._data[depth];
+	NodeBase** child = findChild(inner, byte);
+	if(!child) {
+		return NULL;
+	}
+	if((*child)->_type != LEAF) {
+		return removeLeaf(*child, key, depth + 1);
+	}
+	Leaf* leaf = static_cast<Leaf*>(*child);
+	ArtKeyBytes leafBytes;
+	keyOf(leaf, leafBytes);
+	if(!sameKey(leafBytes, key)) {
+		return NULL;
+	}
+	removeChild(reference, inner, byte);
+	return leaf;
+}
+
+/**
+ * Chains leaf into the elements in key order, before successor (at the end
+ * if successor is NULL).
+ */
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::link(Leaf* leaf, Leaf* successor) {
+	leaf->_next = successor;
+	leaf->_previous = successor ? successor->_previous : _last;
+	if(leaf->_previous) {
+		leaf->_previous->_next = leaf;
+	} else {
+		_first = leaf;
+	}
+	if(successor) {
+		successor->_previous = leaf;
+	} else {
+		_last = leaf;
+	}
+}
+
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::insert(const Pair& pair) {
+	Leaf* existing = findLeaf(pair.first);
+	if(existing) {
+		existing->_pair.second = pair.second;
+		return;
+	}
+	ArtKeyBytes bytes;
+	ArtKey<KeyType>::encode(pair.first, bytes);
+	Leaf* successor = lowerBoundLeaf(_root, bytes, 0);
+	Leaf* leaf = new Leaf(pair);
+	// the bytes of a std::string key point into the leaf's own copy from here
+	ArtKeyBytes leafBytes;
+	keyOf(leaf, leafBytes);
+	insertLeaf(_root, leaf, leafBytes, 0);
+	link(leaf, successor);
+	_size++;
+}
+
+template<class KeyType, class ValueType>
+void ArtMtmMap artMapTemplate::remove(const KeyType& key) {
+	ArtKeyBytes bytes;
+	ArtKey<KeyType>::encode(key, bytes);
+	Leaf* leaf = removeLeaf(_root, bytes, 0);
+	if(!leaf) {
+		throw MapElementNotFoundException();
+	}
+	if(leaf->_previous) {
+		leaf->_previous->_next = leaf->_next;
+	} else {
+		_first = leaf->_next;
+	}
+	if(leaf->_next) {
+		leaf->_next->_previous = leaf->_previous;
+	} else {
+		_last = leaf->_previous;
+	}
+	delete leaf;
+	_size--;
+}
+
+template<class KeyType, class ValueType>
+ValueType& ArtMtmMap artMapTemplate::operator[](const KeyType& key) {
+	Leaf* leaf = findLeaf(key);
+	if(!leaf) {
+		insert(key, _defaultValue);
+		leaf = findLeaf(key);
+	}
+	return leaf->_pair.second;
+}
+
+} // namespace mtm
+
+#endif /* ARTMTMMAP_H_ */
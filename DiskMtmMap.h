@@ -0,0 +1,828 @@
+#ifndef DISKMTMMAP_H_
+#define DISKMTMMAP_H_
+
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Exceptions.h"
+
+#define diskMapTemplate <KeyType, ValueType, CompareFunction, PageBytes>
+
+namespace mtm {
+/**
+ * An MtmMap whose elements are stored in the pages of a B+tree inside a
+ * local file, for key spaces that don't fit in memory.
+ * Only cachePages pages of the file are held in memory at once, in a page
+ * cache with CLOCK replacement that writes modified pages back when they are
+ * evicted, by flush() and by the destructor. A map reopened on an existing
+ * file finds the elements it held when it was last flushed.
+ * The file is consistent only after flush() or the destructor: the first
+ * page evicted after a flush marks it as not flushed, and opening a file
+ * left so (by a process that died before flushing) throws
+ * std::runtime_error rather than returning a map missing elements.
+ *
+ * Keys and values must be trivially copyable, they are stored as raw bytes.
+ * The elements live in the leaves, which are chained in increasing key
+ * order; a scan from begin() to end() walks that chain and asks the kernel
+ * to read ahead the following leaf pages, so a map built by increasing keys
+ * (whose leaves follow each other in the file) is scanned at the speed of
+ * sequential reads. Leaves that become empty by remove are left in the
+ * chain and skipped, pages are never merged.
+ *
+ * The insert/remove/find/iterate API is the one of MtmMap, except that
+ * dereferencing an iterator returns a copy of the element, and that any
+ * modification of the map invalidates its iterators.
+ * Errors of the underlying file throw std::runtime_error.
+ */
+template<class KeyType, class ValueType,
+		class CompareFunction = std::less<KeyType>, unsigned int PageBytes = 4096>
+class DiskMtmMap {
+	static_assert(std::is_trivially_copyable<KeyType>::value
+			&& std::is_trivially_copyable<ValueType>::value,
+			"only trivially copyable keys and values can be stored on disk");
+
+	struct PageHeader {
+		uint32_t _leaf;
+		uint32_t _count;
+		// next leaf in key order, 0 at the last leaf
+		uint64_t _next;
+	};
+	struct FileHeader {
+		char _magic[8];
+		uint32_t _keySize;
+		uint32_t _valueSize;
+		uint32_t _pageBytes;
+		// set on the file while pages written since the last flush may not
+		// match its root, page count and size, always 0 in memory
+		uint32_t _unflushed;
+		uint64_t _root;
+		uint64_t _pageCount;
+		uint64_t _size;
+		ValueType _defaultValue;
+	};
+	struct alignas(64) PageBuffer {
+		unsigned char _bytes[PageBytes];
+	};
+	struct Frame {
+		uint64_t _page;
+		unsigned int _pins;
+		bool _referenced;
+		bool _dirty;
+		PageBuffer* _buffer;
+	};
+	class PageHandle;
+
+	static constexpr size_t alignUp(size_t offset, size_t alignment) {
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+	static const size_t KEYS_OFFSET = alignUp(sizeof(PageHeader), alignof(KeyType));
+	static const unsigned int LEAF_CAPACITY = (PageBytes - KEYS_OFFSET
+			- alignof(ValueType)) / (sizeof(KeyType) + sizeof(ValueType));
+	static const unsigned int INTERNAL_CAPACITY = (PageBytes - KEYS_OFFSET
+			- 2 * sizeof(uint64_t)) / (sizeof(KeyType) + sizeof(uint64_t));
+	static const size_t VALUES_OFFSET = alignUp(KEYS_OFFSET
+			+ LEAF_CAPACITY * sizeof(KeyType), alignof(ValueType));
+	static const size_t CHILDREN_OFFSET = alignUp(KEYS_OFFSET
+			+ INTERNAL_CAPACITY * sizeof(KeyType), sizeof(uint64_t));
+	static_assert(LEAF_CAPACITY >= 4 && INTERNAL_CAPACITY >= 4,
+			"PageBytes is too small for the key and value types");
+	static_assert(sizeof(FileHeader) <= PageBytes,
+			"PageBytes is too small for the file header");
+	/** Pages whose reading is hinted ahead of a scan */
+	static const unsigned int READAHEAD_PAGES = 32;
+	/** A path from the root to a leaf must fit in the cache */
+	static const unsigned int MIN_CACHE_PAGES = 16;
+
+	int _file;
+	FileHeader _header;
+	CompareFunction compare;
+	mutable Frame* _frames;
+	mutable PageBuffer* _buffers;
+	unsigned int _frameCount;
+	mutable unsigned int _clockHand;
+	mutable std::unordered_map<uint64_t, Frame*> _pageTable;
+	// the pages last hinted by readAhead
+	mutable uint64_t _readAheadStart;
+	mutable uint64_t _readAheadEnd;
+	// whether the header in the file is marked as not flushed
+	mutable bool _fileUnflushed;
+public:
+	class iterator;
+	/**
+	 * Couples together a pair of key and value which may be of different types.
+	 */
+	class Pair {
+	public:
+		Pair(const KeyType& key, const ValueType& value) :
+				first(key), second(value) {
+		}
+		Pair(const Pair& pair) :
+				first(pair.first), second(pair.second) {
+		}
+		const KeyType first;
+		ValueType second;
+	};
+	/**
+	 * Map Constructor.
+	 * opens the map stored in the file at path, or creates an empty map
+	 * there with @defaultValue if the file is empty or doesn't exist.
+	 * at most @cachePages pages (of PageBytes bytes) are held in memory.
+	 * throws std::runtime_error if the file can't be opened, holds a map of
+	 * other types, or was not flushed since pages were written to it.
+	 */
+	DiskMtmMap(const char* path, const ValueType& defaultValue,
+			unsigned int cachePages = 1024);
+	DiskMtmMap(const DiskMtmMap& map) = delete;
+	DiskMtmMap& operator=(const DiskMtmMap& map) = delete;
+	/**
+	 * Destructor.
+	 * writes the modified pages back to the file and closes it.
+	 */
+	~DiskMtmMap();
+	/**
+	 * Writes the modified pages and the header back to the file.
+	 */
+	void flush();
+	/**
+	 * Removes all the elements, truncating the file.
+	 */
+	void clear();
+	/**
+	 * Inserts the given pair into the map, in O(log n) page accesses.
+	 * IF given key already exists in the map, replaces the old value of
+	 * the element with the new given value.
+	 */
+	void insert(const Pair& pair);
+	void insert(const KeyType& key, const ValueType& value);
+	/**
+	 * Removes an element from the map.
+	 * if the given key does not match any element's key in the map -
+	 * throws MapElementNotFoundException.
+	 */
+	void remove(const KeyType& key);
+	/**
+	 * Returns an iterator to the element with the requested key, or end()
+	 * if no such element was found.
+	 */
+	iterator find(const KeyType& key) const;
+	iterator begin() const;
+	iterator end() const;
+	bool containsKey(const KeyType& key) const;
+	/**
+	 * Returns the amount of elements in the map, in O(1).
+	 */
+	unsigned int size() const {
+		return (unsigned int)_header._size;
+	}
+	/**
+	 * Returns a copy of the value of the element according to the key, or the
+	 * default value if the key is not in the map.
+	 */
+	ValueType operator[](const KeyType& key) const;
+
+private:
+	static PageHeader* headerOf(unsigned char* page) {
+		return reinterpret_cast<PageHeader*>(page);
+	}
+	static KeyType* keysOf(unsigned char* page) {
+		return reinterpret_cast<KeyType*>(page + KEYS_OFFSET);
+	}
+	static ValueType* valuesOf(unsigned char* page) {
+		return reinterpret_cast<ValueType*>(page + VALUES_OFFSET);
+	}
+	static uint64_t* childrenOf(unsigned char* page) {
+		return reinterpret_cast<uint64_t*>(page + CHILDREN_OFFSET);
+	}
+	/**
+	 * The first index whose key is not smaller than key.
+	 */
+	unsigned int lowerBound(unsigned char* page, const KeyType& key) const;
+	/**
+	 * The first index whose key is bigger than key, which is the index of
+	 * the child of an internal page to descend into.
+	 */
+	unsigned int upperBound(unsigned char* page, const KeyType& key) const;
+
+	void initialize();
+	void release();
+	void markUnflushed() const;
+	void readPage(uint64_t page, PageBuffer* buffer) const;
+	void writePage(uint64_t page, const PageBuffer* buffer) const;
+	Frame* takeFrame() const;
+	Frame* fetch(uint64_t page) const;
+	Frame* allocatePage(bool leaf);
+	void readAhead(uint64_t page) const;
+	uint64_t findLeaf(const KeyType& key) const;
+	bool insertAux(uint64_t page, const Pair& pair, KeyType* separator,
+			uint64_t* sibling);
+	void splitLeaf(unsigned char* left, Frame* right, unsigned int position,
+			const Pair& pair);
+	void splitInternal(unsigned char* left, Frame* right, unsigned int position,
+			const KeyType& separator, uint64_t sibling, KeyType* promoted);
+	static void insertIntoInternal(unsigned char* page, unsigned int position,
+			const KeyType& separator, uint64_t sibling);
+	iterator skipEmpty(uint64_t page, unsigned int index) const;
+};
+
+/**
+ * Keeps a cached page pinned, so it is not evicted while it is in use.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+class DiskMtmMap diskMapTemplate::PageHandle {
+	Frame* _frame;
+public:
+	explicit PageHandle(Frame* frame) : _frame(frame) {}
+	PageHandle(const PageHandle& handle) = delete;
+	PageHandle& operator=(const PageHandle& handle) = delete;
+	~PageHandle() {
+		_frame->_pins--;
+	}
+	unsigned char* data() const {
+		return _frame->_buffer->_bytes;
+	}
+	void markDirty() {
+		_frame->_dirty = true;
+	}
+};
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+class DiskMtmMap diskMapTemplate::iterator {
+	const DiskMtmMap* _map;
+	uint64_t _page;
+	unsigned int _index;
+	friend class DiskMtmMap;
+public:
+	explicit iterator(const DiskMtmMap* map = NULL, uint64_t page = 0,
+			unsigned int index = 0)
+	: _map(map), _page(page), _index(index) {}
+	iterator(const iterator& it) = default;
+	iterator& operator=(const iterator& it) = default;
+	/**
+	 * Promotes the iterator to the next element in increasing key order.
+	 */
+	iterator& operator++() {
+		if(*this == _map->end()) {
+			return *this;
+		}
+		uint64_t next;
+		{
+			PageHandle leaf(_map->fetch(_page));
+			if(++_index < headerOf(leaf.data())->_count) {
+				return *this;
+			}
+			next = headerOf(leaf.data())->_next;
+		}
+		*this = _map->skipEmpty(next, 0);
+		return *this;
+	}
+	iterator operator++(int) {
+		iterator tmp_iter = *this;
+		++(*this);
+		return tmp_iter;
+	}
+	/**
+	 * Returns a copy of the element pointed by the iterator.
+	 * throws MapElementNotFoundException if iterator is pointing to the
+	 * end of the container.
+	 */
+	Pair operator*() const {
+		if(*this == _map->end()) {
+			throw MapElementNotFoundException();
+		}
+		PageHandle leaf(_map->fetch(_page));
+		return Pair(keysOf(leaf.data())[_index], valuesOf(leaf.data())[_index]);
+	}
+	bool operator==(const iterator& iterator) const {
+		return (_map == iterator._map && _page == iterator._page
+				&& _index == iterator._index);
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+};
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+DiskMtmMap diskMapTemplate::DiskMtmMap(const char* path,
+		const ValueType& defaultValue, unsigned int cachePages)
+: _clockHand(0), _readAheadStart(0), _readAheadEnd(0), _fileUnflushed(false) {
+	_frameCount = cachePages < MIN_CACHE_PAGES ? MIN_CACHE_PAGES : cachePages;
+	_file = ::open(path, O_RDWR | O_CREAT, 0644);
+	if(_file < 0) {
+		throw std::runtime_error(std::string("DiskMtmMap: can't open ") + path);
+	}
+	_buffers = new PageBuffer[_frameCount];
+	_frames = new Frame[_frameCount];
+	for(unsigned int i = 0; i < _frameCount; i++) {
+		_frames[i] = Frame { 0, 0, false, false, &_buffers[i] };
+	}
+	struct stat status;
+	if(fstat(_file, &status) != 0 || status.st_size == 0) {
+		std::memset(&_header, 0, sizeof(_header));
+		_header._defaultValue = defaultValue;
+		try {
+			initialize();
+		} catch(...) {
+			// the destructor won't run
+			release();
+			throw;
+		}
+		return;
+	}
+	if(pread(_file, &_header, sizeof(_header), 0) != (ssize_t)sizeof(_header)
+			|| std::memcmp(_header._magic, "GDSBTREE", 8) != 0
+			|| _header._keySize != sizeof(KeyType)
+			|| _header._valueSize != sizeof(ValueType)
+			|| _header._pageBytes != PageBytes) {
+		release();
+		throw std::runtime_error(std::string("DiskMtmMap: not a map file ") + path);
+	}
+	if(_header._unflushed) {
+		release();
+		throw std::runtime_error(std::string("DiskMtmMap: not flushed ") + path);
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+DiskMtmMap diskMapTemplate::~DiskMtmMap() {
+	try {
+		flush();
+	} catch(const std::runtime_error&) {
+		// a destructor can't report the failure, the file keeps its last flush
+	}
+	release();
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::release() {
+	::close(_file);
+	delete[] _frames;
+	delete[] _buffers;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::initialize() {
+	std::memcpy(_header._magic, "GDSBTREE", 8);
+	_header._keySize = sizeof(KeyType);
+	_header._valueSize = sizeof(ValueType);
+	_header._pageBytes = PageBytes;
+	// page 0 holds the file header
+	_header._pageCount = 1;
+	_header._size = 0;
+	Frame* root = allocatePage(true);
+	_header._root = root->_page;
+	root->_pins--;
+	flush();
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::flush() {
+	for(unsigned int i = 0; i < _frameCount; i++) {
+		if(_frames[i]._dirty) {
+			markUnflushed();
+			writePage(_frames[i]._page, _frames[i]._buffer);
+			_frames[i]._dirty = false;
+		}
+	}
+	PageBuffer page;
+	std::memset(&page, 0, sizeof(page));
+	std::memcpy(page._bytes, &_header, sizeof(_header));
+	writePage(0, &page);
+	_fileUnflushed = false;
+}
+
+/**
+ * Marks the header in the file as not flushed, before a page is written
+ * back between two flushes.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::markUnflushed() const {
+	if(_fileUnflushed) {
+		return;
+	}
+	PageBuffer page;
+	std::memset(&page, 0, sizeof(page));
+	std::memcpy(page._bytes, &_header, sizeof(_header));
+	reinterpret_cast<FileHeader*>(page._bytes)->_unflushed = 1;
+	writePage(0, &page);
+	_fileUnflushed = true;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::clear() {
+	_pageTable.clear();
+	for(unsigned int i = 0; i < _frameCount; i++) {
+		_frames[i]._page = 0;
+		_frames[i]._dirty = false;
+		_frames[i]._referenced = false;
+	}
+	if(ftruncate(_file, 0) != 0) {
+		throw std::runtime_error("DiskMtmMap: can't truncate the file");
+	}
+	_readAheadStart = 0;
+	_readAheadEnd = 0;
+	initialize();
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::readPage(uint64_t page, PageBuffer* buffer) const {
+	size_t done = 0;
+	while(done < PageBytes) {
+		ssize_t result = pread(_file, buffer->_bytes + done, PageBytes - done,
+				(off_t)(page * PageBytes + done));
+		if(result <= 0) {
+			throw std::runtime_error("DiskMtmMap: can't read a page");
+		}
+		done += result;
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::writePage(uint64_t page,
+		const PageBuffer* buffer) const {
+	size_t done = 0;
+	while(done < PageBytes) {
+		ssize_t result = pwrite(_file, buffer->_bytes + done, PageBytes - done,
+				(off_t)(page * PageBytes + done));
+		if(result <= 0) {
+			throw std::runtime_error("DiskMtmMap: can't write a page");
+		}
+		done += result;
+	}
+}
+
+/**
+ * Picks a frame by the CLOCK algorithm: the hand sweeps the frames, giving a
+ * second chance to the referenced ones, and takes the first unpinned frame
+ * that was not referenced since the last sweep.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::Frame* DiskMtmMap diskMapTemplate::takeFrame() const {
+	for(unsigned int step = 0; step < 2 * _frameCount; step++) {
+		Frame* frame = &_frames[_clockHand];
+		_clockHand = (_clockHand + 1) % _frameCount;
+		if(frame->_pins > 0) {
+			continue;
+		}
+		if(frame->_referenced) {
+			frame->_referenced = false;
+			continue;
+		}
+		if(frame->_page != 0) {
+			if(frame->_dirty) {
+				markUnflushed();
+				writePage(frame->_page, frame->_buffer);
+				frame->_dirty = false;
+			}
+			_pageTable.erase(frame->_page);
+			frame->_page = 0;
+		}
+		return frame;
+	}
+	throw std::runtime_error("DiskMtmMap: all the cached pages are in use");
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::Frame* DiskMtmMap diskMapTemplate::fetch(
+		uint64_t page) const {
+	typename std::unordered_map<uint64_t, Frame*>::iterator found = _pageTable.find(page);
+	Frame* frame;
+	if(found != _pageTable.end()) {
+		frame = found->second;
+	} else {
+		frame = takeFrame();
+		readPage(page, frame->_buffer);
+		frame->_page = page;
+		_pageTable[page] = frame;
+	}
+	frame->_referenced = true;
+	frame->_pins++;
+	return frame;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::Frame* DiskMtmMap diskMapTemplate::allocatePage(
+		bool leaf) {
+	Frame* frame = takeFrame();
+	std::memset(frame->_buffer->_bytes, 0, PageBytes);
+	headerOf(frame->_buffer->_bytes)->_leaf = leaf;
+	frame->_page = _header._pageCount++;
+	frame->_referenced = true;
+	frame->_dirty = true;
+	frame->_pins = 1;
+	_pageTable[frame->_page] = frame;
+	return frame;
+}
+
+/**
+ * Hints the kernel to read the pages following page, once a scan gets past
+ * the pages hinted before.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::readAhead(uint64_t page) const {
+	if(_readAheadStart <= page && page + READAHEAD_PAGES / 2 < _readAheadEnd) {
+		return;
+	}
+	posix_fadvise(_file, (off_t)(page * PageBytes),
+			(off_t)READAHEAD_PAGES * PageBytes, POSIX_FADV_WILLNEED);
+	_readAheadStart = page;
+	_readAheadEnd = page + READAHEAD_PAGES;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+unsigned int DiskMtmMap diskMapTemplate::lowerBound(unsigned char* page,
+		const KeyType& key) const {
+	const KeyType* keys = keysOf(page);
+	unsigned int low = 0, high = headerOf(page)->_count;
+	while(low < high) {
+		unsigned int middle = (low + high) / 2;
+		if(compare(keys[middle], key)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+unsigned int DiskMtmMap diskMapTemplate::upperBound(unsigned char* page,
+		const KeyType& key) const {
+	const KeyType* keys = keysOf(page);
+	unsigned int low = 0, high = headerOf(page)->_count;
+	while(low < high) {
+		unsigned int middle = (low + high) / 2;
+		if(compare(key, keys[middle])) {
+			high = middle;
+		} else {
+			low = middle + 1;
+		}
+	}
+	return low;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+uint64_t DiskMtmMap diskMapTemplate::findLeaf(const KeyType& key) const {
+	uint64_t page = _header._root;
+	while(true) {
+		PageHandle node(fetch(page));
+		if(headerOf(node.data())->_leaf) {
+			return page;
+		}
+		page = childrenOf(node.data())[upperBound(node.data(), key)];
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::iterator DiskMtmMap diskMapTemplate::find(
+		const KeyType& key) const {
+	uint64_t page = findLeaf(key);
+	PageHandle leaf(fetch(page));
+	unsigned int index = lowerBound(leaf.data(), key);
+	if(index < headerOf(leaf.data())->_count
+			&& !compare(key, keysOf(leaf.data())[index])) {
+		return iterator(this, page, index);
+	}
+	return end();
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+bool DiskMtmMap diskMapTemplate::containsKey(const KeyType& key) const {
+	return find(key) != end();
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+ValueType DiskMtmMap diskMapTemplate::operator[](const KeyType& key) const {
+	iterator it = find(key);
+	if(it == end()) {
+		return _header._defaultValue;
+	}
+	return (*it).second;
+}
+
+/**
+ * Returns an iterator to the first element of the leaves chained from page,
+ * starting at index in that page, skipping the leaves left empty.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::iterator DiskMtmMap diskMapTemplate::skipEmpty(
+		uint64_t page, unsigned int index) const {
+	while(page != 0) {
+		readAhead(page);
+		PageHandle leaf(fetch(page));
+		if(index < headerOf(leaf.data())->_count) {
+			return iterator(this, page, index);
+		}
+		page = headerOf(leaf.data())->_next;
+		index = 0;
+	}
+	return end();
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::iterator DiskMtmMap diskMapTemplate::begin() const {
+	uint64_t page = _header._root;
+	while(true) {
+		PageHandle node(fetch(page));
+		if(headerOf(node.data())->_leaf) {
+			break;
+		}
+		page = childrenOf(node.data())[0];
+	}
+	return skipEmpty(page, 0);
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+typename DiskMtmMap diskMapTemplate::iterator DiskMtmMap diskMapTemplate::end() const {
+	return iterator(this, 0, 0);
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::insert(const Pair& pair) {
+	KeyType separator;
+	uint64_t sibling;
+	if(!insertAux(_header._root, pair, &separator, &sibling)) {
+		return;
+	}
+	// the root was split, the tree grows by one level
+	Frame* root = allocatePage(false);
+	PageHandle handle(root);
+	PageHeader* header = headerOf(handle.data());
+	keysOf(handle.data())[0] = separator;
+	childrenOf(handle.data())[0] = _header._root;
+	childrenOf(handle.data())[1] = sibling;
+	header->_count = 1;
+	_header._root = root->_page;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::insert(const KeyType& key, const ValueType& value) {
+	insert(Pair(key, value));
+}
+
+/**
+ * Inserts pair into the subtree of page. Returns true if page was split, in
+ * which case separator and sibling are set to the first key of the new
+ * right page and to that page.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+bool DiskMtmMap diskMapTemplate::insertAux(uint64_t page, const Pair& pair,
+		KeyType* separator, uint64_t* sibling) {
+	PageHandle node(fetch(page));
+	PageHeader* header = headerOf(node.data());
+	if(header->_leaf) {
+		unsigned int position = lowerBound(node.data(), pair.first);
+		KeyType* keys = keysOf(node.data());
+		ValueType* values = valuesOf(node.data());
+		node.markDirty();
+		if(position < header->_count && !compare(pair.first, keys[position])) {
+			values[position] = pair.second;
+			return false;
+		}
+		_header._size++;
+		if(header->_count < LEAF_CAPACITY) {
+			std::memmove(keys + position + 1, keys + position,
+					(header->_count - position) * sizeof(KeyType));
+			std::memmove(values + position + 1, values + position,
+					(header->_count - position) * sizeof(ValueType));
+			keys[position] = pair.first;
+			values[position] = pair.second;
+			header->_count++;
+			return false;
+		}
+		Frame* right = allocatePage(true);
+		PageHandle rightHandle(right);
+		splitLeaf(node.data(), right, position, pair);
+		*separator = keysOf(rightHandle.data())[0];
+		*sibling = right->_page;
+		return true;
+	}
+	unsigned int position = upperBound(node.data(), pair.first);
+	KeyType childSeparator;
+	uint64_t childSibling;
+	if(!insertAux(childrenOf(node.data())[position], pair, &childSeparator,
+			&childSibling)) {
+		return false;
+	}
+	node.markDirty();
+	if(header->_count < INTERNAL_CAPACITY) {
+		insertIntoInternal(node.data(), position, childSeparator, childSibling);
+		return false;
+	}
+	Frame* right = allocatePage(false);
+	PageHandle rightHandle(right);
+	splitInternal(node.data(), right, position, childSeparator, childSibling,
+			separator);
+	*sibling = right->_page;
+	return true;
+}
+
+/**
+ * Moves the upper half of the full leaf left to right and inserts pair at
+ * position. Appending to the last leaf moves only the new element, so leaves
+ * filled by increasing keys stay full.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::splitLeaf(unsigned char* left, Frame* right,
+		unsigned int position, const Pair& pair) {
+	PageHeader* leftHeader = headerOf(left);
+	unsigned char* rightPage = right->_buffer->_bytes;
+	PageHeader* rightHeader = headerOf(rightPage);
+	unsigned int count = leftHeader->_count;
+	unsigned int middle = (position == count && leftHeader->_next == 0) ?
+			count : count / 2;
+	std::memcpy(keysOf(rightPage), keysOf(left) + middle,
+			(count - middle) * sizeof(KeyType));
+	std::memcpy(valuesOf(rightPage), valuesOf(left) + middle,
+			(count - middle) * sizeof(ValueType));
+	rightHeader->_count = count - middle;
+	leftHeader->_count = middle;
+	rightHeader->_next = leftHeader->_next;
+	leftHeader->_next = right->_page;
+	unsigned char* target = left;
+	if(position > middle || (position == middle && middle == count)) {
+		target = rightPage;
+		position -= middle;
+	}
+	PageHeader* targetHeader = headerOf(target);
+	KeyType* keys = keysOf(target);
+	ValueType* values = valuesOf(target);
+	std::memmove(keys + position + 1, keys + position,
+			(targetHeader->_count - position) * sizeof(KeyType));
+	std::memmove(values + position + 1, values + position,
+			(targetHeader->_count - position) * sizeof(ValueType));
+	keys[position] = pair.first;
+	values[position] = pair.second;
+	targetHeader->_count++;
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::insertIntoInternal(unsigned char* page,
+		unsigned int position, const KeyType& separator, uint64_t sibling) {
+	PageHeader* header = headerOf(page);
+	KeyType* keys = keysOf(page);
+	uint64_t* children = childrenOf(page);
+	std::memmove(keys + position + 1, keys + position,
+			(header->_count - position) * sizeof(KeyType));
+	std::memmove(children + position + 2, children + position + 1,
+			(header->_count - position) * sizeof(uint64_t));
+	keys[position] = separator;
+	children[position + 1] = sibling;
+	header->_count++;
+}
+
+/**
+ * Splits the full internal page left around its middle key, which is moved
+ * up as promoted, then inserts separator and sibling (the split of the child
+ * at position) into the half they belong to.
+ */
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::splitInternal(unsigned char* left, Frame* right,
+		unsigned int position, const KeyType& separator, uint64_t sibling,
+		KeyType* promoted) {
+	PageHeader* leftHeader = headerOf(left);
+	unsigned char* rightPage = right->_buffer->_bytes;
+	unsigned int count = leftHeader->_count;
+	unsigned int middle = count / 2;
+	*promoted = keysOf(left)[middle];
+	std::memcpy(keysOf(rightPage), keysOf(left) + middle + 1,
+			(count - middle - 1) * sizeof(KeyType));
+	std::memcpy(childrenOf(rightPage), childrenOf(left) + middle + 1,
+			(count - middle) * sizeof(uint64_t));
+	headerOf(rightPage)->_count = count - middle - 1;
+	leftHeader->_count = middle;
+	if(position <= middle) {
+		insertIntoInternal(left, position, separator, sibling);
+	} else {
+		insertIntoInternal(rightPage, position - middle - 1, separator, sibling);
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction, unsigned int PageBytes>
+void DiskMtmMap diskMapTemplate::remove(const KeyType& key) {
+	PageHandle leaf(fetch(findLeaf(key)));
+	PageHeader* header = headerOf(leaf.data());
+	unsigned int position = lowerBound(leaf.data(), key);
+	KeyType* keys = keysOf(leaf.data());
+	ValueType* values = valuesOf(leaf.data());
+	if(position == header->_count || compare(key, keys[position])) {
+		throw MapElementNotFoundException();
+	}
+	std::memmove(keys + position, keys + position + 1,
+			(header->_count - position - 1) * sizeof(KeyType));
+	std::memmove(values + position, values + position + 1,
+			(header->_count - position - 1) * sizeof(ValueType));
+	header->_count--;
+	leaf.markDirty();
+	_header._size--;
+}
+
+}
+
+#endif
@@ -0,0 +1,429 @@
+#ifndef FLATMTMMAP_H_
+#define FLATMTMMAP_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "Exceptions.h"
+
+#define flatMapTemplate <KeyType, ValueType, CompareFunction>
+
+namespace mtm {
+/**
+ * How a FlatMtmMap searches its keys:
+ * FLAT_BINARY_SEARCH is a branchless binary search of the sorted keys,
+ * FLAT_EYTZINGER searches a copy of the keys laid out as a complete binary
+ * tree in breadth first order, whose next levels can be prefetched while a
+ * level is compared, for maps too large for the cache. The copy costs the
+ * keys' memory again and an index per key, and is rebuilt by each change.
+ */
+enum FlatSearch {
+	FLAT_BINARY_SEARCH,
+	FLAT_EYTZINGER
+};
+
+/**
+ * An MtmMap for maps that are built once and then read or scanned: the keys
+ * and the values are kept in two sorted contiguous arrays, so a search is a
+ * binary search over the keys alone and a scan reads memory in order.
+ * A single insert or remove moves the elements after it, in O(n), so a map
+ * is better built by assign_sorted, in O(n), or by insertBatch, which sorts
+ * the batch and merges it in one pass.
+ *
+ * The API is the one of MtmMap, with size() in O(1), except that
+ * dereferencing an iterator returns a Pair of references to the element's
+ * key and value, and that any change of the map invalidates its iterators.
+ */
+template<class KeyType, class ValueType, class CompareFunction = std::less<
+		KeyType> >
+class FlatMtmMap {
+public:
+	class iterator;
+	/**
+	 * The key and the value of an element of the map, referred to in place.
+	 */
+	class Pair {
+	public:
+		Pair(const KeyType& key, ValueType& value) :
+				first(key), second(value) {
+		}
+		const KeyType& first;
+		ValueType& second;
+	};
+private:
+	std::vector<KeyType> _keys;
+	std::vector<ValueType> _values;
+	ValueType _defaultValue;
+	CompareFunction compare;
+	FlatSearch _search;
+	// the Eytzinger layout of the keys from index 1, and the sorted index of each
+	std::vector<KeyType> _layout;
+	std::vector<size_t> _ranks;
+
+	template<class Key>
+	size_t lowerBoundNode(const Key& key) const;
+	template<class Key>
+	size_t lowerBoundIndex(const Key& key) const;
+	template<class Key>
+	size_t findIndex(const Key& key) const;
+	template<class Key>
+	bool holds(const Key& key) const;
+	template<class Key>
+	void removeIndex(const Key& key);
+	size_t buildLayout(size_t node, size_t index);
+	void changed();
+public:
+	/**
+	 * Map Constructor.
+	 * creates an empty map giving @defaultValue to the keys it doesn't hold,
+	 * searched by @search.
+	 */
+	explicit FlatMtmMap(const ValueType& defaultValue,
+			FlatSearch search = FLAT_BINARY_SEARCH)
+	: _defaultValue(defaultValue), _search(search) {}
+	/**
+	 * Removes all the elements.
+	 */
+	void clear() {
+		_keys.clear();
+		_values.clear();
+		changed();
+	}
+	/**
+	 * Inserts the given pair, in O(n). IF given key already exists in the
+	 * map, replaces the old value of the element with the new given value.
+	 */
+	void insert(const Pair& pair) {
+		insert(pair.first, pair.second);
+	}
+	void insert(const KeyType& key, const ValueType& value);
+	/**
+	 * Inserts all the pairs of batch, in O(n + b log b) for b pairs: the
+	 * batch is sorted and merged with the elements. A key that appears
+	 * several times in the batch gets its last value, as with inserting the
+	 * pairs one by one.
+	 */
+	void insertBatch(std::vector<std::pair<KeyType, ValueType> > batch);
+	/**
+	 * Replaces the elements of the map by keys and values, in O(n): keys must
+	 * be sorted by CompareFunction without repetition, and values[i] is the
+	 * value of keys[i].
+	 * throws std::invalid_argument if the keys are not sorted or repeat, or
+	 * if there are not as many values as keys.
+	 */
+	void assign_sorted(std::vector<KeyType> keys, std::vector<ValueType> values);
+	/**
+	 * Removes an element from the map, in O(n).
+	 * if the given key does not match any element's key in the map -
+	 * throws MapElementNotFoundException.
+	 */
+	void remove(const KeyType& key) {
+		removeIndex(key);
+	}
+	/**
+	 * Returns an iterator to the element with the requested key, or end()
+	 * if no such element was found.
+	 */
+	iterator find(const KeyType& key) const {
+		return iterator(this, findIndex(key));
+	}
+	/**
+	 * Returns an iterator to the first element whose key is not smaller than
+	 * the given key, or end() if there is none.
+	 */
+	iterator lower_bound(const KeyType& key) const {
+		return iterator(this, lowerBoundIndex(key));
+	}
+	bool containsKey(const KeyType& key) const {
+		return holds(key);
+	}
+	/**
+	 * Versions of find, containsKey, remove and lower_bound that take any key
+	 * type the CompareFunction can compare with KeyType, when it declares
+	 * is_transparent, as in MtmMap.
+	 */
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	iterator find(const Key& key) const {
+		return iterator(this, findIndex(key));
+	}
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	bool containsKey(const Key& key) const {
+		return holds(key);
+	}
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	void remove(const Key& key) {
+		removeIndex(key);
+	}
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	iterator lower_bound(const Key& key) const {
+		return iterator(this, lowerBoundIndex(key));
+	}
+	iterator begin() const {
+		return iterator(this, 0);
+	}
+	iterator end() const {
+		return iterator(this, _keys.size());
+	}
+	unsigned int size() const {
+		return (unsigned int)_keys.size();
+	}
+	/**
+	 * Returns a reference to the value of the element according to the key,
+	 * inserting it with the default value if it is not in the map.
+	 */
+	ValueType& operator[](const KeyType& key);
+	/**
+	 * Returns a const reference to the value of the element according to the
+	 * key, or to the default value if it is not in the map (for const maps).
+	 */
+	const ValueType& operator[](const KeyType& key) const {
+		size_t index = findIndex(key);
+		return index == _keys.size() ? _defaultValue : _values[index];
+	}
+	const ValueType& defaultValue() const {
+		return _defaultValue;
+	}
+	FlatSearch search() const {
+		return _search;
+	}
+	/**
+	 * The sorted keys and their values, as contiguous arrays.
+	 */
+	const std::vector<KeyType>& keys() const {
+		return _keys;
+	}
+	const std::vector<ValueType>& values() const {
+		return _values;
+	}
+};
+
+template<class KeyType, class ValueType, class CompareFunction>
+class FlatMtmMap flatMapTemplate::iterator {
+	const FlatMtmMap* _map;
+	size_t _index;
+	friend class FlatMtmMap;
+public:
+	explicit iterator(const FlatMtmMap* map = NULL, size_t index = 0)
+	: _map(map), _index(index) {}
+	iterator& operator++() {
+		if(*this == _map->end()) {
+			return *this;
+		}
+		_index++;
+		return *this;
+	}
+	iterator operator++(int) {
+		iterator tmp_iter = *this;
+		++(*this);
+		return tmp_iter;
+	}
+	/**
+	 * throws MapElementNotFoundException if iterator is pointing to the
+	 * end of the container.
+	 */
+	Pair operator*() const {
+		if(*this == _map->end()) {
+			throw MapElementNotFoundException();
+		}
+		return Pair(_map->_keys[_index],
+				const_cast<ValueType&>(_map->_values[_index]));
+	}
+	bool operator==(const iterator& iterator) const {
+		return (_map == iterator._map && _index == iterator._index);
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+};
+
+/**
+ * The node of the Eytzinger layout holding the lower bound of key, 0 if
+ * there is none.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+size_t FlatMtmMap flatMapTemplate::lowerBoundNode(const Key& key) const {
+	const size_t n = _keys.size();
+	const KeyType* layout = _layout.data();
+	size_t node = 1;
+	while(node <= n) {
+		// the 16 nodes four levels down share a few cache lines
+		__builtin_prefetch(layout + 16 * node);
+		node = 2 * node + compare(layout[node], key);
+	}
+	// climb back up the right turns taken past the last left one
+	return node >> __builtin_ffsll(~node);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+size_t FlatMtmMap flatMapTemplate::lowerBoundIndex(const Key& key) const {
+	if(_keys.empty()) {
+		return 0;
+	}
+	if(_search == FLAT_EYTZINGER) {
+		size_t node = lowerBoundNode(key);
+		return node == 0 ? _keys.size() : _ranks[node];
+	}
+	// the range [first, first + n] holds the lower bound, halved without branches
+	const KeyType* first = _keys.data();
+	size_t n = _keys.size();
+	while(n > 1) {
+		size_t half = n / 2;
+		first = compare(first[half], key) ? first + half : first;
+		n -= half;
+	}
+	return (first - _keys.data()) + compare(*first, key);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+size_t FlatMtmMap flatMapTemplate::findIndex(const Key& key) const {
+	if(_search == FLAT_EYTZINGER) {
+		size_t node = lowerBoundNode(key);
+		if(node != 0 && !compare(key, _layout[node])) {
+			return _ranks[node];
+		}
+		return _keys.size();
+	}
+	size_t index = lowerBoundIndex(key);
+	if(index < _keys.size() && !compare(key, _keys[index])) {
+		return index;
+	}
+	return _keys.size();
+}
+
+/**
+ * containsKey, which with the Eytzinger layout doesn't need to look up the
+ * sorted index of the key.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+bool FlatMtmMap flatMapTemplate::holds(const Key& key) const {
+	if(_search == FLAT_EYTZINGER) {
+		size_t node = lowerBoundNode(key);
+		return node != 0 && !compare(key, _layout[node]);
+	}
+	return findIndex(key) != _keys.size();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+size_t FlatMtmMap flatMapTemplate::buildLayout(size_t node, size_t index) {
+	if(node > _keys.size()) {
+		return index;
+	}
+	index = buildLayout(2 * node, index);
+	_layout[node] = _keys[index];
+	_ranks[node] = index;
+	return buildLayout(2 * node + 1, index + 1);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void FlatMtmMap flatMapTemplate::changed() {
+	if(_search != FLAT_EYTZINGER) {
+		return;
+	}
+	_layout.assign(_keys.size() + 1, _keys.empty() ? KeyType() : _keys[0]);
+	_ranks.assign(_keys.size() + 1, 0);
+	buildLayout(1, 0);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void FlatMtmMap flatMapTemplate::insert(const KeyType& key, const ValueType& value) {
+	size_t index = lowerBoundIndex(key);
+	if(index < _keys.size() && !compare(key, _keys[index])) {
+		_values[index] = value;
+		return;
+	}
+	_keys.insert(_keys.begin() + index, key);
+	_values.insert(_values.begin() + index, value);
+	changed();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void FlatMtmMap flatMapTemplate::insertBatch(
+		std::vector<std::pair<KeyType, ValueType> > batch) {
+	CompareFunction compareKeys = compare;
+	std::stable_sort(batch.begin(), batch.end(),
+			[&compareKeys](const std::pair<KeyType, ValueType>& a,
+					const std::pair<KeyType, ValueType>& b) {
+				return compareKeys(a.first, b.first);
+			});
+	std::vector<KeyType> keys;
+	std::vector<ValueType> values;
+	keys.reserve(_keys.size() + batch.size());
+	values.reserve(_keys.size() + batch.size());
+	size_t old = 0;
+	for(size_t i = 0; i < batch.size(); i++) {
+		// of the equal keys of the batch, the last one wins
+		if(i + 1 < batch.size() && !compare(batch[i].first, batch[i + 1].first)) {
+			continue;
+		}
+		while(old < _keys.size() && compare(_keys[old], batch[i].first)) {
+			keys.push_back(std::move(_keys[old]));
+			values.push_back(std::move(_values[old]));
+			old++;
+		}
+		if(old < _keys.size() && !compare(batch[i].first, _keys[old])) {
+			old++;
+		}
+		keys.push_back(std::move(batch[i].first));
+		values.push_back(std::move(batch[i].second));
+	}
+	for(; old < _keys.size(); old++) {
+		keys.push_back(std::move(_keys[old]));
+		values.push_back(std::move(_values[old]));
+	}
+	_keys.swap(keys);
+	_values.swap(values);
+	changed();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void FlatMtmMap flatMapTemplate::assign_sorted(std::vector<KeyType> keys,
+		std::vector<ValueType> values) {
+	if(keys.size() != values.size()) {
+		throw std::invalid_argument("assign_sorted needs a value per key");
+	}
+	for(size_t i = 1; i < keys.size(); i++) {
+		if(!compare(keys[i - 1], keys[i])) {
+			throw std::invalid_argument("assign_sorted needs sorted unique keys");
+		}
+	}
+	_keys.swap(keys);
+	_values.swap(values);
+	changed();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+void FlatMtmMap flatMapTemplate::removeIndex(const Key& key) {
+	size_t index = findIndex(key);
+	if(index == _keys.size()) {
+		throw MapElementNotFoundException();
+	}
+	_keys.erase(_keys.begin() + index);
+	_values.erase(_values.begin() + index);
+	changed();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+ValueType& FlatMtmMap flatMapTemplate::operator[](const KeyType& key) {
+	size_t index = findIndex(key);
+	if(index == _keys.size()) {
+		insert(key, _defaultValue);
+		index = findIndex(key);
+	}
+	return _values[index];
+}
+
+} // namespace mtm
+
+#endif /* FLATMTMMAP_H_ */
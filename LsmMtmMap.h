@@ -0,0 +1,618 @@
+#ifndef LSMMTMMAP_H_
+#define LSMMTMMAP_H_
+
+#include <condition_variable>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Exceptions.h"
+
+#define lsmMapTemplate <KeyType, ValueType, CompareFunction>
+
+namespace mtm {
+/**
+ * A write optimised MtmMap, for workloads that insert in bursts and seldom
+ * read (a log-structured merge tree kept in memory).
+ * Inserts and removes go to a small ordered memtable; once it holds
+ * memtableLimit keys it is frozen into an immutable sorted run, and removed
+ * keys are recorded there as tombstones. A background thread merges runs of
+ * similar sizes, FANOUT at a time, so the amount of runs stays logarithmic
+ * and each element is merged O(log n) times in all.
+ *
+ * Lookups consult the memtable and then the runs from the newest to the
+ * oldest, the first one that holds the key wins. begin() and find() freeze
+ * the memtable, however few keys it holds, and return an iterator that
+ * merges the runs; the iterator holds on to the runs it merges, so it stays
+ * valid (and keeps seeing the map as it was) while the map is modified.
+ * Frequent iteration between writes thus makes many small runs, which the
+ * compaction merges when they pile up.
+ *
+ * The API is the one of MtmMap, except that iterators give access to const
+ * elements and that size() takes O(n).
+ * The map is not thread safe, only its compaction runs in the background.
+ */
+template<class KeyType, class ValueType, class CompareFunction = std::less<
+		KeyType> >
+class LsmMtmMap {
+public:
+	class iterator;
+	/**
+	 * Couples together a pair of key and value which may be of different types.
+	 */
+	class Pair {
+	public:
+		Pair(const KeyType& key, const ValueType& value) :
+				first(key), second(value) {
+		}
+		Pair(const Pair& pair) :
+				first(pair.first), second(pair.second) {
+		}
+		const KeyType first;
+		ValueType second;
+	};
+private:
+	struct Entry {
+		Pair _pair;
+		bool _removed;
+		Entry(const KeyType& key, const ValueType& value, bool removed)
+		: _pair(key, value), _removed(removed) {}
+	};
+	struct Slot {
+		ValueType _value;
+		bool _removed;
+	};
+	typedef std::vector<Entry> Run;
+	typedef std::shared_ptr<const Run> RunPointer;
+	/** The runs, from the newest to the oldest */
+	typedef std::vector<RunPointer> Runs;
+	/** Amount of runs of a size tier that are merged together */
+	static const unsigned int FANOUT = 4;
+	/** Freezing the memtable waits for the compaction beyond this */
+	static const unsigned int MAX_RUNS = 64;
+
+	ValueType _defaultValue;
+	CompareFunction compare;
+	size_t _memtableLimit;
+	mutable std::map<KeyType, Slot, CompareFunction> _memtable;
+	mutable std::mutex _mutex;
+	mutable std::condition_variable _changed;
+	mutable Runs _runs;
+	bool _stopping;
+	std::thread _compactor;
+public:
+	/**
+	 * Map Constructor.
+	 * receives @defaultValue and creates an empty map, whose memtable is
+	 * frozen into a run every @memtableLimit keys.
+	 */
+	LsmMtmMap(const ValueType& defaultValue, size_t memtableLimit = 65536);
+	LsmMtmMap(const LsmMtmMap& map) = delete;
+	LsmMtmMap& operator=(const LsmMtmMap& map) = delete;
+	/**
+	 * Destructor.
+	 * stops the compaction and de-allocates all the map's elements.
+	 */
+	~LsmMtmMap();
+	/**
+	 * Removes all the elements from the map.
+	 */
+	void clear();
+	/**
+	 * Inserts the given pair into the memtable, in O(log memtableLimit).
+	 * IF given key already exists in the map, its value is replaced.
+	 */
+	void insert(const Pair& pair);
+	void insert(const KeyType& key, const ValueType& value);
+	/**
+	 * Removes an element from the map.
+	 * if the given key does not match any element's key in the map -
+	 * throws MapElementNotFoundException.
+	 */
+	void remove(const KeyType& key);
+	/**
+	 * Returns an iterator to the element with the requested key, or end()
+	 * if no such element was found.
+	 */
+	iterator find(const KeyType& key) const;
+	/**
+	 * Returns an iterator to the first element of a merge of all the runs.
+	 */
+	iterator begin() const;
+	iterator end() const;
+	bool containsKey(const KeyType& key) const;
+	/**
+	 * Returns the amount of elements in the map, by merging all the runs.
+	 */
+	unsigned int size() const;
+	/**
+	 * Returns a reference to the value of the element according to the key,
+	 * which is copied to the memtable first. The reference points into the
+	 * memtable: it is valid until the next call that modifies the map or
+	 * freezes the memtable, which begin(), find(), size() and compact() do
+	 * although most of them are const. containsKey() and the const
+	 * operator[] keep it valid.
+	 */
+	ValueType& operator[](const KeyType& key);
+	/**
+	 * Returns a copy of the value of the element according to the key, or the
+	 * default value if the key is not in the map.
+	 */
+	ValueType operator[](const KeyType& key) const;
+	/**
+	 * Merges all the runs into one, dropping the tombstones, in the calling
+	 * thread. Lookups are fastest after it.
+	 */
+	void compact();
+
+private:
+	/**
+	 * Finds key in the memtable or the runs. Returns false if it is not in
+	 * the map, otherwise sets value to its value.
+	 */
+	bool lookup(const KeyType& key, ValueType* value) const;
+	/**
+	 * Binary searches a run for the first entry whose key is not smaller
+	 * than key.
+	 */
+	size_t lowerBound(const Run& run, const KeyType& key) const;
+	void freezeMemtable() const;
+	RunPointer merge(const Runs& runs, bool dropTombstones) const;
+	bool pickGroup(size_t* first, size_t* last) const;
+	bool replaceGroup(const Runs& group, const RunPointer& merged);
+	void compactLoop();
+	iterator snapshot(const KeyType* from) const;
+};
+
+/**
+ * Walks the runs of a snapshot in increasing key order, merging them: of
+ * the runs that hold the same key the newest wins, and keys whose newest
+ * entry is a tombstone are skipped.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+class LsmMtmMap lsmMapTemplate::iterator {
+	std::shared_ptr<const Runs> _runs;
+	std::vector<size_t> _positions;
+	// the run of the current element, -1 at the end
+	int _current;
+	CompareFunction compare;
+	friend class LsmMtmMap;
+
+	const Entry& entryOf(size_t run) const {
+		return (*(*_runs)[run])[_positions[run]];
+	}
+	/**
+	 * Moves to the smallest key that is not removed, from the positions of
+	 * the runs.
+	 */
+	void settle() {
+		while(true) {
+			_current = -1;
+			for(size_t run = 0; run < _runs->size(); run++) {
+				if(_positions[run] == (*_runs)[run]->size()) {
+					continue;
+				}
+				if(_current < 0 || compare(entryOf(run)._pair.first,
+						entryOf(_current)._pair.first)) {
+					_current = (int)run;
+				}
+			}
+			if(_current < 0) {
+				_runs.reset();
+				_positions.clear();
+				return;
+			}
+			// older entries of the same key are shadowed
+			for(size_t run = _current + 1; run < _runs->size(); run++) {
+				if(_positions[run] < (*_runs)[run]->size()
+						&& !compare(entryOf(_current)._pair.first,
+								entryOf(run)._pair.first)) {
+					_positions[run]++;
+				}
+			}
+			if(!entryOf(_current)._removed) {
+				return;
+			}
+			_positions[_current]++;
+		}
+	}
+public:
+	iterator() : _current(-1), compare() {}
+	iterator(const iterator& it) = default;
+	iterator& operator=(const iterator& it) = default;
+	/**
+	 * First promote an iterator to point to the next element in the container
+	 * and then allows placements.
+	 */
+	iterator& operator++() {
+		if(_current < 0) {
+			return *this;
+		}
+		_positions[_current]++;
+		settle();
+		return *this;
+	}
+	iterator operator++(int) {
+		iterator tmp_iter = *this;
+		++(*this);
+		return tmp_iter;
+	}
+	/**
+	 * Returns a const reference to the element pointed by the iterator.
+	 * throws MapElementNotFoundException if iterator is pointing to the
+	 * end of the container.
+	 */
+	const Pair& operator*() const {
+		if(_current < 0) {
+			throw MapElementNotFoundException();
+		}
+		return entryOf(_current)._pair;
+	}
+	bool operator==(const iterator& iterator) const {
+		if(_current < 0 || iterator._current < 0) {
+			return _current == iterator._current;
+		}
+		return _runs == iterator._runs && _positions == iterator._positions;
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+};
+
+template<class KeyType, class ValueType, class CompareFunction>
+LsmMtmMap lsmMapTemplate::LsmMtmMap(const ValueType& defaultValue,
+		size_t memtableLimit)
+: _defaultValue(defaultValue), _memtableLimit(memtableLimit > 0 ? memtableLimit : 1),
+  _stopping(false) {
+	_compactor = std::thread(&LsmMtmMap::compactLoop, this);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+LsmMtmMap lsmMapTemplate::~LsmMtmMap() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_changed.notify_all();
+	_compactor.join();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::clear() {
+	_memtable.clear();
+	std::lock_guard<std::mutex> lock(_mutex);
+	_runs.clear();
+	_changed.notify_all();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::insert(const Pair& pair) {
+	Slot slot = { pair.second, false };
+	_memtable.insert_or_assign(pair.first, slot);
+	if(_memtable.size() >= _memtableLimit) {
+		freezeMemtable();
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::insert(const KeyType& key, const ValueType& value) {
+	insert(Pair(key, value));
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::remove(const KeyType& key) {
+	if(!containsKey(key)) {
+		throw MapElementNotFoundException();
+	}
+	Slot tombstone = { _defaultValue, true };
+	_memtable.insert_or_assign(key, tombstone);
+	if(_memtable.size() >= _memtableLimit) {
+		freezeMemtable();
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+size_t LsmMtmMap lsmMapTemplate::lowerBound(const Run& run,
+		const KeyType& key) const {
+	size_t low = 0, high = run.size();
+	while(low < high) {
+		size_t middle = low + (high - low) / 2;
+		if(compare(run[middle]._pair.first, key)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+bool LsmMtmMap lsmMapTemplate::lookup(const KeyType& key, ValueType* value) const {
+	typename std::map<KeyType, Slot, CompareFunction>::const_iterator slot =
+			_memtable.find(key);
+	if(slot != _memtable.end()) {
+		if(slot->second._removed) {
+			return false;
+		}
+		*value = slot->second._value;
+		return true;
+	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	for(size_t i = 0; i < _runs.size(); i++) {
+		const Run& run = *_runs[i];
+		size_t position = lowerBound(run, key);
+		if(position < run.size() && !compare(key, run[position]._pair.first)) {
+			if(run[position]._removed) {
+				return false;
+			}
+			*value = run[position]._pair.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+bool LsmMtmMap lsmMapTemplate::containsKey(const KeyType& key) const {
+	ValueType value = _defaultValue;
+	return lookup(key, &value);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+ValueType& LsmMtmMap lsmMapTemplate::operator[](const KeyType& key) {
+	typename std::map<KeyType, Slot, CompareFunction>::iterator slot =
+			_memtable.find(key);
+	if(slot != _memtable.end() && !slot->second._removed) {
+		return slot->second._value;
+	}
+	Slot copy = { _defaultValue, false };
+	lookup(key, &copy._value);
+	if(_memtable.size() + 1 >= _memtableLimit) {
+		freezeMemtable();
+	}
+	return _memtable.insert_or_assign(key, copy).first->second._value;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+ValueType LsmMtmMap lsmMapTemplate::operator[](const KeyType& key) const {
+	ValueType value = _defaultValue;
+	lookup(key, &value);
+	return value;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+unsigned int LsmMtmMap lsmMapTemplate::size() const {
+	unsigned int count = 0;
+	for(iterator it = begin(); it != end(); ++it) {
+		count++;
+	}
+	return count;
+}
+
+/**
+ * Moves the memtable, which is already sorted, into a new run.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::freezeMemtable() const {
+	if(_memtable.empty()) {
+		return;
+	}
+	std::shared_ptr<Run> run = std::make_shared<Run>();
+	run->reserve(_memtable.size());
+	for(typename std::map<KeyType, Slot, CompareFunction>::const_iterator it =
+			_memtable.begin(); it != _memtable.end(); ++it) {
+		run->push_back(Entry(it->first, it->second._value, it->second._removed));
+	}
+	_memtable.clear();
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(_runs.size() >= MAX_RUNS) {
+		_changed.wait(lock);
+	}
+	_runs.insert(_runs.begin(), run);
+	_changed.notify_all();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+typename LsmMtmMap lsmMapTemplate::iterator LsmMtmMap lsmMapTemplate::snapshot(
+		const KeyType* from) const {
+	freezeMemtable();
+	iterator it;
+	it.compare = compare;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if(_runs.empty()) {
+			return end();
+		}
+		it._runs = std::make_shared<const Runs>(_runs);
+	}
+	it._positions.resize(it._runs->size(), 0);
+	if(from) {
+		for(size_t run = 0; run < it._runs->size(); run++) {
+			it._positions[run] = lowerBound(*(*it._runs)[run], *from);
+		}
+	}
+	it.settle();
+	return it;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+typename LsmMtmMap lsmMapTemplate::iterator LsmMtmMap lsmMapTemplate::begin() const {
+	return snapshot(NULL);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+typename LsmMtmMap lsmMapTemplate::iterator LsmMtmMap lsmMapTemplate::end() const {
+	return iterator();
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+typename LsmMtmMap lsmMapTemplate::iterator LsmMtmMap lsmMapTemplate::find(
+		const KeyType& key) const {
+	if(!containsKey(key)) {
+		return end();
+	}
+	return snapshot(&key);
+}
+
+/**
+ * Merges runs (from the newest to the oldest) into one run, the newest entry
+ * of each key wins. Tombstones can be dropped when nothing older remains
+ * for them to hide.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+typename LsmMtmMap lsmMapTemplate::RunPointer LsmMtmMap lsmMapTemplate::merge(
+		const Runs& runs, bool dropTombstones) const {
+	std::shared_ptr<Run> merged = std::make_shared<Run>();
+	size_t total = 0;
+	for(size_t i = 0; i < runs.size(); i++) {
+		total += runs[i]->size();
+	}
+	merged->reserve(total);
+	std::vector<size_t> positions(runs.size(), 0);
+	while(true) {
+		int newest = -1;
+		for(size_t run = 0; run < runs.size(); run++) {
+			if(positions[run] < runs[run]->size() && (newest < 0
+					|| compare((*runs[run])[positions[run]]._pair.first,
+							(*runs[newest])[positions[newest]]._pair.first))) {
+				newest = (int)run;
+			}
+		}
+		if(newest < 0) {
+			break;
+		}
+		const Entry& entry = (*runs[newest])[positions[newest]];
+		if(!entry._removed || !dropTombstones) {
+			merged->push_back(entry);
+		}
+		for(size_t run = newest + 1; run < runs.size(); run++) {
+			if(positions[run] < runs[run]->size() && !compare(entry._pair.first,
+					(*runs[run])[positions[run]]._pair.first)) {
+				positions[run]++;
+			}
+		}
+		positions[newest]++;
+	}
+	return merged;
+}
+
+/**
+ * Looks for FANOUT or more consecutive runs in the same size tier (tier t
+ * holds up to memtableLimit * FANOUT^t entries), the newest first.
+ * Merges that drop entries leave runs out of their tier, and tiers may end
+ * up interleaved with no such group: once half of MAX_RUNS runs pile up,
+ * the FANOUT consecutive runs with the fewest entries are picked instead,
+ * so that a writer waiting in freezeMemtable is always let through.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+bool LsmMtmMap lsmMapTemplate::pickGroup(size_t* first, size_t* last) const {
+	size_t start = 0;
+	int startTier = -1;
+	for(size_t i = 0; i <= _runs.size(); i++) {
+		int tier = -2;
+		if(i < _runs.size()) {
+			tier = 0;
+			for(size_t limit = _memtableLimit; _runs[i]->size() > limit;
+					limit *= FANOUT) {
+				tier++;
+			}
+		}
+		if(tier == startTier) {
+			continue;
+		}
+		if(i - start >= FANOUT) {
+			*first = start;
+			*last = i;
+			return true;
+		}
+		start = i;
+		startTier = tier;
+	}
+	if(_runs.size() < MAX_RUNS / 2) {
+		return false;
+	}
+	size_t smallest = 0, window = 0;
+	for(size_t i = 0; i + FANOUT <= _runs.size(); i++) {
+		size_t entries = 0;
+		for(size_t j = i; j < i + FANOUT; j++) {
+			entries += _runs[j]->size();
+		}
+		if(i == 0 || entries < smallest) {
+			smallest = entries;
+			window = i;
+		}
+	}
+	*first = window;
+	*last = window + FANOUT;
+	return true;
+}
+
+/**
+ * Replaces group by merged in the runs. Returns false, leaving the runs
+ * untouched, if some runs of group were cleared or merged by another
+ * compaction while group was merged.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+bool LsmMtmMap lsmMapTemplate::replaceGroup(const Runs& group,
+		const RunPointer& merged) {
+	for(size_t i = 0; i + group.size() <= _runs.size(); i++) {
+		if(_runs[i] != group[0]) {
+			continue;
+		}
+		for(size_t j = 1; j < group.size(); j++) {
+			if(_runs[i + j] != group[j]) {
+				return false;
+			}
+		}
+		typename Runs::iterator start = _runs.begin() + i;
+		start = _runs.erase(start, start + group.size());
+		if(!merged->empty()) {
+			_runs.insert(start, merged);
+		}
+		return true;
+	}
+	return false;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::compactLoop() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	while(!_stopping) {
+		size_t first, last;
+		if(!pickGroup(&first, &last)) {
+			_changed.wait(lock);
+			continue;
+		}
+		Runs group(_runs.begin() + first, _runs.begin() + last);
+		bool oldest = (last == _runs.size());
+		lock.unlock();
+		RunPointer merged = merge(group, oldest);
+		lock.lock();
+		replaceGroup(group, merged);
+		_changed.notify_all();
+	}
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void LsmMtmMap lsmMapTemplate::compact() {
+	freezeMemtable();
+	std::unique_lock<std::mutex> lock(_mutex);
+	// retried when the background compaction replaced some of the runs
+	while(_runs.size() > 1) {
+		Runs all = _runs;
+		lock.unlock();
+		RunPointer merged = merge(all, true);
+		lock.lock();
+		if(replaceGroup(all, merged)) {
+			_changed.notify_all();
+			return;
+		}
+	}
+}
+
+}
+
+#endif
@@ -4,7 +4,11 @@
 #include <cassert>
 #include <functional>
 #include <cstdlib>
+#include <mutex>
+#include <vector>
 #include "Exceptions.h"
+#include "key_filter.h"
+#include "node_allocation.h"
 
 #define mapTemplate <KeyType, ValueType, CompareFunction>
 
@@ -22,6 +26,13 @@ class MtmMap {
 	Node* _head;
 	ValueType _defaultValue;
 	CompareFunction compare;
+	std::pmr::memory_resource* _resource;
+	KeyFilter<KeyType>* _filter;
+	// the nodes splitPoints cut the list at, kept until the list changes
+	// (empty when they must be found again)
+	mutable std::vector<Node*> _splits;
+	mutable size_t _splitsChunks;
+	mutable std::mutex _splitsMutex;
 public:
 	/**
 	 * A pointer to an object in the map.
@@ -45,11 +56,15 @@ public:
 	 * Map Constructor.
 	 * receives @defaultValue and creates a new map by allocating head
 	 * - creating an empty linked list.
+	 * The map's nodes are allocated from, and given back to, @resource.
 	 */
-	MtmMap(const ValueType& defaultValue);
+	MtmMap(const ValueType& defaultValue,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 	/**
 	 * Copy Constructor.
 	 * creates a new allocated copy of a given map.
+	 * like the std::pmr containers, the copy allocates from the default
+	 * resource rather than from the given map's resource.
 	 */
 	MtmMap(const MtmMap& map);
 	/**
@@ -67,6 +82,9 @@ public:
 	 * De-allocates all the elements that were inserted to the map.
 	 * excluding head node, leaving the linked list empty but
 	 * still usable.
+	 * when the map allocates from a std::pmr::monotonic_buffer_resource and
+	 * its nodes are trivially destructible, the nodes are simply dropped and
+	 * are reclaimed when the arena is released.
 	 */
 	void clear();
 	/**
@@ -93,9 +111,41 @@ public:
 	void remove(const KeyType& key);
 	/**
 	 * Returns an iterator to the element with the requested key.
-	 * if no such element was found - throws MapElementNotFoundException.
+	 * if no such element was found - returns end().
 	 */
 	iterator find(const KeyType& key) const;
+	/**
+	 * Returns an iterator to the first element whose key is not smaller than
+	 * the given key, or end() if there is none.
+	 */
+	iterator lower_bound(const KeyType& key) const;
+	/**
+	 * Versions of find, containsKey, remove and lower_bound that take any key
+	 * type the CompareFunction can compare with KeyType, when it declares
+	 * is_transparent (like std::less<>): a map of std::string can then be
+	 * searched with a std::string_view or a const char* without building a
+	 * temporary string.
+	 */
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	iterator find(const Key& key) const {
+		return iterator(this, findNode(key));
+	}
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	bool containsKey(const Key& key) const {
+		return findNode(key) != NULL;
+	}
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	void remove(const Key& key) {
+		removeNode(key);
+	}
+	template<class Key, class Compare = CompareFunction,
+			class = typename Compare::is_transparent>
+	iterator lower_bound(const Key& key) const {
+		return iterator(this, lowerBoundNode(key));
+	}
 	/**
 	 * Returns an iterator to the first element in the map.
 	 */
@@ -122,6 +172,39 @@ public:
 	 * key (for const maps).
 	 */
 	const ValueType& operator[](const KeyType& key) const;
+	/**
+	 * Returns the value given to keys that are not in the map.
+	 */
+	const ValueType& defaultValue() const {
+		return _defaultValue;
+	}
+	/**
+	 * Makes find, containsKey, operator[] and remove consult @filter before
+	 * walking the list, so that most absent keys are rejected without a walk
+	 * (see key_filter.h). The map's keys are added to @filter first.
+	 * NULL detaches the current filter, the map never owns its filter, and a
+	 * copy of the map has none.
+	 * Returns false, and attaches nothing, if @filter can't take the keys.
+	 */
+	bool attachFilter(KeyFilter<KeyType>* filter);
+	/**
+	 * Cuts the map into at most @chunks runs of consecutive elements, all of
+	 * the same length but the last one, and at least @chunks / 2 of them
+	 * when the map has that many elements. Returns the iterator to the first
+	 * element of each run, followed by end().
+	 * The runs are found by one walk of the list, and kept for the next
+	 * calls until an element is inserted or removed, so that repeated
+	 * parallel traversals (see parallel.h) don't walk the list first.
+	 * Several threads may call it at once on an unmodified map.
+	 */
+	std::vector<iterator> splitPoints(size_t chunks) const;
+private:
+	template<class Key>
+	Node* lowerBoundNode(const Key& key) const;
+	template<class Key>
+	Node* findNode(const Key& key) const;
+	template<class Key>
+	void removeNode(const Key& key);
 };
 
 template<class KeyType, class ValueType, class CompareFunction>
@@ -204,11 +287,15 @@ public:
 };
 
 template<class KeyType, class ValueType, class CompareFunction>
-MtmMap mapTemplate::MtmMap(const ValueType& defaultValue)
-: _head(NULL), _defaultValue(defaultValue) {}
+MtmMap mapTemplate::MtmMap(const ValueType& defaultValue,
+		std::pmr::memory_resource* resource)
+: _head(NULL), _defaultValue(defaultValue), _resource(resource), _filter(NULL),
+_splitsChunks(0) {}
 
 template<class KeyType, class ValueType, class CompareFunction>
-MtmMap mapTemplate::MtmMap(const MtmMap& map) : _defaultValue(map._defaultValue), compare(map.compare) {
+MtmMap mapTemplate::MtmMap(const MtmMap& map) : _defaultValue(map._defaultValue),
+compare(map.compare), _resource(std::pmr::get_default_resource()), _filter(NULL),
+_splitsChunks(0) {
 	_head = NULL;
 	iterator it = map.begin();
 	for(unsigned int i = 0; i < map.size(); i++) {
@@ -237,24 +324,55 @@ CompareFunction>::operator=(const MtmMap& map) {
 	return *this;
 }
 
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+typename MtmMap mapTemplate::Node* MtmMap mapTemplate::lowerBoundNode(
+		const Key& key) const {
+	Node* node = _head;
+	while(node && compare(node->_data.first, key)) {
+		node = node->_next;
+	}
+	return node;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+typename MtmMap mapTemplate::Node* MtmMap mapTemplate::findNode(
+		const Key& key) const {
+	// the keys are sorted, the search stops at the first key not smaller
+	Node* node = lowerBoundNode(key);
+	if(node && !compare(key, node->_data.first)) {
+		return node;
+	}
+	return NULL;
+}
+
 template<class KeyType, class ValueType, class CompareFunction>
 typename MtmMap mapTemplate::iterator MtmMap<KeyType,
 ValueType, CompareFunction>::find(const KeyType &key) const {
-	for(MtmMap::iterator it = begin(); it != end(); it++) {
-		if(!compare(it._current->_data.first, key)
-				&& !compare(key, it._current->_data.first)) {
-			return it;
-		}
+	if(_filter && !_filter->mayContain(key)) {
+		return end();
 	}
-	return end();
+	return iterator(this, findNode(key));
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+typename MtmMap mapTemplate::iterator MtmMap<KeyType,
+ValueType, CompareFunction>::lower_bound(const KeyType &key) const {
+	return iterator(this, lowerBoundNode(key));
 }
 
 template<class KeyType, class ValueType, class CompareFunction>
 void MtmMap mapTemplate::insert(Pair pair) {
+	// a filter that can't take the key would hide it from the searches
+	if(_filter && !_filter->add(pair.first)) {
+		_filter = NULL;
+	}
 	iterator it = begin();
 	// edge case : if size is empty then insert first
-	if(size() == 0) {
-		_head = new Node(pair, NULL);
+	if(!_head) {
+		_head = allocateNode<Node>(_resource, pair);
+		_splits.clear();
 		return;
 	}
 	int count = 0;
@@ -267,7 +385,8 @@ void MtmMap mapTemplate::insert(Pair pair) {
 			&& !compare(pair.first, it._current->_data.first)) {
 		it._current->_data.second = pair.second;
 	} else {
-		Node* toInsert = new Node(pair, _head);
+		Node* toInsert = allocateNode<Node>(_resource, pair, _head);
+		_splits.clear();
 		//edge case: the iterator is pointing on the head of the list
 		if (it._current == _head) {
 			_head = toInsert;
@@ -290,30 +409,45 @@ void MtmMap mapTemplate::insert(const KeyType& key, const ValueType& value) {
 
 template<class KeyType, class ValueType, class CompareFunction>
 void MtmMap mapTemplate::remove(const KeyType& key) {
-	if(!containsKey(key)) {
+	if(_filter && !_filter->mayContain(key)) {
 		throw MapElementNotFoundException();
 	}
-	iterator it = begin();
-	while(it != end() && it._current->_data.first != key) {
-		it++;
+	removeNode(key);
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+template<class Key>
+void MtmMap mapTemplate::removeNode(const Key& key) {
+	Node* previous = NULL;
+	Node* node = _head;
+	while(node && compare(node->_data.first, key)) {
+		previous = node;
+		node = node->_next;
 	}
-	if (it._current == _head) {
-		_head = it._current->_next;
+	if(!node || compare(key, node->_data.first)) {
+		throw MapElementNotFoundException();
+	}
+	if(previous) {
+		previous->_next = node->_next;
 	} else {
-		iterator tmp_iterator = begin();
-		while (tmp_iterator._current->_next != it._current) {
-			tmp_iterator++;
-		}
-		tmp_iterator._current->_next = it._current->_next;
+		_head = node->_next;
 	}
-	delete it._current;
+	deallocateNode(_resource, node);
+	_splits.clear();
 }
 
 template<class KeyType, class ValueType, class CompareFunction>
 void MtmMap mapTemplate::clear() {
-	while(size() > 0) {
-		iterator it = begin();
-		remove(it._current->_data.first);
+	_splits.clear();
+	// an arena reclaims all the nodes at once, there is nothing to visit
+	if(releasedWithResource<Node>(_resource)) {
+		_head = NULL;
+		return;
+	}
+	while(_head) {
+		Node* next = _head->_next;
+		deallocateNode(_resource, _head);
+		_head = next;
 	}
 }
 
@@ -331,15 +465,61 @@ ValueType, CompareFunction>::end() const {
 
 template<class KeyType, class ValueType, class CompareFunction>
 bool MtmMap mapTemplate::containsKey(const KeyType& key) const {
-	iterator iterator = begin();
-	while(iterator != end()) {
-		if(!compare(iterator._current->_data.first, key)
-				&& !compare(key, iterator._current->_data.first)) {
-			return true;
+	if(_filter && !_filter->mayContain(key)) {
+		return false;
+	}
+	return findNode(key) != NULL;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+bool MtmMap mapTemplate::attachFilter(KeyFilter<KeyType>* filter) {
+	_filter = filter;
+	for(Node* node = _head; _filter && node; node = node->_next) {
+		if(!_filter->add(node->_data.first)) {
+			_filter = NULL;
+			return false;
 		}
-		iterator++;
 	}
-	return false;
+	return true;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+std::vector<typename MtmMap mapTemplate::iterator> MtmMap<KeyType, ValueType,
+CompareFunction>::splitPoints(size_t chunks) const {
+	std::lock_guard<std::mutex> lock(_splitsMutex);
+	if(chunks < 1) {
+		chunks = 1;
+	}
+	if(_splits.empty() || _splitsChunks != chunks) {
+		// every stride-th node starts a run, the size of the list being
+		// unknown the stride doubles whenever there are chunks runs already
+		_splits.clear();
+		_splitsChunks = chunks;
+		size_t stride = 1;
+		size_t position = 0;
+		for(Node* node = _head; node; node = node->_next, position++) {
+			if(position % stride != 0) {
+				continue;
+			}
+			if(_splits.size() == chunks) {
+				for(size_t i = 0; 2 * i < _splits.size(); i++) {
+					_splits[i] = _splits[2 * i];
+				}
+				_splits.resize((_splits.size() + 1) / 2);
+				stride *= 2;
+				if(position % stride != 0) {
+					continue;
+				}
+			}
+			_splits.push_back(node);
+		}
+	}
+	std::vector<iterator> splits;
+	for(size_t i = 0; i < _splits.size(); i++) {
+		splits.push_back(iterator(this, _splits[i]));
+	}
+	splits.push_back(end());
+	return splits;
 }
 
 template<class KeyType, class ValueType, class CompareFunction>
@@ -0,0 +1,786 @@
+/**
+ * Microbenchmarks of the C++ containers under configurable workloads.
+ *
+ * Build from the repository root (the fixtures directory provides the Troll,
+ * Team, Group and exception types the headers expect from their projects):
+ *
+ *   g++ -std=c++17 -O2 -DNDEBUG -I. -Ibenchmark/fixtures \
+ *       benchmark/benchmark.cpp -o container_benchmark -pthread
+ *
+ * Each run fills a container with size keys out of a key space of 2 * size
+ * (every other key, inserted in sorted or random order), then times ops
+ * operations: a read looks a key up, a write inserts the key if it is absent
+ * and removes it otherwise, so the container keeps about size keys. Keys are
+ * drawn uniformly or from a scrambled Zipfian distribution.
+ *
+ * Options (lists are comma separated, every combination is run):
+ *   --containers=tree,mtmmap,flat,art,lsm,disk,hash,unionfind,list,unrolled,
+ *                concurrent,concurrent_append
+ *                                  (or all)
+ *   --sizes=100,10000,1000000      10^2 up to 10^8
+ *   --ops=1000000                  timed operations per run
+ *   --keys=uniform,zipf            key distributions
+ *   --theta=0.99                   Zipfian skew
+ *   --reads=0.5,0.95               fractions of reads
+ *   --orders=sorted,random         fill orders
+ *   --seed=1
+ *   --label=name                   first column of the output, e.g. a commit
+ *   --out=results.csv              the default is the standard output
+ *   --threads=1,2,4                appending threads of concurrent_append
+ *   --max-linear=100000            largest size run on the containers whose
+ *                                  operations take linear time (mtmmap,
+ *                                  flat, list, unrolled, concurrent),
+ *                                  unless --force
+ *   --no-fork                      run in this process (peak RSS is then
+ *                                  cumulative)
+ *   --compare=old.csv,new.csv      prints the change of every run instead
+ *
+ * The output has one CSV row per run: ops/sec, the 50th, 90th, 99th and
+ * 99.9th percentiles and the maximum of ns/op, and the peak RSS of the
+ * process that ran it. Rows come in a fixed order, so the outputs of two
+ * commits can be diffed, or compared with --compare.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "troll.h"
+#include "tree.h"
+#include "MtmMap.h"
+#include "FlatMtmMap.h"
+#include "ArtMtmMap.h"
+#include "LsmMtmMap.h"
+#include "DiskMtmMap.h"
+#include "hash_table.h"
+#include "union_find.h"
+#include "list_cpp.h"
+#include "unrolled_list.h"
+#include "concurrent_list.h"
+
+namespace {
+
+struct Options {
+	std::vector<std::string> _containers;
+	std::vector<long> _sizes;
+	long _ops;
+	std::vector<std::string> _keys;
+	double _theta;
+	std::vector<double> _reads;
+	std::vector<std::string> _orders;
+	std::vector<int> _threads;
+	unsigned long _seed;
+	std::string _label;
+	std::string _out;
+	long _maxLinear;
+	bool _force;
+	bool _fork;
+	std::string _compare;
+};
+
+struct Result {
+	double _opsPerSec;
+	double _p50;
+	double _p90;
+	double _p99;
+	double _p999;
+	double _max;
+	long _peakRssKb;
+	long _checksum;
+};
+
+/**
+ * Draws integers in [0, n) following Zipf's law with parameter theta, by
+ * the method of Gray et al. ("Quickly generating billion-record synthetic
+ * databases"), as in YCSB. The ranks are scrambled by a hash so that the hot
+ * keys are spread over the key space rather than being the smallest keys.
+ */
+class ZipfianGenerator {
+	uint64_t _n;
+	double _theta;
+	double _alpha;
+	double _zetan;
+	double _eta;
+public:
+	ZipfianGenerator(uint64_t n, double theta) : _n(n), _theta(theta) {
+		double zeta2 = 0;
+		_zetan = 0;
+		for(uint64_t i = 1; i <= n; i++) {
+			_zetan += 1.0 / std::pow((double)i, theta);
+			if(i == 2) {
+				zeta2 = _zetan;
+			}
+		}
+		_alpha = 1.0 / (1.0 - theta);
+		_eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta2 / _zetan);
+	}
+	template<class Engine>
+	uint64_t operator()(Engine& engine) {
+		double u = std::uniform_real_distribution<double>(0, 1)(engine);
+		double uz = u * _zetan;
+		uint64_t rank;
+		if(uz < 1.0) {
+			rank = 0;
+		} else if(uz < 1.0 + std::pow(0.5, _theta)) {
+			rank = 1;
+		} else {
+			rank = (uint64_t)(_n * std::pow(_eta * u - _eta + 1, _alpha));
+		}
+		if(rank >= _n) {
+			rank = _n - 1;
+		}
+		// FNV-1a of the rank
+		uint64_t hash = 14695981039346656037ULL;
+		for(int i = 0; i < 8; i++) {
+			hash = (hash ^ ((rank >> (8 * i)) & 0xff)) * 1099511628211ULL;
+		}
+		return hash % _n;
+	}
+};
+
+struct IntCompare {
+	int operator()(const int& a, const int& b) const {
+		return (a > b) - (a < b);
+	}
+};
+
+/**
+ * A container under test: fill inserts the initial keys, contains and
+ * toggle are the timed read and write operations.
+ */
+class Subject {
+public:
+	virtual ~Subject() {}
+	virtual void fill(const std::vector<int>& keys) = 0;
+	virtual bool contains(int key) = 0;
+	virtual void toggle(int key) = 0;
+};
+
+class TreeSubject : public Subject {
+	Tree<int, IntCompare> _tree;
+public:
+	void fill(const std::vector<int>& keys) {
+		for(size_t i = 0; i < keys.size(); i++) {
+			int key = keys[i];
+			_tree.insert(key);
+		}
+	}
+	bool contains(int key) {
+		return _tree.find(key) != NULL;
+	}
+	void toggle(int key) {
+		if(_tree.find(key)) {
+			_tree.remove(key);
+		} else {
+			_tree.insert(key);
+		}
+	}
+};
+
+template<class Map>
+class MapSubject : public Subject {
+protected:
+	Map& _map;
+public:
+	MapSubject(Map& map) : _map(map) {}
+	void fill(const std::vector<int>& keys) {
+		for(size_t i = 0; i < keys.size(); i++) {
+			_map.insert(keys[i], keys[i]);
+		}
+	}
+	bool contains(int key) {
+		return _map.containsKey(key);
+	}
+	void toggle(int key) {
+		if(_map.containsKey(key)) {
+			_map.remove(key);
+		} else {
+			_map.insert(key, key);
+		}
+	}
+};
+
+class MtmMapSubject : public MapSubject<mtm::MtmMap<int, int> > {
+	mtm::MtmMap<int, int> _storage;
+public:
+	MtmMapSubject() : MapSubject<mtm::MtmMap<int, int> >(_storage), _storage(0) {}
+	/**
+	 * Inserting the largest keys first makes every insert O(1), so that the
+	 * fill doesn't dominate the run; the timed operations are unaffected.
+	 */
+	void fill(const std::vector<int>& keys) {
+		std::vector<int> sorted(keys);
+		std::sort(sorted.begin(), sorted.end());
+		for(size_t i = sorted.size(); i > 0; i--) {
+			_map.insert(sorted[i - 1], sorted[i - 1]);
+		}
+	}
+};
+
+class FlatSubject : public MapSubject<mtm::FlatMtmMap<int, int> > {
+	mtm::FlatMtmMap<int, int> _storage;
+public:
+	FlatSubject() : MapSubject<mtm::FlatMtmMap<int, int> >(_storage), _storage(0) {}
+	void fill(const std::vector<int>& keys) {
+		std::vector<std::pair<int, int> > batch;
+		for(size_t i = 0; i < keys.size(); i++) {
+			batch.push_back(std::make_pair(keys[i], keys[i]));
+		}
+		_map.insertBatch(batch);
+	}
+};
+
+class ArtSubject : public MapSubject<mtm::ArtMtmMap<int, int> > {
+	mtm::ArtMtmMap<int, int> _storage;
+public:
+	ArtSubject() : MapSubject<mtm::ArtMtmMap<int, int> >(_storage), _storage(0) {}
+};
+
+class LsmSubject : public MapSubject<mtm::LsmMtmMap<int, int> > {
+	mtm::LsmMtmMap<int, int> _storage;
+public:
+	LsmSubject() : MapSubject<mtm::LsmMtmMap<int, int> >(_storage), _storage(0) {}
+};
+
+class DiskSubject : public MapSubject<mtm::DiskMtmMap<int, int> > {
+	std::string _path;
+	mtm::DiskMtmMap<int, int> _storage;
+public:
+	DiskSubject(const std::string& path)
+	: MapSubject<mtm::DiskMtmMap<int, int> >(_storage), _path(path),
+	  _storage((std::remove(path.c_str()), path.c_str()), 0, 4096) {}
+	~DiskSubject() {
+		std::remove(_path.c_str());
+	}
+};
+
+class HashTableSubject : public Subject {
+	std::unique_ptr<HashTable> _table;
+	std::vector<Troll> _trolls;
+public:
+	HashTableSubject(long keySpace) : _table(new HashTable()), _trolls(keySpace) {
+		for(long i = 0; i < keySpace; i++) {
+			_trolls[i]._TrollID = (int)i;
+		}
+	}
+	~HashTableSubject() {
+		for(size_t i = 0; i < _trolls.size(); i++) {
+			_trolls[i].unlink();
+		}
+	}
+	void fill(const std::vector<int>& keys) {
+		for(size_t i = 0; i < keys.size(); i++) {
+			_table->insert(&_trolls[keys[i]]);
+		}
+	}
+	bool contains(int key) {
+		return _table->search(key) != NULL;
+	}
+	void toggle(int key) {
+		Troll* troll = _table->search(key);
+		if(troll) {
+			_table->remove(troll);
+		} else {
+			_table->insert(&_trolls[key]);
+		}
+	}
+};
+
+/**
+ * Reads are Find of the key's team, writes unite it with another team
+ * unless they are already in the same group. Filling does nothing, the
+ * structure starts with one group per team of the key space.
+ */
+class UnionFindSubject : public Subject {
+	UnionFind _unionFind;
+	Team* rootOf(int team) {
+		Team* node = _unionFind._teams[team];
+		while(node->_father) {
+			node = node->_father;
+		}
+		return node;
+	}
+public:
+	UnionFindSubject(long keySpace) : _unionFind((int)keySpace) {}
+	void fill(const std::vector<int>&) {}
+	bool contains(int key) {
+		return _unionFind.Find(key) != NULL;
+	}
+	void toggle(int key) {
+		int other = (int)(((long)key * 7919 + 1) % _unionFind._size);
+		if(rootOf(key) != rootOf(other)) {
+			_unionFind.Union(key, other);
+		}
+	}
+};
+
+/**
+ * The lists only append and iterate: reads scan for the key, writes append
+ * it.
+ */
+template<class ListType>
+class ListSubject : public Subject {
+	ListType _list;
+public:
+	void fill(const std::vector<int>& keys) {
+		for(size_t i = 0; i < keys.size(); i++) {
+			_list.insert(keys[i]);
+		}
+	}
+	bool contains(int key) {
+		for(typename ListType::iterator it = _list.begin(); it != _list.end(); ++it) {
+			if(*it == key) {
+				return true;
+			}
+		}
+		return false;
+	}
+	void toggle(int key) {
+		_list.insert(key);
+	}
+};
+
+bool isLinear(const std::string& container) {
+	return container == "mtmmap" || container == "flat" || container == "list"
+			|| container == "unrolled" || container == "concurrent";
+}
+
+std::unique_ptr<Subject> makeSubject(const std::string& container, long keySpace) {
+	if(container == "tree") return std::unique_ptr<Subject>(new TreeSubject());
+	if(container == "mtmmap") return std::unique_ptr<Subject>(new MtmMapSubject());
+	if(container == "flat") return std::unique_ptr<Subject>(new FlatSubject());
+	if(container == "art") return std::unique_ptr<Subject>(new ArtSubject());
+	if(container == "lsm") return std::unique_ptr<Subject>(new LsmSubject());
+	if(container == "disk") {
+		return std::unique_ptr<Subject>(new DiskSubject(
+				"container_benchmark." + std::to_string(getpid()) + ".db"));
+	}
+	if(container == "hash") return std::unique_ptr<Subject>(new HashTableSubject(keySpace));
+	if(container == "unionfind") return std::unique_ptr<Subject>(new UnionFindSubject(keySpace));
+	if(container == "list") return std::unique_ptr<Subject>(new ListSubject<List<int> >());
+	if(container == "unrolled") {
+		return std::unique_ptr<Subject>(new ListSubject<UnrolledList<int> >());
+	}
+	if(container == "concurrent" || container == "concurrent_append") {
+		return std::unique_ptr<Subject>(new ListSubject<ConcurrentList<int> >());
+	}
+	return std::unique_ptr<Subject>();
+}
+
+struct Run {
+	std::string _container;
+	long _size;
+	std::string _keys;
+	double _reads;
+	std::string _order;
+	// the appending threads of concurrent_append
+	int _threads;
+};
+
+double percentile(const std::vector<uint32_t>& sorted, double fraction) {
+	if(sorted.empty()) {
+		return 0;
+	}
+	size_t index = (size_t)(fraction * (sorted.size() - 1));
+	return sorted[index];
+}
+
+/**
+ * The result of ops operations that took seconds in all, whose latencies
+ * were recorded one by one.
+ */
+Result summarize(std::vector<uint32_t>& latencies, long ops, double seconds,
+		long checksum) {
+	std::sort(latencies.begin(), latencies.end());
+	Result result;
+	result._opsPerSec = seconds > 0 ? ops / seconds : 0;
+	result._p50 = percentile(latencies, 0.50);
+	result._p90 = percentile(latencies, 0.90);
+	result._p99 = percentile(latencies, 0.99);
+	result._p999 = percentile(latencies, 0.999);
+	result._max = latencies.empty() ? 0 : latencies.back();
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	result._peakRssKb = usage.ru_maxrss;
+	result._checksum = checksum;
+	return result;
+}
+
+/**
+ * Fills a ConcurrentList with size keys, then has run._threads threads
+ * append ops keys to it at once, each timing its own appends. The time of
+ * the run is from the first append to the last one, across the threads.
+ */
+Result measureAppends(const Options& options, const Run& run) {
+	typedef std::chrono::steady_clock Clock;
+	ConcurrentList<int> list;
+	for(long key = 0; key < run._size; key++) {
+		list.insert((int)key);
+	}
+	int threads = run._threads;
+	std::vector<std::vector<uint32_t> > latencies(threads);
+	std::vector<Clock::time_point> starts(threads), ends(threads);
+	std::atomic<int> ready(0);
+	std::vector<std::thread> workers;
+	for(int t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&, t]() {
+			long first = options._ops * t / threads;
+			long last = options._ops * (t + 1) / threads;
+			std::vector<uint32_t>& mine = latencies[t];
+			mine.resize(last - first);
+			ready++;
+			while(ready.load() < threads) {
+				std::this_thread::yield();
+			}
+			Clock::time_point before = Clock::now();
+			starts[t] = before;
+			for(long i = first; i < last; i++) {
+				list.insert((int)(run._size + i));
+				Clock::time_point after = Clock::now();
+				mine[i - first] = (uint32_t)std::min<int64_t>(UINT32_MAX,
+						std::chrono::duration_cast<std::chrono::nanoseconds>(
+								after - before).count());
+				before = after;
+			}
+			ends[t] = before;
+		}));
+	}
+	for(int t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+	std::vector<uint32_t> all;
+	all.reserve(options._ops);
+	for(int t = 0; t < threads; t++) {
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+	}
+	double seconds = std::chrono::duration<double>(
+			*std::max_element(ends.begin(), ends.end())
+			- *std::min_element(starts.begin(), starts.end())).count();
+	return summarize(all, options._ops, seconds, list.size());
+}
+
+Result measure(const Options& options, const Run& run) {
+	if(run._container == "concurrent_append") {
+		return measureAppends(options, run);
+	}
+	long keySpace = 2 * run._size;
+	std::mt19937_64 engine(options._seed);
+	std::vector<int> initial;
+	initial.reserve(run._size);
+	for(long key = 0; key < keySpace; key += 2) {
+		initial.push_back((int)key);
+	}
+	if(run._order == "random") {
+		std::shuffle(initial.begin(), initial.end(), engine);
+	}
+	std::unique_ptr<Subject> subject = makeSubject(run._container, keySpace);
+	subject->fill(initial);
+	std::vector<int>().swap(initial);
+
+	// the operations are drawn before the timing starts
+	std::vector<int> keys(options._ops);
+	std::vector<bool> reads(options._ops);
+	std::bernoulli_distribution isRead(run._reads);
+	if(run._keys == "zipf") {
+		ZipfianGenerator zipf(keySpace, options._theta);
+		for(long i = 0; i < options._ops; i++) {
+			keys[i] = (int)zipf(engine);
+		}
+	} else {
+		std::uniform_int_distribution<long> uniform(0, keySpace - 1);
+		for(long i = 0; i < options._ops; i++) {
+			keys[i] = (int)uniform(engine);
+		}
+	}
+	for(long i = 0; i < options._ops; i++) {
+		reads[i] = isRead(engine);
+	}
+
+	typedef std::chrono::steady_clock Clock;
+	std::vector<uint32_t> latencies(options._ops);
+	long checksum = 0;
+	Clock::time_point start = Clock::now();
+	Clock::time_point before = start;
+	for(long i = 0; i < options._ops; i++) {
+		if(reads[i]) {
+			checksum += subject->contains(keys[i]);
+		} else {
+			subject->toggle(keys[i]);
+		}
+		Clock::time_point after = Clock::now();
+		latencies[i] = (uint32_t)std::min<int64_t>(UINT32_MAX,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+		before = after;
+	}
+	double seconds = std::chrono::duration<double>(before - start).count();
+	subject.reset();
+	return summarize(latencies, options._ops, seconds, checksum);
+}
+
+/**
+ * Measures run in a child process, so that its peak RSS is its own.
+ * Returns false if the child failed.
+ */
+bool measureIsolated(const Options& options, const Run& run, Result* result) {
+	if(!options._fork) {
+		*result = measure(options, run);
+		return true;
+	}
+	int channel[2];
+	if(pipe(channel) != 0) {
+		return false;
+	}
+	std::fflush(NULL);
+	pid_t child = fork();
+	if(child < 0) {
+		close(channel[0]);
+		close(channel[1]);
+		return false;
+	}
+	if(child == 0) {
+		close(channel[0]);
+		Result measured = measure(options, run);
+		ssize_t written = write(channel[1], &measured, sizeof(measured));
+		_exit(written == (ssize_t)sizeof(measured) ? 0 : 1);
+	}
+	close(channel[1]);
+	ssize_t received = read(channel[0], result, sizeof(*result));
+	close(channel[0]);
+	int status = 0;
+	waitpid(child, &status, 0);
+	return received == (ssize_t)sizeof(*result) && WIFEXITED(status)
+			&& WEXITSTATUS(status) == 0;
+}
+
+std::vector<std::string> split(const std::string& list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while(std::getline(stream, item, ',')) {
+		if(!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+const char* CSV_HEADER = "label,container,size,ops,keys,theta,reads,order,seed,"
+		"ops_per_sec,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,peak_rss_kb";
+
+/**
+ * Prints, for every run found in both files, the ratio of the new ops/sec
+ * and p99 to the old ones.
+ */
+int compare(const std::string& oldPath, const std::string& newPath) {
+	std::map<std::string, std::vector<std::string> > old;
+	std::ifstream oldFile(oldPath.c_str());
+	std::ifstream newFile(newPath.c_str());
+	if(!oldFile || !newFile) {
+		std::fprintf(stderr, "can't read %s or %s\n", oldPath.c_str(), newPath.c_str());
+		return 1;
+	}
+	std::string line;
+	while(std::getline(oldFile, line)) {
+		std::vector<std::string> fields = split(line);
+		if(fields.size() < 16 || fields[0] == "label") continue;
+		std::string key;
+		for(int i = 1; i <= 8; i++) key += fields[i] + ",";
+		old[key] = fields;
+	}
+	std::printf("container,size,ops,keys,theta,reads,order,seed,"
+			"old_ops_per_sec,new_ops_per_sec,throughput_ratio,p99_ratio\n");
+	while(std::getline(newFile, line)) {
+		std::vector<std::string> fields = split(line);
+		if(fields.size() < 16 || fields[0] == "label") continue;
+		std::string key;
+		for(int i = 1; i <= 8; i++) key += fields[i] + ",";
+		std::map<std::string, std::vector<std::string> >::iterator found = old.find(key);
+		if(found == old.end()) continue;
+		double oldOps = std::atof(found->second[9].c_str());
+		double newOps = std::atof(fields[9].c_str());
+		double oldP99 = std::atof(found->second[12].c_str());
+		double newP99 = std::atof(fields[12].c_str());
+		std::printf("%s%.0f,%.0f,%.3f,%.3f\n", key.c_str(), oldOps, newOps,
+				oldOps > 0 ? newOps / oldOps : 0, oldP99 > 0 ? newP99 / oldP99 : 0);
+	}
+	return 0;
+}
+
+bool parse(int argc, char** argv, Options* options) {
+	options->_containers = split("tree,mtmmap,flat,art,lsm,disk,hash,unionfind,list,unrolled,"
+			"concurrent,concurrent_append");
+	options->_sizes.push_back(100);
+	options->_sizes.push_back(10000);
+	options->_sizes.push_back(1000000);
+	options->_ops = 1000000;
+	options->_keys = split("uniform,zipf");
+	options->_theta = 0.99;
+	options->_reads.push_back(0.5);
+	options->_reads.push_back(0.95);
+	options->_orders = split("sorted,random");
+	options->_threads.push_back(1);
+	options->_threads.push_back(2);
+	options->_threads.push_back(4);
+	options->_seed = 1;
+	options->_label = "run";
+	options->_maxLinear = 100000;
+	options->_force = false;
+	options->_fork = true;
+	for(int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		size_t equals = argument.find('=');
+		std::string name = argument.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : argument.substr(equals + 1);
+		if(name == "--containers") {
+			options->_containers = value == "all" ? options->_containers : split(value);
+		} else if(name == "--sizes") {
+			options->_sizes.clear();
+			std::vector<std::string> sizes = split(value);
+			for(size_t j = 0; j < sizes.size(); j++) {
+				options->_sizes.push_back(std::atol(sizes[j].c_str()));
+			}
+		} else if(name == "--ops") {
+			options->_ops = std::atol(value.c_str());
+		} else if(name == "--keys") {
+			options->_keys = split(value);
+		} else if(name == "--theta") {
+			options->_theta = std::atof(value.c_str());
+		} else if(name == "--reads") {
+			options->_reads.clear();
+			std::vector<std::string> reads = split(value);
+			for(size_t j = 0; j < reads.size(); j++) {
+				options->_reads.push_back(std::atof(reads[j].c_str()));
+			}
+		} else if(name == "--orders") {
+			options->_orders = split(value);
+		} else if(name == "--threads") {
+			options->_threads.clear();
+			std::vector<std::string> threads = split(value);
+			for(size_t j = 0; j < threads.size(); j++) {
+				options->_threads.push_back(std::max(1, std::atoi(threads[j].c_str())));
+			}
+		} else if(name == "--seed") {
+			options->_seed = std::strtoul(value.c_str(), NULL, 10);
+		} else if(name == "--label") {
+			options->_label = value;
+		} else if(name == "--out") {
+			options->_out = value;
+		} else if(name == "--max-linear") {
+			options->_maxLinear = std::atol(value.c_str());
+		} else if(name == "--force") {
+			options->_force = true;
+		} else if(name == "--no-fork") {
+			options->_fork = false;
+		} else if(name == "--compare") {
+			options->_compare = value;
+		} else {
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+	Options options;
+	if(!parse(argc, argv, &options)) {
+		return 1;
+	}
+	if(!options._compare.empty()) {
+		std::vector<std::string> files = split(options._compare);
+		if(files.size() != 2) {
+			std::fprintf(stderr, "--compare takes two files\n");
+			return 1;
+		}
+		return compare(files[0], files[1]);
+	}
+	FILE* out = stdout;
+	if(!options._out.empty()) {
+		out = std::fopen(options._out.c_str(), "w");
+		if(!out) {
+			std::fprintf(stderr, "can't write %s\n", options._out.c_str());
+			return 1;
+		}
+	}
+	std::fprintf(out, "%s\n", CSV_HEADER);
+	for(size_t c = 0; c < options._containers.size(); c++) {
+		const std::string& container = options._containers[c];
+		if(!makeSubject(container, 2)) {
+			std::fprintf(stderr, "unknown container %s\n", container.c_str());
+			return 1;
+		}
+		for(size_t s = 0; s < options._sizes.size(); s++) {
+			long size = options._sizes[s];
+			if(size < 1 || 2 * size > INT32_MAX) {
+				std::fprintf(stderr, "size %ld out of range\n", size);
+				continue;
+			}
+			if(isLinear(container) && size > options._maxLinear && !options._force) {
+				std::fprintf(stderr, "skipping %s of size %ld (see --max-linear)\n",
+						container.c_str(), size);
+				continue;
+			}
+			std::vector<Run> runs;
+			if(container == "concurrent_append") {
+				// only the amount of appending threads varies
+				for(size_t t = 0; t < options._threads.size(); t++) {
+					Run run = { container, size, "none", 0, "none", options._threads[t] };
+					runs.push_back(run);
+				}
+			}
+			for(size_t k = 0; runs.empty() && k < options._keys.size(); k++) {
+				for(size_t r = 0; r < options._reads.size(); r++) {
+					for(size_t o = 0; o < options._orders.size(); o++) {
+						Run run = { container, size, options._keys[k],
+								options._reads[r], options._orders[o], 1 };
+						runs.push_back(run);
+					}
+				}
+			}
+			for(size_t i = 0; i < runs.size(); i++) {
+				const Run& run = runs[i];
+				Result result;
+				if(!measureIsolated(options, run, &result)) {
+					std::fprintf(stderr, "%s of size %ld failed\n",
+							container.c_str(), size);
+					continue;
+				}
+				std::string name = container;
+				if(container == "concurrent_append") {
+					name += "/" + std::to_string(run._threads);
+				}
+				std::fprintf(out, "%s,%s,%ld,%ld,%s,%.2f,%.2f,%s,%lu,"
+						"%.0f,%.0f,%.0f,%.0f,%.0f,%.0f,%ld\n",
+						options._label.c_str(), name.c_str(), size,
+						options._ops, run._keys.c_str(), options._theta,
+						run._reads, run._order.c_str(), options._seed,
+						result._opsPerSec, result._p50, result._p90,
+						result._p99, result._p999, result._max,
+						result._peakRssKb);
+				std::fflush(out);
+			}
+		}
+	}
+	if(out != stdout) {
+		std::fclose(out);
+	}
+	return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef EXCEPTIONS_H_
+#define EXCEPTIONS_H_
+
+#include <exception>
+
+/**
+ * Stand-in for the exceptions of the project MtmMap.h was written for.
+ */
+namespace mtm {
+class MapElementNotFoundException : public std::exception {};
+}
+
+#endif /* EXCEPTIONS_H_ */
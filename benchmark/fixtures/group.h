@@ -0,0 +1,19 @@
+#ifndef GROUP_H_
+#define GROUP_H_
+
+#include "team.h"
+
+/**
+ * Stand-in for the Group of the project union_find.h was written for: the
+ * data kept for the root of each union-find tree.
+ */
+class Group {
+public:
+	Team* _root;
+	int _size;
+	int _trolls_number;
+
+	Group(Team* root) : _root(root), _size(1), _trolls_number(0) {}
+};
+
+#endif /* GROUP_H_ */
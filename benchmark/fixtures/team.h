@@ -0,0 +1,19 @@
+#ifndef TEAM_H_
+#define TEAM_H_
+
+#include <cstdlib>
+
+/**
+ * Stand-in for the Team of the project union_find.h was written for: a node
+ * of the union-find forest.
+ */
+class Team {
+public:
+	int _number;
+	int _group_name;
+	Team* _father;
+
+	Team(int number) : _number(number), _group_name(number), _father(NULL) {}
+};
+
+#endif /* TEAM_H_ */
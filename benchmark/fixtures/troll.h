@@ -0,0 +1,16 @@
+#ifndef TROLL_H_
+#define TROLL_H_
+
+#include "intrusive_list.h"
+
+/**
+ * Stand-in for the Troll of the project hash_table.h was written for.
+ */
+class Troll : public IntrusiveListHook<> {
+public:
+	int _TrollID;
+
+	Troll(int TrollID = 0) : _TrollID(TrollID) {}
+};
+
+#endif /* TROLL_H_ */
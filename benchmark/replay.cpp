@@ -0,0 +1,556 @@
+/**
+ * Replays a trace recorded by TracedMap or TracedHashTable (see trace.h)
+ * against every backend that can hold it, and reports the throughput and
+ * latency of each.
+ *
+ * Build from the repository root, like benchmark.cpp:
+ *
+ *   g++ -std=c++17 -O2 -DNDEBUG -I. -Ibenchmark/fixtures \
+ *       benchmark/replay.cpp -o trace_replay -pthread
+ *
+ * Usage: trace_replay <trace> [--backends=name,...] [--out=results.csv]
+ *
+ * Map traces (keys and values of 4 or 8 bytes, replayed as integers) run on
+ * mtmmap, flat, art, lsm, disk, tree and std::map. HashTable traces run on
+ * chaining (HashTable itself), open-addressing (a linear probing table of
+ * Trolls that is kept here as a candidate) and std::unordered_map.
+ *
+ * The whole trace is loaded before the replays, which time each operation.
+ * The output has one CSV row per backend: ops/sec, the 50th, 99th and 99.9th
+ * percentiles and the maximum of ns/op, and a digest of what the reads
+ * found. Backends that behave the same have the same digest.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <unistd.h>
+
+#include "troll.h"
+#include "trace.h"
+#include "tree.h"
+#include "MtmMap.h"
+#include "FlatMtmMap.h"
+#include "ArtMtmMap.h"
+#include "LsmMtmMap.h"
+#include "DiskMtmMap.h"
+#include "hash_table.h"
+
+namespace {
+
+std::vector<std::string> split(const std::string& list) {
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+	while(std::getline(stream, item, ',')) {
+		if(!item.empty()) {
+			items.push_back(item);
+		}
+	}
+	return items;
+}
+
+struct Measurement {
+	double _opsPerSec;
+	double _p50;
+	double _p99;
+	double _p999;
+	double _max;
+	uint64_t _digest;
+};
+
+/**
+ * Times each call of step(i) for i in [0, count), step returns what the
+ * operation observed, which is folded into the digest.
+ */
+template<class Step>
+Measurement timeReplay(size_t count, Step step) {
+	typedef std::chrono::steady_clock Clock;
+	std::vector<uint32_t> latencies(count);
+	uint64_t digest = 14695981039346656037ULL;
+	Clock::time_point start = Clock::now();
+	Clock::time_point before = start;
+	for(size_t i = 0; i < count; i++) {
+		digest = (digest ^ step(i)) * 1099511628211ULL;
+		Clock::time_point after = Clock::now();
+		latencies[i] = (uint32_t)std::min<int64_t>(UINT32_MAX,
+				std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count());
+		before = after;
+	}
+	double seconds = std::chrono::duration<double>(before - start).count();
+	std::sort(latencies.begin(), latencies.end());
+	Measurement measurement;
+	measurement._opsPerSec = seconds > 0 ? count / seconds : 0;
+	measurement._p50 = count ? latencies[(size_t)(0.50 * (count - 1))] : 0;
+	measurement._p99 = count ? latencies[(size_t)(0.99 * (count - 1))] : 0;
+	measurement._p999 = count ? latencies[(size_t)(0.999 * (count - 1))] : 0;
+	measurement._max = count ? latencies.back() : 0;
+	measurement._digest = digest;
+	return measurement;
+}
+
+void report(FILE* out, const char* trace, const std::string& backend,
+		size_t operations, const Measurement& measurement) {
+	std::fprintf(out, "%s,%s,%zu,%.0f,%.0f,%.0f,%.0f,%.0f,%016llx\n", trace,
+			backend.c_str(), operations, measurement._opsPerSec, measurement._p50,
+			measurement._p99, measurement._p999, measurement._max,
+			(unsigned long long)measurement._digest);
+	std::fflush(out);
+}
+
+template<class KeyType, class ValueType>
+struct MapRecord {
+	TraceOperation _operation;
+	KeyType _key;
+	ValueType _value;
+};
+
+/**
+ * The map operations of a trace, on one backend. find and remove return
+ * whether the key was there, iterate the amount of elements.
+ */
+template<class KeyType, class ValueType>
+class MapBackend {
+public:
+	virtual ~MapBackend() {}
+	virtual void insert(const KeyType& key, const ValueType& value) = 0;
+	virtual bool find(const KeyType& key) = 0;
+	virtual bool remove(const KeyType& key) = 0;
+	virtual uint64_t iterate() = 0;
+};
+
+/**
+ * A backend with the API of MtmMap.
+ */
+template<class KeyType, class ValueType, class Map>
+class MtmMapBackend : public MapBackend<KeyType, ValueType> {
+protected:
+	Map* _map;
+public:
+	MtmMapBackend(Map* map = NULL) : _map(map) {}
+	~MtmMapBackend() {
+		delete _map;
+	}
+	void insert(const KeyType& key, const ValueType& value) {
+		_map->insert(key, value);
+	}
+	bool find(const KeyType& key) {
+		return _map->find(key) != _map->end();
+	}
+	bool remove(const KeyType& key) {
+		try {
+			_map->remove(key);
+			return true;
+		} catch(const mtm::MapElementNotFoundException&) {
+			return false;
+		}
+	}
+	uint64_t iterate() {
+		uint64_t count = 0;
+		for(typename Map::iterator it = _map->begin(); it != _map->end(); ++it) {
+			count++;
+		}
+		return count;
+	}
+};
+
+template<class KeyType, class ValueType>
+class DiskBackend : public MtmMapBackend<KeyType, ValueType,
+		mtm::DiskMtmMap<KeyType, ValueType> > {
+	std::string _path;
+public:
+	DiskBackend() : _path("trace_replay." + std::to_string(getpid()) + ".db") {
+		std::remove(_path.c_str());
+		this->_map = new mtm::DiskMtmMap<KeyType, ValueType>(_path.c_str(),
+				ValueType(), 4096);
+	}
+	~DiskBackend() {
+		delete this->_map;
+		this->_map = NULL;
+		std::remove(_path.c_str());
+	}
+};
+
+/**
+ * A Tree of key and value entries, searched by key.
+ */
+template<class KeyType, class ValueType>
+class TreeBackend : public MapBackend<KeyType, ValueType> {
+	struct Entry {
+		KeyType _key;
+		ValueType _value;
+	};
+	struct EntryCompare {
+		typedef void is_transparent;
+		int operator()(const KeyType& key, const Entry& entry) const {
+			return (key > entry._key) - (key < entry._key);
+		}
+		int operator()(const Entry& a, const Entry& b) const {
+			return (*this)(a._key, b);
+		}
+	};
+	Tree<Entry, EntryCompare> _tree;
+	static uint64_t count(Node<Entry>* node) {
+		if(!node) return 0;
+		return count(node->_left_son) + 1 + count(node->_right_son);
+	}
+public:
+	void insert(const KeyType& key, const ValueType& value) {
+		Node<Entry>* node = _tree.find(key);
+		if(node) {
+			node->_value._value = value;
+			return;
+		}
+		Entry entry = { key, value };
+		_tree.insert(entry);
+	}
+	bool find(const KeyType& key) {
+		return _tree.find(key) != NULL;
+	}
+	bool remove(const KeyType& key) {
+		if(!_tree.find(key)) {
+			return false;
+		}
+		_tree.remove(key);
+		return true;
+	}
+	uint64_t iterate() {
+		return count(_tree._root);
+	}
+};
+
+template<class KeyType, class ValueType>
+class StdMapBackend : public MapBackend<KeyType, ValueType> {
+	std::map<KeyType, ValueType> _map;
+public:
+	void insert(const KeyType& key, const ValueType& value) {
+		_map[key] = value;
+	}
+	bool find(const KeyType& key) {
+		return _map.find(key) != _map.end();
+	}
+	bool remove(const KeyType& key) {
+		return _map.erase(key) > 0;
+	}
+	uint64_t iterate() {
+		uint64_t count = 0;
+		for(typename std::map<KeyType, ValueType>::iterator it = _map.begin();
+				it != _map.end(); ++it) {
+			count++;
+		}
+		return count;
+	}
+};
+
+template<class KeyType, class ValueType>
+std::unique_ptr<MapBackend<KeyType, ValueType> > makeMapBackend(const std::string& name) {
+	typedef MapBackend<KeyType, ValueType> Backend;
+	if(name == "mtmmap") {
+		return std::unique_ptr<Backend>(new MtmMapBackend<KeyType, ValueType,
+				mtm::MtmMap<KeyType, ValueType> >(
+						new mtm::MtmMap<KeyType, ValueType>(ValueType())));
+	}
+	if(name == "flat") {
+		return std::unique_ptr<Backend>(new MtmMapBackend<KeyType, ValueType,
+				mtm::FlatMtmMap<KeyType, ValueType> >(
+						new mtm::FlatMtmMap<KeyType, ValueType>(ValueType())));
+	}
+	if(name == "art") {
+		return std::unique_ptr<Backend>(new MtmMapBackend<KeyType, ValueType,
+				mtm::ArtMtmMap<KeyType, ValueType> >(
+						new mtm::ArtMtmMap<KeyType, ValueType>(ValueType())));
+	}
+	if(name == "lsm") {
+		return std::unique_ptr<Backend>(new MtmMapBackend<KeyType, ValueType,
+				mtm::LsmMtmMap<KeyType, ValueType> >(
+						new mtm::LsmMtmMap<KeyType, ValueType>(ValueType())));
+	}
+	if(name == "disk") return std::unique_ptr<Backend>(new DiskBackend<KeyType, ValueType>());
+	if(name == "tree") return std::unique_ptr<Backend>(new TreeBackend<KeyType, ValueType>());
+	if(name == "std::map") return std::unique_ptr<Backend>(new StdMapBackend<KeyType, ValueType>());
+	return std::unique_ptr<Backend>();
+}
+
+template<class KeyType, class ValueType>
+int replayMap(TraceReader& reader, const char* trace,
+		const std::vector<std::string>& backends, FILE* out) {
+	std::vector<MapRecord<KeyType, ValueType> > records;
+	MapRecord<KeyType, ValueType> record;
+	while(reader.next(&record._operation, &record._key, &record._value)) {
+		records.push_back(record);
+	}
+	for(size_t b = 0; b < backends.size(); b++) {
+		std::unique_ptr<MapBackend<KeyType, ValueType> > backend =
+				makeMapBackend<KeyType, ValueType>(backends[b]);
+		if(!backend) {
+			std::fprintf(stderr, "%s can't replay a map trace\n", backends[b].c_str());
+			continue;
+		}
+		MapBackend<KeyType, ValueType>* map = backend.get();
+		Measurement measurement = timeReplay(records.size(), [&](size_t i) -> uint64_t {
+			const MapRecord<KeyType, ValueType>& current = records[i];
+			switch(current._operation) {
+			case TRACE_INSERT:
+				map->insert(current._key, current._value);
+				return 0;
+			case TRACE_FIND:
+				return map->find(current._key);
+			case TRACE_REMOVE:
+				return map->remove(current._key);
+			default:
+				return map->iterate();
+			}
+		});
+		report(out, trace, backends[b], records.size(), measurement);
+	}
+	return 0;
+}
+
+/**
+ * A linear probing table of Trolls by TrollID, with tombstones, doubling
+ * when three quarters of its slots are used.
+ */
+class OpenAddressingTable {
+	std::vector<Troll*> _slots;
+	size_t _used;
+	static Troll* tombstone() {
+		static Troll removed;
+		return &removed;
+	}
+	size_t slotOf(int TrollID) const {
+		return (size_t)((uint32_t)TrollID * 2654435769u) & (_slots.size() - 1);
+	}
+	void grow() {
+		std::vector<Troll*> old;
+		old.swap(_slots);
+		_slots.assign(old.size() * 2, NULL);
+		_used = 0;
+		for(size_t i = 0; i < old.size(); i++) {
+			if(old[i] && old[i] != tombstone()) {
+				insert(old[i]);
+			}
+		}
+	}
+public:
+	OpenAddressingTable() : _slots(16, NULL), _used(0) {}
+	void insert(Troll* troll) {
+		if(4 * (_used + 1) > 3 * _slots.size()) {
+			grow();
+		}
+		size_t slot = slotOf(troll->_TrollID);
+		while(_slots[slot] && _slots[slot] != tombstone()) {
+			slot = (slot + 1) & (_slots.size() - 1);
+		}
+		if(!_slots[slot]) {
+			_used++;
+		}
+		_slots[slot] = troll;
+	}
+	Troll* search(int TrollID) const {
+		size_t slot = slotOf(TrollID);
+		while(_slots[slot]) {
+			if(_slots[slot] != tombstone() && _slots[slot]->_TrollID == TrollID) {
+				return _slots[slot];
+			}
+			slot = (slot + 1) & (_slots.size() - 1);
+		}
+		return NULL;
+	}
+	void remove(Troll* troll) {
+		size_t slot = slotOf(troll->_TrollID);
+		while(_slots[slot]) {
+			if(_slots[slot] == troll) {
+				_slots[slot] = tombstone();
+				return;
+			}
+			slot = (slot + 1) & (_slots.size() - 1);
+		}
+	}
+};
+
+struct TrollRecord {
+	TraceOperation _operation;
+	int _TrollID;
+	Troll* _troll;
+};
+
+/**
+ * Replays operations on tables of Trolls. An insert of a Troll that is
+ * already in the table, or a remove of one that isn't, is skipped, as the
+ * table would be corrupted otherwise.
+ */
+template<class Table>
+Measurement replayTable(Table& table, std::vector<TrollRecord>& records,
+		std::vector<bool>& present, const std::vector<Troll>& trolls) {
+	present.assign(trolls.size(), false);
+	return timeReplay(records.size(), [&](size_t i) -> uint64_t {
+		TrollRecord& record = records[i];
+		size_t index = record._troll - &trolls[0];
+		switch(record._operation) {
+		case TRACE_INSERT:
+			if(!present[index]) {
+				table.insert(record._troll);
+				present[index] = true;
+			}
+			return 0;
+		case TRACE_FIND:
+			return table.search(record._TrollID) != NULL;
+		case TRACE_REMOVE:
+			if(present[index]) {
+				table.remove(record._troll);
+				present[index] = false;
+			}
+			return 0;
+		default:
+			return 0;
+		}
+	});
+}
+
+class StdHashTable {
+	std::unordered_map<int, Troll*> _map;
+public:
+	void insert(Troll* troll) {
+		_map[troll->_TrollID] = troll;
+	}
+	Troll* search(int TrollID) const {
+		std::unordered_map<int, Troll*>::const_iterator found = _map.find(TrollID);
+		return found == _map.end() ? NULL : found->second;
+	}
+	void remove(Troll* troll) {
+		_map.erase(troll->_TrollID);
+	}
+};
+
+int replayHashTable(TraceReader& reader, const char* trace,
+		const std::vector<std::string>& backends, FILE* out) {
+	std::vector<TrollRecord> records;
+	TrollRecord record;
+	record._troll = NULL;
+	while(reader.next(&record._operation, &record._TrollID, NULL)) {
+		records.push_back(record);
+	}
+	// one Troll per ID, made before the replays
+	std::vector<int> ids;
+	for(size_t i = 0; i < records.size(); i++) {
+		ids.push_back(records[i]._TrollID);
+	}
+	std::sort(ids.begin(), ids.end());
+	ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	std::vector<Troll> trolls(ids.size() > 0 ? ids.size() : 1);
+	for(size_t i = 0; i < ids.size(); i++) {
+		trolls[i]._TrollID = ids[i];
+	}
+	for(size_t i = 0; i < records.size(); i++) {
+		records[i]._troll = &trolls[std::lower_bound(ids.begin(), ids.end(),
+				records[i]._TrollID) - ids.begin()];
+	}
+	std::vector<bool> present;
+	for(size_t b = 0; b < backends.size(); b++) {
+		Measurement measurement;
+		if(backends[b] == "chaining") {
+			std::unique_ptr<HashTable> table(new HashTable());
+			measurement = replayTable(*table, records, present, trolls);
+			for(size_t i = 0; i < trolls.size(); i++) {
+				trolls[i].unlink();
+			}
+		} else if(backends[b] == "open-addressing") {
+			OpenAddressingTable table;
+			measurement = replayTable(table, records, present, trolls);
+		} else if(backends[b] == "std::unordered_map") {
+			StdHashTable table;
+			measurement = replayTable(table, records, present, trolls);
+		} else {
+			std::fprintf(stderr, "%s can't replay a hash table trace\n",
+					backends[b].c_str());
+			continue;
+		}
+		report(out, trace, backends[b], records.size(), measurement);
+	}
+	return 0;
+}
+
+template<class KeyType>
+int replayMapOfKey(TraceReader& reader, const char* trace,
+		const std::vector<std::string>& backends, FILE* out) {
+	switch(reader.header()._valueSize) {
+	case 4:
+		return replayMap<KeyType, int32_t>(reader, trace, backends, out);
+	case 8:
+		return replayMap<KeyType, int64_t>(reader, trace, backends, out);
+	}
+	std::fprintf(stderr, "values of %u bytes can't be replayed\n",
+			reader.header()._valueSize);
+	return 1;
+}
+
+}
+
+int main(int argc, char** argv) {
+	if(argc < 2) {
+		std::fprintf(stderr, "usage: %s <trace> [--backends=name,...] [--out=file]\n",
+				argv[0]);
+		return 1;
+	}
+	const char* trace = argv[1];
+	std::string backendList;
+	std::string outPath;
+	for(int i = 2; i < argc; i++) {
+		std::string argument = argv[i];
+		if(argument.compare(0, 11, "--backends=") == 0) {
+			backendList = argument.substr(11);
+		} else if(argument.compare(0, 6, "--out=") == 0) {
+			outPath = argument.substr(6);
+		} else {
+			std::fprintf(stderr, "unknown option %s\n", argv[i]);
+			return 1;
+		}
+	}
+	TraceReader reader;
+	if(!reader.open(trace)) {
+		std::fprintf(stderr, "%s is not a trace\n", trace);
+		return 1;
+	}
+	FILE* out = stdout;
+	if(!outPath.empty()) {
+		out = std::fopen(outPath.c_str(), "w");
+		if(!out) {
+			std::fprintf(stderr, "can't write %s\n", outPath.c_str());
+			return 1;
+		}
+	}
+	std::fprintf(out, "trace,backend,operations,ops_per_sec,p50_ns,p99_ns,"
+			"p999_ns,max_ns,digest\n");
+	int result = 1;
+	if(reader.header()._kind == TRACE_HASH_TABLE) {
+		std::vector<std::string> backends = split(backendList.empty() ?
+				"chaining,open-addressing,std::unordered_map" : backendList);
+		result = replayHashTable(reader, trace, backends, out);
+	} else {
+		std::vector<std::string> backends = split(backendList.empty() ?
+				"mtmmap,flat,art,lsm,disk,tree,std::map" : backendList);
+		switch(reader.header()._keySize) {
+		case 4:
+			result = replayMapOfKey<int32_t>(reader, trace, backends, out);
+			break;
+		case 8:
+			result = replayMapOfKey<int64_t>(reader, trace, backends, out);
+			break;
+		default:
+			std::fprintf(stderr, "keys of %u bytes can't be replayed\n",
+					reader.header()._keySize);
+		}
+	}
+	if(out != stdout) {
+		std::fclose(out);
+	}
+	return result;
+}
@@ -0,0 +1,385 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include "intrusive_list.h"
+#include "node_allocation.h"
+
+/**
+ * How a Cache picks the entry to evict:
+ * CACHE_LRU evicts the least recently used entry, every hit moves its entry
+ * to the back of the recency list.
+ * CACHE_CLOCK evicts the oldest entry that was not used since it was last
+ * passed by, a hit only marks its entry.
+ * CACHE_S3FIFO admits new entries into a small FIFO queue (10% of the
+ * capacity) and promotes those that were used while there into the main
+ * one, entries evicted from the small queue are remembered by the hash of
+ * their key, and come back straight into the main queue. One hit wonders
+ * are evicted fast this way, which is what most caches see.
+ */
+enum CachePolicy {
+	CACHE_LRU,
+	CACHE_CLOCK,
+	CACHE_S3FIFO
+};
+
+#define cacheTemplate <KeyType, ValueType, Hash, Equal, Clock>
+
+/**
+ * A bounded cache: a hash index of its entries, chained through an
+ * IntrusiveListHook like HashTable, and an intrusive eviction queue, so
+ * that get, put and erase are O(1) (amortized, as the index doubles when it
+ * fills up and CLOCK and S3-FIFO may pass over a few used entries before
+ * they find one to evict).
+ *
+ * Each entry has a charge, 1 by default, and the cache evicts entries
+ * until the sum of their charges fits in its capacity: the capacity is a
+ * count of entries, or an amount of bytes when the charges are the sizes
+ * of the entries. An entry may also have a time to live, after which get
+ * no longer finds it (it is dropped then, or when it is evicted).
+ * @code
+ * Cache<int, std::string> names(1000, CACHE_S3FIFO);
+ * names.put(7, "seven");
+ * names.put(8, "eight", 1, std::chrono::seconds(30));
+ * std::string* name = names.get(7);
+ * @endcode
+ * The entries are allocated from a std::pmr::memory_resource.
+ * The cache is not thread safe, and the pointers get returns are valid
+ * until the next put, erase or clear.
+ */
+template<class KeyType, class ValueType, class Hash = std::hash<KeyType>,
+		class Equal = std::equal_to<KeyType>, class Clock = std::chrono::steady_clock>
+class Cache {
+public:
+	typedef typename Clock::duration Duration;
+private:
+	struct HashTag;
+	struct QueueTag;
+	typedef IntrusiveListHook<HashTag> HashHook;
+	typedef IntrusiveListHook<QueueTag> QueueHook;
+	struct Entry : public HashHook, public QueueHook {
+		KeyType _key;
+		ValueType _value;
+		size_t _hash;
+		size_t _charge;
+		typename Clock::time_point _expiry;
+		bool _expires;
+		// the CLOCK reference bit, or the S3-FIFO hit count (up to 3)
+		uint8_t _frequency;
+		bool _inMain;
+		Entry(const KeyType& key, const ValueType& value, size_t hash, size_t charge)
+		: _key(key), _value(value), _hash(hash), _charge(charge), _expiry(),
+		  _expires(false), _frequency(0), _inMain(true) {}
+	};
+	typedef IntrusiveList<Entry, HashTag> Bucket;
+	typedef IntrusiveList<Entry, QueueTag> Queue;
+	static const size_t INITIAL_BUCKETS = 16;
+	static const uint8_t MAX_FREQUENCY = 3;
+
+	size_t _capacity;
+	CachePolicy _policy;
+	std::pmr::memory_resource* _resource;
+	Hash _hasher;
+	Equal _equal;
+	std::unique_ptr<Bucket[]> _buckets;
+	size_t _bucketCount;
+	size_t _size;
+	size_t _charge;
+	// every entry of LRU and CLOCK, the main queue of S3-FIFO
+	Queue _main;
+	Queue _small;
+	size_t _smallCharge;
+	/**
+	 * The S3-FIFO ghost queue, the hashes of the keys that were last evicted
+	 * from the small queue. It is direct mapped, as big as the index: a
+	 * newer hash overwrites an older one, so memory stays bounded and a few
+	 * ghosts are forgotten early.
+	 */
+	std::vector<size_t> _ghosts;
+
+	Entry* findEntry(const KeyType& key, size_t hash) const;
+	void destroy(Entry* entry);
+	void evict();
+	void evictSmall();
+	void evictMain();
+	void grow();
+	bool isExpired(const Entry* entry) const {
+		return entry->_expires && Clock::now() >= entry->_expiry;
+	}
+	size_t& ghostOf(size_t hash) {
+		return _ghosts[hash & (_ghosts.size() - 1)];
+	}
+public:
+	/**
+	 * Creates an empty cache whose entries' charges add up to at most capacity.
+	 */
+	explicit Cache(size_t capacity, CachePolicy policy = CACHE_LRU,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	Cache(const Cache& cache) = delete;
+	Cache& operator=(const Cache& cache) = delete;
+	~Cache() {
+		clear();
+	}
+
+	/**
+	 * Returns a pointer to the value of key and records the hit, or NULL if
+	 * the key is not cached or its entry expired.
+	 */
+	ValueType* get(const KeyType& key);
+
+	/**
+	 * Returns true if key is cached and not expired, without recording a hit.
+	 */
+	bool contains(const KeyType& key) const {
+		const Entry* entry = findEntry(key, _hasher(key));
+		return entry && !isExpired(entry);
+	}
+
+	/**
+	 * Caches value under key, replacing the value (and the charge and time to
+	 * live) it had, and evicts entries until the charges fit the capacity.
+	 * A ttl of zero means the entry doesn't expire.
+	 * Returns false, and drops key from the cache, if charge alone is more
+	 * than the capacity.
+	 */
+	bool put(const KeyType& key, const ValueType& value, size_t charge = 1,
+			Duration ttl = Duration::zero());
+
+	/**
+	 * Removes key from the cache. Returns false if it was not cached.
+	 */
+	bool erase(const KeyType& key);
+
+	/**
+	 * Removes all the entries, and forgets the S3-FIFO ghosts.
+	 */
+	void clear();
+
+	size_t size() const {
+		return _size;
+	}
+	/**
+	 * The sum of the charges of the entries, expired ones included.
+	 */
+	size_t charge() const {
+		return _charge;
+	}
+	size_t capacity() const {
+		return _capacity;
+	}
+	CachePolicy policy() const {
+		return _policy;
+	}
+};
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+Cache cacheTemplate::Cache(size_t capacity, CachePolicy policy,
+		std::pmr::memory_resource* resource)
+: _capacity(capacity), _policy(policy), _resource(resource),
+  _buckets(new Bucket[INITIAL_BUCKETS]), _bucketCount(INITIAL_BUCKETS), _size(0),
+  _charge(0), _smallCharge(0), _ghosts(INITIAL_BUCKETS, 0) {}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+typename Cache cacheTemplate::Entry* Cache cacheTemplate::findEntry(
+		const KeyType& key, size_t hash) const {
+	Bucket& bucket = _buckets[hash & (_bucketCount - 1)];
+	for(typename Bucket::iterator it = bucket.begin(); it != bucket.end(); ++it) {
+		if((*it)._hash == hash && _equal((*it)._key, key)) {
+			return &(*it);
+		}
+	}
+	return NULL;
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+void Cache cacheTemplate::destroy(Entry* entry) {
+	entry->HashHook::unlink();
+	entry->QueueHook::unlink();
+	if(!entry->_inMain) {
+		_smallCharge -= entry->_charge;
+	}
+	_charge -= entry->_charge;
+	_size--;
+	deallocateNode(_resource, entry);
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+void Cache cacheTemplate::grow() {
+	size_t bucketCount = _bucketCount * 2;
+	std::unique_ptr<Bucket[]> buckets(new Bucket[bucketCount]);
+	for(size_t i = 0; i < _bucketCount; i++) {
+		while(Entry* entry = _buckets[i].front()) {
+			_buckets[i].remove(entry);
+			buckets[entry->_hash & (bucketCount - 1)].insert(entry);
+		}
+	}
+	_buckets.swap(buckets);
+	_bucketCount = bucketCount;
+	_ghosts.assign(bucketCount, 0);
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+void Cache cacheTemplate::evictSmall() {
+	while(Entry* entry = _small.front()) {
+		if(entry->_frequency == 0) {
+			ghostOf(entry->_hash) = entry->_hash | 1;
+			destroy(entry);
+			return;
+		}
+		_small.remove(entry);
+		_smallCharge -= entry->_charge;
+		entry->_inMain = true;
+		entry->_frequency = 0;
+		_main.insert(entry);
+	}
+	evictMain();
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+void Cache cacheTemplate::evictMain() {
+	while(Entry* entry = _main.front()) {
+		if(entry->_frequency == 0) {
+			destroy(entry);
+			return;
+		}
+		entry->_frequency--;
+		_main.remove(entry);
+		_main.insert(entry);
+	}
+	evictSmall();
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+void Cache cacheTemplate::evict() {
+	switch(_policy) {
+	case CACHE_LRU:
+		destroy(_main.front());
+		break;
+	case CACHE_CLOCK:
+		evictMain();
+		break;
+	case CACHE_S3FIFO:
+		if(_smallCharge > _capacity / 10 || _main.empty()) {
+			evictSmall();
+		} else {
+			evictMain();
+		}
+		break;
+	}
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+ValueType* Cache cacheTemplate::get(const KeyType& key) {
+	Entry* entry = findEntry(key, _hasher(key));
+	if(!entry) {
+		return NULL;
+	}
+	if(isExpired(entry)) {
+		destroy(entry);
+		return NULL;
+	}
+	switch(_policy) {
+	case CACHE_LRU:
+		_main.remove(entry);
+		_main.insert(entry);
+		break;
+	case CACHE_CLOCK:
+		entry->_frequency = 1;
+		break;
+	case CACHE_S3FIFO:
+		if(entry->_frequency < MAX_FREQUENCY) {
+			entry->_frequency++;
+		}
+		break;
+	}
+	return &entry->_value;
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+bool Cache cacheTemplate::put(const KeyType& key, const ValueType& value,
+		size_t charge, Duration ttl) {
+	size_t hash = _hasher(key);
+	Entry* entry = findEntry(key, hash);
+	if(charge > _capacity) {
+		if(entry) {
+			destroy(entry);
+		}
+		return false;
+	}
+	if(entry) {
+		entry->_value = value;
+		// the entry leaves its queue while room is made for its new charge,
+		// so that it can't be evicted itself, and comes back at the back
+		(entry->_inMain ? _main : _small).remove(entry);
+		_charge -= entry->_charge;
+		if(!entry->_inMain) {
+			_smallCharge -= entry->_charge;
+		}
+		while(_charge + charge > _capacity) {
+			evict();
+		}
+		entry->_charge = charge;
+		_charge += charge;
+		if(entry->_inMain) {
+			_main.insert(entry);
+		} else {
+			_smallCharge += charge;
+			_small.insert(entry);
+		}
+	} else {
+		while(_charge + charge > _capacity) {
+			evict();
+		}
+		if(_size == _bucketCount) {
+			grow();
+		}
+		entry = allocateNode<Entry>(_resource, key, value, hash, charge);
+		_buckets[hash & (_bucketCount - 1)].insert(entry);
+		_size++;
+		_charge += charge;
+		if(_policy == CACHE_S3FIFO && ghostOf(hash) != (hash | 1)) {
+			entry->_inMain = false;
+			_smallCharge += charge;
+			_small.insert(entry);
+		} else {
+			if(_policy == CACHE_S3FIFO) {
+				ghostOf(hash) = 0;
+			}
+			_main.insert(entry);
+		}
+	}
+	entry->_expires = ttl > Duration::zero();
+	if(entry->_expires) {
+		entry->_expiry = Clock::now() + ttl;
+	}
+	return true;
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+bool Cache cacheTemplate::erase(const KeyType& key) {
+	Entry* entry = findEntry(key, _hasher(key));
+	if(!entry) {
+		return false;
+	}
+	destroy(entry);
+	return true;
+}
+
+template<class KeyType, class ValueType, class Hash, class Equal, class Clock>
+void Cache cacheTemplate::clear() {
+	while(Entry* entry = _main.front()) {
+		destroy(entry);
+	}
+	while(Entry* entry = _small.front()) {
+		destroy(entry);
+	}
+	_ghosts.assign(_ghosts.size(), 0);
+}
+
+#endif /* CACHE_H_ */
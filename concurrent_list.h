@@ -0,0 +1,401 @@
+#ifndef CONCURRENT_LIST_H_
+#define CONCURRENT_LIST_H_
+
+#include <atomic>
+#include <cstdlib>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Epoch based reclamation of objects shared between threads.
+ * A thread pins the current epoch while it reads shared pointers, and an
+ * object unlinked from a shared structure is retired instead of deleted.
+ * A retired object is deleted only once the global epoch has advanced twice
+ * since it was retired, at which point no pinned thread can still reach it.
+ */
+class EpochReclaimer {
+	static const unsigned int RETIRED_PER_ADVANCE = 64;
+
+	struct Retired {
+		void* _object;
+		void (*_deleter)(void*);
+	};
+
+	struct Record {
+		// (pinned epoch << 1) | 1 while the owner thread is pinned, 0 otherwise
+		std::atomic<unsigned long> _state;
+		std::atomic<bool> _inUse;
+		Record* _next;
+		unsigned int _nesting;
+		unsigned int _retiredCount;
+		std::vector<Retired> _limbo[3];
+		unsigned long _limboEpoch[3];
+
+		Record() : _state(0), _inUse(true), _next(NULL), _nesting(0), _retiredCount(0) {
+			for(int i = 0; i < 3; i++) {
+				_limboEpoch[i] = 0;
+			}
+		}
+	};
+
+	struct RecordOwner {
+		Record* _record;
+		RecordOwner() : _record(instance().acquireRecord()) {}
+		~RecordOwner() {
+			_record->_inUse.store(false);
+		}
+	};
+
+	std::atomic<unsigned long> _globalEpoch;
+	std::atomic<Record*> _records;
+
+	EpochReclaimer() : _globalEpoch(2), _records(NULL) {}
+
+	~EpochReclaimer() {
+		Record* record = _records.load();
+		while(record) {
+			Record* next = record->_next;
+			for(int i = 0; i < 3; i++) {
+				freeLimbo(record, i);
+			}
+			delete record;
+			record = next;
+		}
+	}
+
+	static EpochReclaimer& instance() {
+		static EpochReclaimer reclaimer;
+		return reclaimer;
+	}
+
+	static Record* localRecord() {
+		static thread_local RecordOwner owner;
+		return owner._record;
+	}
+
+	Record* acquireRecord() {
+		for(Record* record = _records.load(); record; record = record->_next) {
+			bool inUse = false;
+			if(!record->_inUse.load() && record->_inUse.compare_exchange_strong(inUse, true)) {
+				return record;
+			}
+		}
+		Record* record = new Record();
+		Record* head = _records.load();
+		do {
+			record->_next = head;
+		} while(!_records.compare_exchange_weak(head, record));
+		return record;
+	}
+
+	static void freeLimbo(Record* record, int index) {
+		std::vector<Retired>& limbo = record->_limbo[index];
+		for(unsigned int i = 0; i < limbo.size(); i++) {
+			limbo[i]._deleter(limbo[i]._object);
+		}
+		limbo.clear();
+	}
+
+	void collect(Record* record) {
+		unsigned long epoch = _globalEpoch.load();
+		for(int i = 0; i < 3; i++) {
+			if(!record->_limbo[i].empty() && record->_limboEpoch[i] + 2 <= epoch) {
+				freeLimbo(record, i);
+			}
+		}
+	}
+
+	void tryAdvance() {
+		unsigned long epoch = _globalEpoch.load();
+		for(Record* record = _records.load(); record; record = record->_next) {
+			unsigned long state = record->_state.load();
+			if((state & 1) && (state >> 1) != epoch) {
+				return;
+			}
+		}
+		_globalEpoch.compare_exchange_strong(epoch, epoch + 1);
+	}
+
+public:
+	/**
+	 * Pins the current epoch for the calling thread. Pins nest, only the
+	 * outermost pin/unpin pair announces the thread to the other threads.
+	 */
+	static void pin() {
+		Record* record = localRecord();
+		if(record->_nesting++ == 0) {
+			EpochReclaimer& reclaimer = instance();
+			record->_state.store((reclaimer._globalEpoch.load() << 1) | 1);
+			reclaimer.collect(record);
+		}
+	}
+
+	static void unpin() {
+		Record* record = localRecord();
+		if(--record->_nesting == 0) {
+			record->_state.store(0, std::memory_order_release);
+		}
+	}
+
+	/**
+	 * Hands an object that is no longer reachable from the shared structure
+	 * to the reclaimer, which will call deleter on it once it is safe.
+	 */
+	static void retire(void* object, void (*deleter)(void*)) {
+		EpochReclaimer& reclaimer = instance();
+		Record* record = localRecord();
+		unsigned long epoch = reclaimer._globalEpoch.load();
+		int index = epoch % 3;
+		if(record->_limboEpoch[index] != epoch) {
+			// the bucket holds objects retired at least three epochs ago
+			freeLimbo(record, index);
+			record->_limboEpoch[index] = epoch;
+		}
+		Retired retired = { object, deleter };
+		record->_limbo[index].push_back(retired);
+		if(++record->_retiredCount >= RETIRED_PER_ADVANCE) {
+			record->_retiredCount = 0;
+			reclaimer.tryAdvance();
+			reclaimer.collect(record);
+		}
+	}
+};
+
+/**
+ * Keeps the calling thread pinned for the lifetime of the guard.
+ * The pin belongs to the thread that made the guard: a guard must be
+ * copied and destroyed on that thread only, copying or destroying it on
+ * another thread unbalances the pins of both threads.
+ */
+class EpochGuard {
+public:
+	EpochGuard() {
+		EpochReclaimer::pin();
+	}
+	EpochGuard(const EpochGuard&) {
+		EpochReclaimer::pin();
+	}
+	EpochGuard& operator=(const EpochGuard&) {
+		return *this;
+	}
+	~EpochGuard() {
+		EpochReclaimer::unpin();
+	}
+};
+
+#define concurrentListTemplate <DataType>
+
+/**
+ * A List variant that may be appended to, scanned and removed from by many
+ * threads at once without a lock.
+ * Appends link a node after the last node with a single compare-and-swap,
+ * starting from a tail hint. Removal first marks the removed node's next link
+ * (Harris style) so nothing can be linked after it through a stale pointer,
+ * then unlinks it, and the node is deleted through the EpochReclaimer once no
+ * concurrent reader can hold it anymore.
+ * Iterators pin the calling thread's epoch while they are alive, so
+ * long-lived iterators delay reclamation. An iterator holds an EpochGuard:
+ * it must not be copied or destroyed on a thread other than the one that
+ * created it, each thread scanning the list takes its own from begin().
+ */
+template<class DataType>
+class ConcurrentList {
+	class Link;
+	class Node;
+	Link _head;
+	std::atomic<Link*> _tail;
+	std::atomic<unsigned int> _size;
+
+	static const uintptr_t MARK = 1;
+	static Node* pointerOf(uintptr_t link) {
+		return reinterpret_cast<Node*>(link & ~MARK);
+	}
+	static bool isMarked(uintptr_t link) {
+		return (link & MARK) != 0;
+	}
+	static void deleteNode(void* node) {
+		delete static_cast<Node*>(node);
+	}
+	static Node* firstLive(Node* node);
+	bool unlink(Link* pred, uintptr_t predNext, Node* node, uintptr_t next);
+public:
+	class iterator;
+	ConcurrentList();
+	ConcurrentList(const ConcurrentList& list) = delete;
+	ConcurrentList& operator=(const ConcurrentList& list) = delete;
+	/**
+	 * Destructor. Must not run concurrently with any other operation.
+	 */
+	~ConcurrentList();
+	/**
+	 * Appends a copy of data to the end of the list. Lock-free.
+	 */
+	void insert(DataType data);
+	/**
+	 * Removes the first element equal to data. Returns false if no such
+	 * element was found.
+	 */
+	bool remove(const DataType& data);
+	/**
+	 * Returns the amount of elements in the list, as of some recent moment.
+	 */
+	unsigned int size() const {
+		return _size.load();
+	}
+
+	iterator begin() const;
+
+	iterator end() const {
+		return iterator(this, NULL);
+	}
+};
+
+template<class DataType>
+class ConcurrentList concurrentListTemplate::Link {
+	std::atomic<uintptr_t> _next;
+	friend class ConcurrentList;
+public:
+	Link() : _next(0) {}
+};
+
+template<class DataType>
+class ConcurrentList concurrentListTemplate::Node : public Link {
+	DataType _data;
+	// set once the appending thread no longer touches the tail hint
+	std::atomic<bool> _published;
+	friend class ConcurrentList;
+public:
+	Node(DataType& data) : _data(data), _published(false) {};
+};
+
+template<class DataType>
+ConcurrentList concurrentListTemplate::ConcurrentList()
+: _tail(&_head), _size(0) {}
+
+template<class DataType>
+ConcurrentList concurrentListTemplate::~ConcurrentList() {
+	Node* node = pointerOf(_head._next.load());
+	while(node) {
+		Node* temp = pointerOf(node->_next.load());
+		delete node;
+		node = temp;
+	}
+}
+
+template<class DataType>
+void ConcurrentList concurrentListTemplate::insert(DataType data) {
+	Node* toInsert = new Node(data);
+	EpochGuard guard;
+	Link* hint = _tail.load();
+	Link* last = hint;
+	for(;;) {
+		uintptr_t next = last->_next.load();
+		if(pointerOf(next)) {
+			last = pointerOf(next);
+			continue;
+		}
+		// a removed last node keeps its mark, and is unlinked once it has a successor
+		if(last->_next.compare_exchange_weak(next,
+				reinterpret_cast<uintptr_t>(toInsert) | (next & MARK))) {
+			break;
+		}
+	}
+	_tail.compare_exchange_strong(hint, toInsert);
+	toInsert->_published.store(true);
+	_size++;
+}
+
+template<class DataType>
+bool ConcurrentList concurrentListTemplate::unlink(Link* pred, uintptr_t predNext,
+		Node* node, uintptr_t next) {
+	// the last node and nodes whose appender may still store them as the tail
+	// hint stay linked, a later removal unlinks them
+	if(isMarked(predNext) || !pointerOf(next) || !node->_published.load()) {
+		return false;
+	}
+	if(!pred->_next.compare_exchange_strong(predNext, next & ~MARK)) {
+		return false;
+	}
+	Link* expected = node;
+	_tail.compare_exchange_strong(expected, &_head);
+	EpochReclaimer::retire(node, deleteNode);
+	return true;
+}
+
+template<class DataType>
+bool ConcurrentList concurrentListTemplate::remove(const DataType& data) {
+	EpochGuard guard;
+	Link* pred = &_head;
+	uintptr_t current = pred->_next.load();
+	while(Node* node = pointerOf(current)) {
+		uintptr_t next = node->_next.load();
+		if(!isMarked(next) && node->_data == data) {
+			if(!node->_next.compare_exchange_strong(next, next | MARK)) {
+				continue;
+			}
+			_size--;
+			unlink(pred, current, node, next | MARK);
+			return true;
+		}
+		if(isMarked(next) && unlink(pred, current, node, next)) {
+			current = next & ~MARK;
+			continue;
+		}
+		pred = node;
+		current = next;
+	}
+	return false;
+}
+
+template<class DataType>
+typename ConcurrentList concurrentListTemplate::Node* ConcurrentList<
+DataType>::firstLive(Node* node) {
+	while(node && isMarked(node->_next.load())) {
+		node = pointerOf(node->_next.load());
+	}
+	return node;
+}
+
+template<class DataType>
+typename ConcurrentList concurrentListTemplate::iterator ConcurrentList<
+DataType>::begin() const {
+	iterator it(this, NULL);
+	it._current = firstLive(pointerOf(_head._next.load()));
+	return it;
+}
+
+template<class DataType>
+class ConcurrentList concurrentListTemplate::iterator {
+	const ConcurrentList* _list;
+	Node* _current;
+	EpochGuard _guard;
+	friend class ConcurrentList;
+public:
+	explicit iterator(const ConcurrentList* list = NULL, Node* current = NULL)
+	: _list(list), _current(current) { }
+	iterator(const iterator& it) : _list(it._list), _current(it._current), _guard(it._guard) { }
+	iterator& operator=(const iterator& it) {
+		_list = it._list;
+		_current = it._current;
+		return *this;
+	}
+	bool operator==(const iterator& iterator) const {
+		return (_list == iterator._list && _current == iterator._current);
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+	iterator& operator++() {
+		if(!_current) {
+			return *this;
+		}
+		_current = firstLive(pointerOf(_current->_next.load()));
+		return *this;
+	}
+	DataType& operator*() const {
+		return _current->_data;
+	}
+};
+
+
+#endif /* CONCURRENT_LIST_H_ */
@@ -1,32 +1,124 @@
 #ifndef HASH_TABLE_H_
 #define HASH_TABLE_H_
 
+#include <cstdint>
+#include "intrusive_list.h"
+#include "key_filter.h"
+#include "stats.h"
+
 const int SIZE = 24593;
 
+#ifdef GENERICDS_STATS
+/**
+ * A snapshot of the counters of a HashTable (see stats.h). The average chain
+ * length walked by a search is probes / searches.
+ */
+struct HashTableStats {
+	uint64_t _searches;
+	uint64_t _probes;
+	uint64_t _longestProbe;
+	uint64_t _inserts;
+	uint64_t _removes;
+	// the Trolls are not owned, only the buckets are counted as memory
+	uint64_t _entries;
+	uint64_t _bytes;
+};
+#endif
+
+/**
+ * Chains the Trolls of each bucket through the IntrusiveListHook that Troll
+ * inherits, so inserting allocates nothing and removing a given Troll is
+ * O(1).
+ */
 class HashTable {
-	List<Troll*> table[SIZE];
+	IntrusiveList<Troll> table[SIZE];
+	// consulted by search before the chain walk, NULL if none is attached
+	KeyFilter<int>* _filter = NULL;
+#ifdef GENERICDS_STATS
+	HashTableStats _stats = HashTableStats();
+#endif
 public:
 
 	HashTable() { }
 
 	void insert(Troll* troll) {
+		GENERICDS_STAT(_stats._inserts++);
+		// a filter that can't take the ID would hide the Troll from search
+		if(_filter && !_filter->add(troll->_TrollID)) {
+			_filter = NULL;
+		}
 		table[(troll->_TrollID)%SIZE].insert(troll);
 	}
 
 	Troll* search(int TrollID) {
-		List<Troll*>* list = &(table[TrollID%SIZE]);
-		for(List<Troll*>::iterator it = list->begin() ; it != list->end() ; ++it) {
-			if((*it)->_TrollID == TrollID) {
-				return *it;
+		IntrusiveList<Troll>* list = &(table[TrollID%SIZE]);
+		GENERICDS_STAT(_stats._searches++);
+		if(_filter && !_filter->mayContain(TrollID)) {
+			return NULL;
+		}
+#ifdef GENERICDS_STATS
+		uint64_t probes = 0;
+#endif
+		Troll* found = NULL;
+		for(IntrusiveList<Troll>::iterator it = list->begin() ; it != list->end() ; ++it) {
+			GENERICDS_STAT(probes++);
+			if((*it)._TrollID == TrollID) {
+				found = &(*it);
+				break;
 			}
 		}
-		return NULL;
+		GENERICDS_STAT(_stats._probes += probes;
+				if(probes > _stats._longestProbe) _stats._longestProbe = probes);
+		return found;
 	}
 
 	void remove(Troll* troll) {
+		GENERICDS_STAT(_stats._removes++);
 		table[(troll->_TrollID)%SIZE].remove(troll);
 	}
 
+	/**
+	 * Makes search consult filter (see key_filter.h) before walking a chain,
+	 * after adding the TrollIDs in the table to it. NULL detaches the current
+	 * filter, the table doesn't own it.
+	 * Returns false, and attaches nothing, if filter can't take the IDs.
+	 */
+	bool attachFilter(KeyFilter<int>* filter) {
+		_filter = filter;
+		for(int i = 0 ; _filter && i < SIZE ; i++) {
+			for(IntrusiveList<Troll>::iterator it = table[i].begin() ; it != table[i].end() ; ++it) {
+				if(!_filter->add((*it)._TrollID)) {
+					_filter = NULL;
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * The chain of the bucket at index (0 <= index < SIZE), for walking the
+	 * whole table.
+	 */
+	const IntrusiveList<Troll>& bucket(int index) const {
+		return table[index];
+	}
+
+#ifdef GENERICDS_STATS
+	HashTableStats getStats() const {
+		HashTableStats stats = _stats;
+		stats._entries = _stats._inserts - _stats._removes;
+		stats._bytes = sizeof(*this);
+		return stats;
+	}
+	void resetStats() {
+		uint64_t entries = _stats._inserts - _stats._removes;
+		_stats = HashTableStats();
+		// the entries are still there, they stay counted as inserted
+		_stats._inserts = entries;
+	}
+#endif
+
 };
 
 
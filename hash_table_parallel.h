@@ -0,0 +1,53 @@
+#ifndef HASH_TABLE_PARALLEL_H_
+#define HASH_TABLE_PARALLEL_H_
+
+#include "parallel.h"
+#include "hash_table.h"
+
+/**
+ * parallel_for_each and parallel_reduce (see parallel.h) over the Trolls of
+ * a HashTable, cut into PARALLEL_CHUNKS ranges of buckets. The Trolls are
+ * visited bucket by bucket, in the order of each chain.
+ */
+
+template<class Function>
+void hashTableForEachAux(const HashTable& table, size_t chunk, Function& function) {
+	int first = (int)(chunk * SIZE / PARALLEL_CHUNKS);
+	int last = (int)((chunk + 1) * SIZE / PARALLEL_CHUNKS);
+	for(int i = first ; i < last ; i++) {
+		const IntrusiveList<Troll>& bucket = table.bucket(i);
+		for(IntrusiveList<Troll>::iterator it = bucket.begin() ; it != bucket.end() ; ++it) {
+			function(*it);
+		}
+	}
+}
+
+/**
+ * Calls function(Troll&) on every Troll in table.
+ */
+template<class Function>
+void parallel_for_each(HashTable& table, Function function,
+		ThreadPool& pool = ThreadPool::global()) {
+	pool.run(PARALLEL_CHUNKS, [&](size_t chunk) {
+		hashTableForEachAux(table, chunk, function);
+	});
+}
+
+/**
+ * Returns the reduce of the transforms of the Trolls in table, computed
+ * chunk by chunk and combined in the order of the buckets.
+ */
+template<class Result, class Transform, class Reduce>
+Result parallel_reduce(HashTable& table, Result identity, Transform transform,
+		Reduce reduce, ThreadPool& pool = ThreadPool::global()) {
+	return parallelCombine(PARALLEL_CHUNKS, identity, [&](size_t chunk) {
+		Result result = identity;
+		auto accumulate = [&](Troll& troll) {
+			result = reduce(result, transform(troll));
+		};
+		hashTableForEachAux(table, chunk, accumulate);
+		return result;
+	}, reduce, pool);
+}
+
+#endif /* HASH_TABLE_PARALLEL_H_ */
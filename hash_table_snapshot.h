@@ -0,0 +1,122 @@
+#ifndef HASH_TABLE_SNAPSHOT_H_
+#define HASH_TABLE_SNAPSHOT_H_
+
+#include "snapshot.h"
+#include "hash_table.h"
+
+/**
+ * A HashTable snapshot (see snapshot.h).
+ * The table doesn't own its Trolls, so the snapshot records the TrollIDs of
+ * each bucket, in chain order: SIZE + 1 bucket offsets followed by the IDs.
+ * The view answers membership queries from the mapped file, and restoring
+ * re-links the Trolls that the caller resolves from their IDs.
+ */
+class HashTableSnapshot {
+	const uint32_t* _offsets;
+	const int* _ids;
+	uint64_t _count;
+public:
+	HashTableSnapshot() : _offsets(NULL), _ids(NULL), _count(0) {}
+	/**
+	 * Offset, from the start of the payload, of the IDs.
+	 */
+	static uint64_t idsOffset() {
+		return snapshotAlign((SIZE + 1) * sizeof(uint32_t));
+	}
+	/**
+	 * Attaches the view to snapshot, in O(SIZE).
+	 * Returns false if snapshot doesn't hold a hash table, or if its bucket
+	 * offsets don't stay within its IDs (a corrupt file).
+	 */
+	bool attach(const Snapshot& snapshot) {
+		if(!snapshot.isOpen()) {
+			return false;
+		}
+		uint64_t count = snapshot.header()._count;
+		// checked first so that the size of the IDs can't overflow
+		if(count > snapshot.header()._payloadSize / sizeof(int)
+				|| !snapshot.holds(SNAPSHOT_HASH_TABLE, sizeof(int), 0,
+						idsOffset() + count * sizeof(int))) {
+			return false;
+		}
+		const uint32_t* offsets = reinterpret_cast<const uint32_t*>(snapshot.payload());
+		if(offsets[SIZE] != count) {
+			return false;
+		}
+		for(int index = 0; index < SIZE; index++) {
+			if(offsets[index] > offsets[index + 1]) {
+				return false;
+			}
+		}
+		_offsets = offsets;
+		_ids = reinterpret_cast<const int*>(snapshot.payload() + idsOffset());
+		_count = count;
+		return true;
+	}
+	/**
+	 * Returns true if a Troll of the given ID was in the table. A negative
+	 * ID is never found, the table can't hold one.
+	 */
+	bool contains(int TrollID) const {
+		if(!_offsets || TrollID < 0) {
+			return false;
+		}
+		int index = TrollID % SIZE;
+		for(uint32_t i = _offsets[index]; i < _offsets[index + 1]; i++) {
+			if(_ids[i] == TrollID) {
+				return true;
+			}
+		}
+		return false;
+	}
+	uint64_t size() const {
+		return _count;
+	}
+	/**
+	 * Inserts into table the Troll that resolve returns for each recorded
+	 * ID, keeping the order of the chains. IDs resolved to NULL are skipped.
+	 */
+	void restore(HashTable& table, Troll* (*resolve)(int TrollID)) const {
+		for(uint64_t i = 0; i < _count; i++) {
+			Troll* troll = resolve(_ids[i]);
+			if(troll) {
+				table.insert(troll);
+			}
+		}
+	}
+};
+
+/**
+ * Writes the TrollIDs of table to a snapshot file at path.
+ * Returns false if the file couldn't be written.
+ */
+inline bool writeSnapshot(const char* path, const HashTable& table) {
+	typedef IntrusiveList<Troll> Chain;
+	uint64_t count = 0;
+	for(int index = 0; index < SIZE; index++) {
+		const Chain& chain = table.bucket(index);
+		for(Chain::iterator it = chain.begin(); it != chain.end(); ++it) {
+			count++;
+		}
+	}
+	SnapshotWriter writer(path, SNAPSHOT_HASH_TABLE, sizeof(int), 0, count);
+	uint32_t offset = 0;
+	for(int index = 0; index < SIZE; index++) {
+		writer.write(&offset, sizeof(offset));
+		const Chain& chain = table.bucket(index);
+		for(Chain::iterator it = chain.begin(); it != chain.end(); ++it) {
+			offset++;
+		}
+	}
+	writer.write(&offset, sizeof(offset));
+	writer.pad();
+	for(int index = 0; index < SIZE; index++) {
+		const Chain& chain = table.bucket(index);
+		for(Chain::iterator it = chain.begin(); it != chain.end(); ++it) {
+			writer.write(&(*it)._TrollID, sizeof(int));
+		}
+	}
+	return writer.commit();
+}
+
+#endif /* HASH_TABLE_SNAPSHOT_H_ */
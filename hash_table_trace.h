@@ -0,0 +1,40 @@
+#ifndef HASH_TABLE_TRACE_H_
+#define HASH_TABLE_TRACE_H_
+
+#include "trace.h"
+#include "hash_table.h"
+
+/**
+ * Records the insert, search and remove calls made on a HashTable into a
+ * trace (see trace.h), keyed by TrollID, then forwards them to it.
+ */
+class TracedHashTable {
+	HashTable& _table;
+	TraceWriter _writer;
+public:
+	TracedHashTable(HashTable& table, const char* path)
+	: _table(table), _writer(path, TRACE_HASH_TABLE, sizeof(int), 0) {}
+	bool isTracing() const {
+		return _writer.isOpen();
+	}
+	HashTable& table() const {
+		return _table;
+	}
+	void insert(Troll* troll) {
+		_writer.record(TRACE_INSERT, &troll->_TrollID);
+		_table.insert(troll);
+	}
+	Troll* search(int TrollID) {
+		_writer.record(TRACE_FIND, &TrollID);
+		return _table.search(TrollID);
+	}
+	void remove(Troll* troll) {
+		_writer.record(TRACE_REMOVE, &troll->_TrollID);
+		_table.remove(troll);
+	}
+	void flush() {
+		_writer.flush();
+	}
+};
+
+#endif /* HASH_TABLE_TRACE_H_ */
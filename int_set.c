@@ -0,0 +1,952 @@
+#include <stdlib.h>
+#include <string.h>
+#include "int_set.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/** An array container holding more values than this becomes a bitmap */
+#define ARRAY_MAX 4096
+#define BITMAP_WORDS 1024
+/** Looking values up instead of merging pays off past this size ratio */
+#define GALLOP_RATIO 64
+
+typedef enum ContainerType_t {
+	CONTAINER_ARRAY,
+	CONTAINER_BITMAP,
+	CONTAINER_RUN
+} ContainerType;
+
+/** The values start, start + 1, ..., start + length */
+typedef struct Run_t {
+	uint16_t start;
+	uint16_t length;
+} Run;
+
+/** The values of one 16 high bits key, in the smallest fitting form */
+typedef struct Container_t {
+	ContainerType type;
+	int cardinality;
+	// allocated array values, unused for bitmaps
+	int capacity;
+	// amount of runs of a run container
+	int runCount;
+	union {
+		uint16_t* values;
+		uint64_t* words;
+		Run* runs;
+	} data;
+} Container;
+
+typedef enum Operation_t {
+	OPERATION_UNION,
+	OPERATION_INTERSECTION,
+	OPERATION_DIFFERENCE
+} Operation;
+
+struct IntSet_t {
+	uint16_t* keys;
+	Container* containers;
+	int count;
+	int capacity;
+	// internal iterator: a container index (-1 when invalid), the position
+	// of the current value in it, and the current value's 16 low bits
+	int currentContainer;
+	int currentPosition;
+	uint16_t currentLow;
+};
+
+/* ---------------------------------------------------------------------- */
+/* Containers                                                              */
+/* ---------------------------------------------------------------------- */
+
+/** Index of value in a sorted array, or -(insertion index) - 1 */
+static int arraySearch(const uint16_t* values, int count, uint16_t value) {
+	int low = 0, high = count - 1;
+	while(low <= high) {
+		int middle = (low + high) / 2;
+		if(values[middle] < value) {
+			low = middle + 1;
+		} else if(values[middle] > value) {
+			high = middle - 1;
+		} else {
+			return middle;
+		}
+	}
+	return -(low + 1);
+}
+
+/** First index in values[from..count) holding a value >= value */
+static int arrayGallop(const uint16_t* values, int from, int count, uint16_t value) {
+	int step = 1;
+	int high = from;
+	while(high < count && values[high] < value) {
+		from = high + 1;
+		high += step;
+		step *= 2;
+	}
+	if(high > count) {
+		high = count;
+	}
+	while(from < high) {
+		int middle = (from + high) / 2;
+		if(values[middle] < value) {
+			from = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return from;
+}
+
+static bool containerInitArray(Container* container, int capacity) {
+	container->type = CONTAINER_ARRAY;
+	container->cardinality = 0;
+	container->capacity = capacity < 4 ? 4 : capacity;
+	container->runCount = 0;
+	container->data.values = malloc(container->capacity * sizeof(uint16_t));
+	return container->data.values != NULL;
+}
+
+static bool containerInitBitmap(Container* container) {
+	container->type = CONTAINER_BITMAP;
+	container->cardinality = 0;
+	container->capacity = 0;
+	container->runCount = 0;
+	container->data.words = calloc(BITMAP_WORDS, sizeof(uint64_t));
+	return container->data.words != NULL;
+}
+
+static void containerFree(Container* container) {
+	free(container->data.values);
+	container->data.values = NULL;
+}
+
+static bool bitmapContains(const uint64_t* words, uint16_t low) {
+	return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+/** Index of the run holding low, or -1 */
+static int runSearch(const Container* container, uint16_t low) {
+	int first = 0, last = container->runCount - 1;
+	while(first <= last) {
+		int middle = (first + last) / 2;
+		const Run* run = &container->data.runs[middle];
+		if(low < run->start) {
+			last = middle - 1;
+		} else if(low > run->start + run->length) {
+			first = middle + 1;
+		} else {
+			return middle;
+		}
+	}
+	return -1;
+}
+
+static bool containerContains(const Container* container, uint16_t low) {
+	switch(container->type) {
+	case CONTAINER_ARRAY:
+		return arraySearch(container->data.values, container->cardinality, low) >= 0;
+	case CONTAINER_BITMAP:
+		return bitmapContains(container->data.words, low);
+	default:
+		return runSearch(container, low) >= 0;
+	}
+}
+
+/** Smallest value >= low in a bitmap, or -1 */
+static int bitmapNext(const uint64_t* words, int low) {
+	if(low >= 1 << 16) {
+		return -1;
+	}
+	int index = low >> 6;
+	uint64_t word = words[index] & (~0ULL << (low & 63));
+	while(!word) {
+		if(++index == BITMAP_WORDS) {
+			return -1;
+		}
+		word = words[index];
+	}
+	return index * 64 + __builtin_ctzll(word);
+}
+
+/** Fills a bitmap container out of the values of any other container */
+static bool containerToBitmap(const Container* source, Container* bitmap) {
+	if(!containerInitBitmap(bitmap)) {
+		return false;
+	}
+	uint64_t* words = bitmap->data.words;
+	if(source->type == CONTAINER_ARRAY) {
+		for(int i = 0; i < source->cardinality; i++) {
+			uint16_t low = source->data.values[i];
+			words[low >> 6] |= 1ULL << (low & 63);
+		}
+	} else if(source->type == CONTAINER_BITMAP) {
+		memcpy(words, source->data.words, BITMAP_WORDS * sizeof(uint64_t));
+	} else {
+		for(int i = 0; i < source->runCount; i++) {
+			int low = source->data.runs[i].start;
+			int end = low + source->data.runs[i].length;
+			for(; low <= end; low++) {
+				words[low >> 6] |= 1ULL << (low & 63);
+			}
+		}
+	}
+	bitmap->cardinality = source->cardinality;
+	return true;
+}
+
+/** Fills an array container out of the values of any other container */
+static bool containerToArray(const Container* source, Container* array) {
+	if(!containerInitArray(array, source->cardinality)) {
+		return false;
+	}
+	uint16_t* values = array->data.values;
+	if(source->type == CONTAINER_ARRAY) {
+		memcpy(values, source->data.values, source->cardinality * sizeof(uint16_t));
+	} else if(source->type == CONTAINER_BITMAP) {
+		int count = 0;
+		for(int i = 0; i < BITMAP_WORDS; i++) {
+			uint64_t word = source->data.words[i];
+			while(word) {
+				values[count++] = i * 64 + __builtin_ctzll(word);
+				word &= word - 1;
+			}
+		}
+	} else {
+		int count = 0;
+		for(int i = 0; i < source->runCount; i++) {
+			int low = source->data.runs[i].start;
+			int end = low + source->data.runs[i].length;
+			for(; low <= end; low++) {
+				values[count++] = low;
+			}
+		}
+	}
+	array->cardinality = source->cardinality;
+	return true;
+}
+
+/** An array or bitmap container holding the values of source */
+static bool containerToMutable(const Container* source, Container* result) {
+	return source->cardinality <= ARRAY_MAX ? containerToArray(source, result)
+			: containerToBitmap(source, result);
+}
+
+static bool containerCopy(const Container* source, Container* copy) {
+	if(source->type != CONTAINER_RUN) {
+		return source->type == CONTAINER_ARRAY ? containerToArray(source, copy)
+				: containerToBitmap(source, copy);
+	}
+	*copy = *source;
+	copy->capacity = source->runCount;
+	copy->data.runs = malloc(source->runCount * sizeof(Run));
+	if(!copy->data.runs) {
+		return false;
+	}
+	memcpy(copy->data.runs, source->data.runs, source->runCount * sizeof(Run));
+	return true;
+}
+
+/** Replaces a run container by an array or bitmap container */
+static bool containerUnrun(Container* container) {
+	if(container->type != CONTAINER_RUN) {
+		return true;
+	}
+	Container converted;
+	if(!containerToMutable(container, &converted)) {
+		return false;
+	}
+	containerFree(container);
+	*container = converted;
+	return true;
+}
+
+/** Replaces a bitmap container holding at most ARRAY_MAX values by an array */
+static bool containerShrink(Container* container) {
+	if(container->type != CONTAINER_BITMAP || container->cardinality > ARRAY_MAX) {
+		return true;
+	}
+	Container array;
+	if(!containerToArray(container, &array)) {
+		return false;
+	}
+	containerFree(container);
+	*container = array;
+	return true;
+}
+
+static IntSetResult containerAdd(Container* container, uint16_t low) {
+	if(!containerUnrun(container)) {
+		return INT_SET_OUT_OF_MEMORY;
+	}
+	if(container->type == CONTAINER_BITMAP) {
+		uint64_t* word = &container->data.words[low >> 6];
+		uint64_t bit = 1ULL << (low & 63);
+		if(*word & bit) {
+			return INT_SET_ITEM_ALREADY_EXISTS;
+		}
+		*word |= bit;
+		container->cardinality++;
+		return INT_SET_SUCCESS;
+	}
+	int index = arraySearch(container->data.values, container->cardinality, low);
+	if(index >= 0) {
+		return INT_SET_ITEM_ALREADY_EXISTS;
+	}
+	index = -index - 1;
+	if(container->cardinality == ARRAY_MAX) {
+		Container bitmap;
+		if(!containerToBitmap(container, &bitmap)) {
+			return INT_SET_OUT_OF_MEMORY;
+		}
+		containerFree(container);
+		*container = bitmap;
+		return containerAdd(container, low);
+	}
+	if(container->cardinality == container->capacity) {
+		int capacity = container->capacity * 2 > ARRAY_MAX ? ARRAY_MAX : container->capacity * 2;
+		uint16_t* values = realloc(container->data.values, capacity * sizeof(uint16_t));
+		if(!values) {
+			return INT_SET_OUT_OF_MEMORY;
+		}
+		container->data.values = values;
+		container->capacity = capacity;
+	}
+	uint16_t* values = container->data.values;
+	memmove(values + index + 1, values + index, (container->cardinality - index) * sizeof(uint16_t));
+	values[index] = low;
+	container->cardinality++;
+	return INT_SET_SUCCESS;
+}
+
+static IntSetResult containerRemove(Container* container, uint16_t low) {
+	if(!containerContains(container, low)) {
+		return INT_SET_ITEM_DOES_NOT_EXIST;
+	}
+	if(!containerUnrun(container)) {
+		return INT_SET_OUT_OF_MEMORY;
+	}
+	if(container->type == CONTAINER_BITMAP) {
+		container->data.words[low >> 6] &= ~(1ULL << (low & 63));
+		container->cardinality--;
+		// a failed shrink leaves a valid, only larger, bitmap
+		containerShrink(container);
+		return INT_SET_SUCCESS;
+	}
+	uint16_t* values = container->data.values;
+	int index = arraySearch(values, container->cardinality, low);
+	memmove(values + index, values + index + 1, (container->cardinality - index - 1) * sizeof(uint16_t));
+	container->cardinality--;
+	return INT_SET_SUCCESS;
+}
+
+/**
+ * Combines two bitmaps word by word into out, and returns the amount of
+ * values in the result.
+ */
+static int bitmapCombine(const uint64_t* words1, const uint64_t* words2,
+		uint64_t* out, Operation operation) {
+	int i = 0;
+#if defined(__AVX2__)
+	for(; i < BITMAP_WORDS; i += 4) {
+		__m256i vector1 = _mm256_loadu_si256((const __m256i*)(words1 + i));
+		__m256i vector2 = _mm256_loadu_si256((const __m256i*)(words2 + i));
+		__m256i result = operation == OPERATION_UNION ? _mm256_or_si256(vector1, vector2)
+				: operation == OPERATION_INTERSECTION ? _mm256_and_si256(vector1, vector2)
+				: _mm256_andnot_si256(vector2, vector1);
+		_mm256_storeu_si256((__m256i*)(out + i), result);
+	}
+#endif
+	for(; i < BITMAP_WORDS; i++) {
+		out[i] = operation == OPERATION_UNION ? words1[i] | words2[i]
+				: operation == OPERATION_INTERSECTION ? words1[i] & words2[i]
+				: words1[i] & ~words2[i];
+	}
+	int cardinality = 0;
+	for(i = 0; i < BITMAP_WORDS; i++) {
+		cardinality += __builtin_popcountll(out[i]);
+	}
+	return cardinality;
+}
+
+static int bitmapIntersectionSize(const uint64_t* words1, const uint64_t* words2) {
+	int cardinality = 0;
+	for(int i = 0; i < BITMAP_WORDS; i++) {
+		cardinality += __builtin_popcountll(words1[i] & words2[i]);
+	}
+	return cardinality;
+}
+
+/** Merges two sorted arrays into result, which has room for both */
+static int arrayCombine(const Container* array1, const Container* array2,
+		uint16_t* result, Operation operation) {
+	const uint16_t* values1 = array1->data.values;
+	const uint16_t* values2 = array2->data.values;
+	int count1 = array1->cardinality, count2 = array2->cardinality;
+	int i = 0, j = 0, count = 0;
+	if(operation == OPERATION_INTERSECTION && (count1 * GALLOP_RATIO < count2
+			|| count2 * GALLOP_RATIO < count1)) {
+		// one array is much smaller, look its values up in the other one
+		bool firstSmaller = count1 < count2;
+		const uint16_t* small = firstSmaller ? values1 : values2;
+		const uint16_t* large = firstSmaller ? values2 : values1;
+		int smallCount = firstSmaller ? count1 : count2;
+		int largeCount = firstSmaller ? count2 : count1;
+		for(; i < smallCount && j < largeCount; i++) {
+			j = arrayGallop(large, j, largeCount, small[i]);
+			if(j < largeCount && large[j] == small[i]) {
+				result[count++] = small[i];
+			}
+		}
+		return count;
+	}
+	while(i < count1 && j < count2) {
+		if(values1[i] < values2[j]) {
+			if(operation != OPERATION_INTERSECTION) {
+				result[count++] = values1[i];
+			}
+			i++;
+		} else if(values1[i] > values2[j]) {
+			if(operation == OPERATION_UNION) {
+				result[count++] = values2[j];
+			}
+			j++;
+		} else {
+			if(operation != OPERATION_DIFFERENCE) {
+				result[count++] = values1[i];
+			}
+			i++;
+			j++;
+		}
+	}
+	if(operation != OPERATION_INTERSECTION) {
+		for(; i < count1; i++) {
+			result[count++] = values1[i];
+		}
+	}
+	if(operation == OPERATION_UNION) {
+		for(; j < count2; j++) {
+			result[count++] = values2[j];
+		}
+	}
+	return count;
+}
+
+/**
+ * Combines two array or bitmap containers into result. The result may be
+ * empty, in which case it holds no memory.
+ */
+static bool containerCombineMutable(const Container* container1,
+		const Container* container2, Operation operation, Container* result) {
+	bool array1 = container1->type == CONTAINER_ARRAY;
+	bool array2 = container2->type == CONTAINER_ARRAY;
+	if(array1 && (array2 || operation != OPERATION_UNION)) {
+		// the result is at most as large as the arrays, keep it an array
+		int capacity = container1->cardinality + (array2 ? container2->cardinality : 0);
+		if(operation == OPERATION_UNION && capacity > ARRAY_MAX) {
+			Container bitmap;
+			if(!containerToBitmap(container1, &bitmap)) {
+				return false;
+			}
+			bool success = containerCombineMutable(&bitmap, container2, operation, result);
+			containerFree(&bitmap);
+			return success;
+		}
+		if(!containerInitArray(result, capacity)) {
+			return false;
+		}
+		if(array2) {
+			result->cardinality = arrayCombine(container1, container2, result->data.values, operation);
+			return true;
+		}
+		bool keepIfIn = operation == OPERATION_INTERSECTION;
+		for(int i = 0; i < container1->cardinality; i++) {
+			uint16_t low = container1->data.values[i];
+			if(bitmapContains(container2->data.words, low) == keepIfIn) {
+				result->data.values[result->cardinality++] = low;
+			}
+		}
+		return true;
+	}
+	if(array1) {
+		// union is symmetric, let the bitmap come first
+		return containerCombineMutable(container2, container1, operation, result);
+	}
+	if(array2 && operation == OPERATION_INTERSECTION) {
+		return containerCombineMutable(container2, container1, operation, result);
+	}
+	if(!containerToBitmap(container1, result)) {
+		return false;
+	}
+	if(array2) {
+		uint64_t* words = result->data.words;
+		for(int i = 0; i < container2->cardinality; i++) {
+			uint16_t low = container2->data.values[i];
+			uint64_t bit = 1ULL << (low & 63);
+			bool present = (words[low >> 6] & bit) != 0;
+			if(operation == OPERATION_UNION && !present) {
+				words[low >> 6] |= bit;
+				result->cardinality++;
+			} else if(operation == OPERATION_DIFFERENCE && present) {
+				words[low >> 6] &= ~bit;
+				result->cardinality--;
+			}
+		}
+	} else {
+		result->cardinality = bitmapCombine(container1->data.words,
+				container2->data.words, result->data.words, operation);
+	}
+	if(!containerShrink(result)) {
+		// a failed combine leaves no result for the caller to free
+		containerFree(result);
+		return false;
+	}
+	return true;
+}
+
+/** Combines any two containers, run containers are expanded first */
+static bool containerCombine(const Container* container1, const Container* container2,
+		Operation operation, Container* result) {
+	Container expanded1, expanded2;
+	const Container* operand1 = container1;
+	const Container* operand2 = container2;
+	if(container1->type == CONTAINER_RUN) {
+		if(!containerToMutable(container1, &expanded1)) {
+			return false;
+		}
+		operand1 = &expanded1;
+	}
+	if(container2->type == CONTAINER_RUN) {
+		if(!containerToMutable(container2, &expanded2)) {
+			if(operand1 != container1) {
+				containerFree(&expanded1);
+			}
+			return false;
+		}
+		operand2 = &expanded2;
+	}
+	bool success = containerCombineMutable(operand1, operand2, operation, result);
+	if(operand1 != container1) {
+		containerFree(&expanded1);
+	}
+	if(operand2 != container2) {
+		containerFree(&expanded2);
+	}
+	return success;
+}
+
+/** Amount of runs of consecutive values in a container */
+static int containerCountRuns(const Container* container) {
+	if(container->type == CONTAINER_RUN) {
+		return container->runCount;
+	}
+	int runs = 0;
+	if(container->type == CONTAINER_ARRAY) {
+		for(int i = 0; i < container->cardinality; i++) {
+			if(i == 0 || container->data.values[i] != container->data.values[i - 1] + 1) {
+				runs++;
+			}
+		}
+		return runs;
+	}
+	const uint64_t* words = container->data.words;
+	for(int i = 0; i < BITMAP_WORDS; i++) {
+		// a run starts at each set bit whose lower neighbour is clear
+		uint64_t previous = i > 0 ? words[i - 1] >> 63 : 0;
+		runs += __builtin_popcountll(words[i] & ~((words[i] << 1) | previous));
+	}
+	return runs;
+}
+
+/** Replaces an array or bitmap container by its runCount runs */
+static bool containerToRuns(Container* container, int runCount) {
+	Run* runs = malloc(runCount * sizeof(Run));
+	if(!runs) {
+		return false;
+	}
+	bool array = container->type == CONTAINER_ARRAY;
+	int index = 0;
+	int value = !array ? bitmapNext(container->data.words, 0)
+			: container->cardinality > 0 ? container->data.values[0] : -1;
+	int count = 0;
+	while(value >= 0) {
+		if(count > 0 && runs[count - 1].start + runs[count - 1].length + 1 == value) {
+			runs[count - 1].length++;
+		} else {
+			runs[count].start = value;
+			runs[count].length = 0;
+			count++;
+		}
+		value = !array ? bitmapNext(container->data.words, value + 1)
+				: ++index < container->cardinality ? container->data.values[index] : -1;
+	}
+	containerFree(container);
+	container->type = CONTAINER_RUN;
+	container->runCount = count;
+	container->capacity = count;
+	container->data.runs = runs;
+	return true;
+}
+
+/** Bytes a container takes in each form */
+static int containerBytes(ContainerType type, int cardinality, int runs) {
+	switch(type) {
+	case CONTAINER_ARRAY:
+		return cardinality * sizeof(uint16_t);
+	case CONTAINER_BITMAP:
+		return BITMAP_WORDS * sizeof(uint64_t);
+	default:
+		return runs * sizeof(Run);
+	}
+}
+
+/* ---------------------------------------------------------------------- */
+/* Sets                                                                    */
+/* ---------------------------------------------------------------------- */
+
+static uint16_t highBits(uint32_t value) {
+	return value >> 16;
+}
+
+static uint16_t lowBits(uint32_t value) {
+	return value & 0xFFFF;
+}
+
+/** Index of key's container, or -(insertion index) - 1 */
+static int intSetFindKey(IntSet set, uint16_t key) {
+	return arraySearch(set->keys, set->count, key);
+}
+
+static bool intSetReserve(IntSet set, int capacity) {
+	if(capacity <= set->capacity) {
+		return true;
+	}
+	int newCapacity = set->capacity ? set->capacity * 2 : 4;
+	if(newCapacity < capacity) {
+		newCapacity = capacity;
+	}
+	uint16_t* keys = realloc(set->keys, newCapacity * sizeof(uint16_t));
+	if(!keys) {
+		return false;
+	}
+	set->keys = keys;
+	Container* containers = realloc(set->containers, newCapacity * sizeof(Container));
+	if(!containers) {
+		return false;
+	}
+	set->containers = containers;
+	set->capacity = newCapacity;
+	return true;
+}
+
+/** Appends a container for a key greater than all the set's keys */
+static bool intSetAppend(IntSet set, uint16_t key, Container* container) {
+	if(!intSetReserve(set, set->count + 1)) {
+		return false;
+	}
+	set->keys[set->count] = key;
+	set->containers[set->count] = *container;
+	set->count++;
+	return true;
+}
+
+static void intSetRemoveContainer(IntSet set, int index) {
+	containerFree(&set->containers[index]);
+	memmove(set->keys + index, set->keys + index + 1,
+			(set->count - index - 1) * sizeof(uint16_t));
+	memmove(set->containers + index, set->containers + index + 1,
+			(set->count - index - 1) * sizeof(Container));
+	set->count--;
+}
+
+IntSet intSetCreate(void) {
+	IntSet set = malloc(sizeof(*set));
+	if(!set) {
+		return NULL;
+	}
+	set->keys = NULL;
+	set->containers = NULL;
+	set->count = 0;
+	set->capacity = 0;
+	set->currentContainer = -1;
+	set->currentPosition = 0;
+	set->currentLow = 0;
+	return set;
+}
+
+IntSet intSetCopy(IntSet set) {
+	if(!set) {
+		return NULL;
+	}
+	IntSet copy = intSetCreate();
+	if(!copy || !intSetReserve(copy, set->count)) {
+		intSetDestroy(copy);
+		return NULL;
+	}
+	for(int i = 0; i < set->count; i++) {
+		Container container;
+		if(!containerCopy(&set->containers[i], &container)) {
+			intSetDestroy(copy);
+			return NULL;
+		}
+		intSetAppend(copy, set->keys[i], &container);
+	}
+	return copy;
+}
+
+void intSetDestroy(IntSet set) {
+	if(!set) {
+		return;
+	}
+	intSetClear(set);
+	free(set->keys);
+	free(set->containers);
+	free(set);
+}
+
+long intSetGetSize(IntSet set) {
+	if(!set) {
+		return -1;
+	}
+	long size = 0;
+	for(int i = 0; i < set->count; i++) {
+		size += set->containers[i].cardinality;
+	}
+	return size;
+}
+
+bool intSetIsIn(IntSet set, uint32_t value) {
+	if(!set) {
+		return false;
+	}
+	int index = intSetFindKey(set, highBits(value));
+	return index >= 0 && containerContains(&set->containers[index], lowBits(value));
+}
+
+IntSetResult intSetAdd(IntSet set, uint32_t value) {
+	if(!set) {
+		return INT_SET_NULL_ARGUMENT;
+	}
+	set->currentContainer = -1;
+	int index = intSetFindKey(set, highBits(value));
+	if(index >= 0) {
+		return containerAdd(&set->containers[index], lowBits(value));
+	}
+	index = -index - 1;
+	Container container;
+	if(!intSetReserve(set, set->count + 1) || !containerInitArray(&container, 4)) {
+		return INT_SET_OUT_OF_MEMORY;
+	}
+	container.data.values[0] = lowBits(value);
+	container.cardinality = 1;
+	memmove(set->keys + index + 1, set->keys + index, (set->count - index) * sizeof(uint16_t));
+	memmove(set->containers + index + 1, set->containers + index,
+			(set->count - index) * sizeof(Container));
+	set->keys[index] = highBits(value);
+	set->containers[index] = container;
+	set->count++;
+	return INT_SET_SUCCESS;
+}
+
+IntSetResult intSetRemove(IntSet set, uint32_t value) {
+	if(!set) {
+		return INT_SET_NULL_ARGUMENT;
+	}
+	set->currentContainer = -1;
+	int index = intSetFindKey(set, highBits(value));
+	if(index < 0) {
+		return INT_SET_ITEM_DOES_NOT_EXIST;
+	}
+	IntSetResult result = containerRemove(&set->containers[index], lowBits(value));
+	if(result == INT_SET_SUCCESS && set->containers[index].cardinality == 0) {
+		intSetRemoveContainer(set, index);
+	}
+	return result;
+}
+
+IntSetResult intSetClear(IntSet set) {
+	if(!set) {
+		return INT_SET_NULL_ARGUMENT;
+	}
+	for(int i = 0; i < set->count; i++) {
+		containerFree(&set->containers[i]);
+	}
+	set->count = 0;
+	set->currentContainer = -1;
+	return INT_SET_SUCCESS;
+}
+
+/** Moves the iterator to the first value of container index or after it */
+static bool intSetIteratorEnter(IntSet set, int index, uint32_t* value) {
+	if(index >= set->count) {
+		set->currentContainer = -1;
+		return false;
+	}
+	const Container* container = &set->containers[index];
+	set->currentContainer = index;
+	set->currentPosition = 0;
+	switch(container->type) {
+	case CONTAINER_ARRAY:
+		set->currentLow = container->data.values[0];
+		break;
+	case CONTAINER_BITMAP:
+		set->currentLow = bitmapNext(container->data.words, 0);
+		break;
+	default:
+		set->currentLow = container->data.runs[0].start;
+	}
+	*value = ((uint32_t)set->keys[index] << 16) | set->currentLow;
+	return true;
+}
+
+bool intSetGetFirst(IntSet set, uint32_t* value) {
+	if(!set || !value) {
+		return false;
+	}
+	return intSetIteratorEnter(set, 0, value);
+}
+
+bool intSetGetNext(IntSet set, uint32_t* value) {
+	if(!set || !value || set->currentContainer < 0) {
+		return false;
+	}
+	const Container* container = &set->containers[set->currentContainer];
+	int next = -1;
+	switch(container->type) {
+	case CONTAINER_ARRAY:
+		if(set->currentPosition + 1 < container->cardinality) {
+			next = container->data.values[++set->currentPosition];
+		}
+		break;
+	case CONTAINER_BITMAP:
+		next = bitmapNext(container->data.words, set->currentLow + 1);
+		break;
+	default: {
+		const Run* run = &container->data.runs[set->currentPosition];
+		if(set->currentLow < run->start + run->length) {
+			next = set->currentLow + 1;
+		} else if(set->currentPosition + 1 < container->runCount) {
+			next = container->data.runs[++set->currentPosition].start;
+		}
+	}
+	}
+	if(next < 0) {
+		return intSetIteratorEnter(set, set->currentContainer + 1, value);
+	}
+	set->currentLow = next;
+	*value = ((uint32_t)set->keys[set->currentContainer] << 16) | set->currentLow;
+	return true;
+}
+
+/**
+ * Merges the ordered keys of set1 and set2 and combines the containers of
+ * keys found in both, container by container.
+ */
+static IntSet intSetCombine(IntSet set1, IntSet set2, Operation operation) {
+	if(!set1 || !set2) {
+		return NULL;
+	}
+	IntSet result = intSetCreate();
+	if(!result) {
+		return NULL;
+	}
+	int i = 0, j = 0;
+	while(i < set1->count || (j < set2->count && operation == OPERATION_UNION)) {
+		int compare = j == set2->count ? -1 : i == set1->count ? 1 :
+				(int)set1->keys[i] - (int)set2->keys[j];
+		uint16_t key = compare <= 0 ? set1->keys[i] : set2->keys[j];
+		Container container;
+		container.cardinality = 0;
+		bool success = true;
+		if(compare < 0) {
+			if(operation != OPERATION_INTERSECTION) {
+				success = containerCopy(&set1->containers[i], &container);
+			}
+			i++;
+		} else if(compare > 0) {
+			if(operation == OPERATION_UNION) {
+				success = containerCopy(&set2->containers[j], &container);
+			}
+			j++;
+		} else {
+			success = containerCombine(&set1->containers[i], &set2->containers[j],
+					operation, &container);
+			i++;
+			j++;
+		}
+		if(success && container.cardinality == 0) {
+			if(compare == 0) {
+				containerFree(&container);
+			}
+			continue;
+		}
+		if(!success || !intSetAppend(result, key, &container)) {
+			if(success) {
+				containerFree(&container);
+			}
+			intSetDestroy(result);
+			return NULL;
+		}
+	}
+	return result;
+}
+
+IntSet intSetUnion(IntSet set1, IntSet set2) {
+	return intSetCombine(set1, set2, OPERATION_UNION);
+}
+
+IntSet intSetIntersection(IntSet set1, IntSet set2) {
+	return intSetCombine(set1, set2, OPERATION_INTERSECTION);
+}
+
+IntSet intSetDifference(IntSet set1, IntSet set2) {
+	return intSetCombine(set1, set2, OPERATION_DIFFERENCE);
+}
+
+long intSetIntersectionSize(IntSet set1, IntSet set2) {
+	if(!set1 || !set2) {
+		return -1;
+	}
+	long size = 0;
+	int i = 0, j = 0;
+	while(i < set1->count && j < set2->count) {
+		if(set1->keys[i] != set2->keys[j]) {
+			set1->keys[i] < set2->keys[j] ? i++ : j++;
+			continue;
+		}
+		const Container* container1 = &set1->containers[i++];
+		const Container* container2 = &set2->containers[j++];
+		if(container1->type == CONTAINER_BITMAP && container2->type == CONTAINER_BITMAP) {
+			size += bitmapIntersectionSize(container1->data.words, container2->data.words);
+			continue;
+		}
+		Container intersection;
+		if(!containerCombine(container1, container2, OPERATION_INTERSECTION, &intersection)) {
+			return -1;
+		}
+		size += intersection.cardinality;
+		containerFree(&intersection);
+	}
+	return size;
+}
+
+IntSetResult intSetRunOptimize(IntSet set) {
+	if(!set) {
+		return INT_SET_NULL_ARGUMENT;
+	}
+	set->currentContainer = -1;
+	for(int i = 0; i < set->count; i++) {
+		Container* container = &set->containers[i];
+		if(container->type == CONTAINER_RUN) {
+			continue;
+		}
+		int runs = containerCountRuns(container);
+		int current = containerBytes(container->type, container->cardinality, runs);
+		if(containerBytes(CONTAINER_RUN, container->cardinality, runs) < current
+				&& !containerToRuns(container, runs)) {
+			return INT_SET_OUT_OF_MEMORY;
+		}
+	}
+	return INT_SET_SUCCESS;
+}
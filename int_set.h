@@ -0,0 +1,206 @@
+#ifndef INT_SET_H_
+#define INT_SET_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+* Compressed Integer Set Container
+*
+* Implements a set of 32 bit unsigned integers, as a sibling of the generic
+* Set for sets of dense integer IDs. Values are not copied into the heap one
+* by one: they are grouped by their 16 high bits, and each group is stored in
+* the smallest of three containers (Roaring bitmap style):
+*   array  - a sorted array of the 16 low bits, for up to 4096 values
+*   bitmap - 2^16 bits, for more than 4096 values
+*   run    - a sorted array of [start, start + length] intervals, chosen by
+*            intSetRunOptimize when it is the smallest
+* Set operations are done container by container, bitmaps are combined a
+* machine word (or an AVX2 register when compiled with -mavx2) at a time.
+*
+* The set has an internal iterator for external use. For all functions
+* where the state of the iterator after calling that function is not stated,
+* it is undefined. That is you cannot assume anything about it.
+*
+* The following functions are available:
+*   intSetCreate		- Creates a new empty set
+*   intSetCopy			- Copies an existing set
+*   intSetDestroy		- Deletes an existing set and frees all resources
+*   intSetGetSize		- Returns the amount of values in a given set
+*   intSetIsIn			- returns weather or not a value exists in the set.
+*   intSetAdd			- Adds a value to the set.
+*   intSetRemove		- Removes a value from the set.
+*   intSetClear		- Clears the contents of the set.
+*   intSetGetFirst		- Sets the internal iterator to the smallest value.
+*   intSetGetNext		- Advances the internal iterator to the next value.
+*   intSetUnion		- Creates a new set of the values found in either set.
+*   intSetIntersection	- Creates a new set of the values found in both sets.
+*   intSetDifference	- Creates a new set of the values of the first set that
+*   					  are not in the second.
+*   intSetIntersectionSize - Counts the values found in both sets.
+*   intSetRunOptimize	- Converts containers to runs where it saves memory.
+*   INT_SET_FOREACH	- A macro for iterating over the set's values.
+*/
+
+/** Type for defining the set */
+typedef struct IntSet_t *IntSet;
+
+/** Type used for returning error codes from integer set functions */
+typedef enum IntSetResult_t {
+	INT_SET_SUCCESS,
+	INT_SET_OUT_OF_MEMORY,
+	INT_SET_NULL_ARGUMENT,
+	INT_SET_ITEM_ALREADY_EXISTS,
+	INT_SET_ITEM_DOES_NOT_EXIST
+} IntSetResult;
+
+/**
+* intSetCreate: Allocates a new empty set.
+* @return
+* 	NULL - if allocations failed.
+* 	A new IntSet in case of success.
+*/
+IntSet intSetCreate(void);
+
+/**
+* intSetCopy: Creates a copy of target set.
+* @return
+* 	NULL if a NULL was sent or a memory allocation failed.
+* 	An IntSet containing the same values as set otherwise.
+*/
+IntSet intSetCopy(IntSet set);
+
+/**
+* intSetDestroy: Deallocates an existing set.
+* @param set - Target set to be deallocated. If set is NULL nothing will be
+* 		done
+*/
+void intSetDestroy(IntSet set);
+
+/**
+* intSetGetSize: Returns the amount of values in a set, in O(containers).
+* @return
+* 	-1 if a NULL pointer was sent.
+* 	Otherwise the amount of values in the set.
+*/
+long intSetGetSize(IntSet set);
+
+/**
+* intSetIsIn: Checks if a value exists in the set.
+* Does not modify the internal iterator.
+* @return
+* 	false - if the input set is null, or if the value was not found.
+* 	true - if the value was found in the set.
+*/
+bool intSetIsIn(IntSet set, uint32_t value);
+
+/**
+* intSetAdd: Adds a value to the set.
+* Iterator's value is undefined after this operation.
+* @return
+* 	INT_SET_NULL_ARGUMENT if a NULL was sent as set
+* 	INT_SET_OUT_OF_MEMORY if an allocation failed
+* 	INT_SET_ITEM_ALREADY_EXISTS if the value already exists in the set
+* 	INT_SET_SUCCESS the value has been inserted successfully
+*/
+IntSetResult intSetAdd(IntSet set, uint32_t value);
+
+/**
+* intSetRemove: Removes a value from the set.
+* Iterator's value is undefined after this operation.
+* @return
+* 	INT_SET_NULL_ARGUMENT if a NULL was sent as set
+* 	INT_SET_OUT_OF_MEMORY if the value's container had to be converted and
+* 	an allocation failed
+* 	INT_SET_ITEM_DOES_NOT_EXIST if the value doesn't exist in the set
+* 	INT_SET_SUCCESS if the value was successfully removed.
+*/
+IntSetResult intSetRemove(IntSet set, uint32_t value);
+
+/**
+* intSetClear: Removes all values from target set.
+* @return
+* 	INT_SET_NULL_ARGUMENT - if a NULL pointer was sent.
+* 	INT_SET_SUCCESS - Otherwise.
+*/
+IntSetResult intSetClear(IntSet set);
+
+/**
+* intSetGetFirst: Sets the internal iterator to the smallest value in the set.
+* @param set - The set for which to set the iterator.
+* @param value - Receives the smallest value.
+* @return
+* 	false if a NULL pointer was sent or the set is empty.
+* 	true otherwise.
+*/
+bool intSetGetFirst(IntSet set, uint32_t* value);
+
+/**
+* intSetGetNext: Advances the set iterator to the next value in increasing
+* order.
+* @param set - The set for which to advance the iterator.
+* @param value - Receives the next value.
+* @return
+* 	false if reached the end of the set, or the iterator is at an invalid
+* 	state or a NULL sent as argument.
+* 	true otherwise.
+*/
+bool intSetGetNext(IntSet set, uint32_t* value);
+
+/**
+* intSetUnion: Creates a new set of the values that are in set1, in set2 or
+* in both.
+* @return
+*   NULL if a NULL pointer was sent or memory allocation failed,
+*   the new set otherwise.
+*/
+IntSet intSetUnion(IntSet set1, IntSet set2);
+
+/**
+* intSetIntersection: Creates a new set of the values that are in both sets.
+* @return
+*   NULL if a NULL pointer was sent or memory allocation failed,
+*   the new set otherwise.
+*/
+IntSet intSetIntersection(IntSet set1, IntSet set2);
+
+/**
+* intSetDifference: Creates a new set of the values of set1 that are not in
+* set2.
+* @return
+*   NULL if a NULL pointer was sent or memory allocation failed,
+*   the new set otherwise.
+*/
+IntSet intSetDifference(IntSet set1, IntSet set2);
+
+/**
+* intSetIntersectionSize: Counts the values that are in both sets, without
+* building their intersection when both containers are bitmaps.
+* @return
+*   -1 if a NULL pointer was sent or memory allocation failed,
+*   the amount of common values otherwise.
+*/
+long intSetIntersectionSize(IntSet set1, IntSet set2);
+
+/**
+* intSetRunOptimize: Converts every container that takes less memory as runs
+* of consecutive values into a run container.
+* Later insertions or removals into a run container convert it back.
+* Iterator's value is undefined after this operation.
+* @return
+*   INT_SET_NULL_ARGUMENT if a NULL pointer was sent.
+*   INT_SET_OUT_OF_MEMORY if an allocation failed, the set is intact then.
+*   INT_SET_SUCCESS otherwise.
+*/
+IntSetResult intSetRunOptimize(IntSet set);
+
+/*!
+* Macro for iterating over an integer set in increasing order.
+* Declares a uint32_t variable named iterator for the loop.
+*/
+#define INT_SET_FOREACH(iterator,set) \
+	for(uint32_t iterator, iterator##_valid = intSetGetFirst(set, &iterator) ; \
+		iterator##_valid ;\
+		iterator##_valid = intSetGetNext(set, &iterator))
+
+#endif /* INT_SET_H_ */
@@ -0,0 +1,180 @@
+#ifndef INTRUSIVE_LIST_H_
+#define INTRUSIVE_LIST_H_
+
+#include <cstdlib>
+#include <type_traits>
+
+/**
+ * A link embedded inside a user's object, so it can be chained by an
+ * IntrusiveList without allocating a node for it. The object inherits the
+ * hook, which lets the list get from a hook back to its object with a
+ * static_cast, resolved at compile time.
+ * An object may inherit several hooks, told apart by their Tag, in order to
+ * be a member of several lists at once, and each hook can be linked into at
+ * most one list at a time.
+ */
+template<class Tag = void>
+class IntrusiveListHook {
+	IntrusiveListHook* _next;
+	IntrusiveListHook* _prev;
+	template<class T, class ListTag> friend class IntrusiveList;
+public:
+	IntrusiveListHook() : _next(NULL), _prev(NULL) {}
+	/**
+	 * The hook is tied to the address of its object, copying the object
+	 * does not copy its membership.
+	 */
+	IntrusiveListHook(const IntrusiveListHook&) : _next(NULL), _prev(NULL) {}
+	IntrusiveListHook& operator=(const IntrusiveListHook&) {
+		return *this;
+	}
+	bool isLinked() const {
+		return _next != NULL;
+	}
+	/**
+	 * Removes the hook from whichever list it is linked into, in O(1).
+	 */
+	void unlink() {
+		if(!_next) {
+			return;
+		}
+		_prev->_next = _next;
+		_next->_prev = _prev;
+		_next = NULL;
+		_prev = NULL;
+	}
+};
+
+#define intrusiveListTemplate <T, Tag>
+
+/**
+ * A doubly linked list of objects that inherit an IntrusiveListHook<Tag>.
+ * The list never allocates nor owns its objects: insert only links the
+ * object's hook, and an object must be removed (or destroyed after being
+ * removed) before the list is.
+ *
+ * For example, an object that can be chained in a hash bucket and in a
+ * queue at once:
+ * @code
+ * struct BucketTag;
+ * struct QueueTag;
+ * class Troll : public IntrusiveListHook<BucketTag>,
+ *		public IntrusiveListHook<QueueTag> {
+ * public:
+ *     int _TrollID;
+ * };
+ * IntrusiveList<Troll, BucketTag> bucket;
+ * IntrusiveList<Troll, QueueTag> queue;
+ * @endcode
+ */
+template<class T, class Tag = void>
+class IntrusiveList {
+	typedef IntrusiveListHook<Tag> Hook;
+	Hook _sentinel;
+
+	static Hook* hookOf(T* object) {
+		static_assert(std::is_base_of<Hook, T>::value,
+				"T must inherit IntrusiveListHook<Tag>");
+		return static_cast<Hook*>(object);
+	}
+	static T* objectOf(Hook* hook) {
+		return static_cast<T*>(hook);
+	}
+public:
+	class iterator;
+	IntrusiveList() {
+		_sentinel._next = &_sentinel;
+		_sentinel._prev = &_sentinel;
+	}
+	IntrusiveList(const IntrusiveList& list) = delete;
+	IntrusiveList& operator=(const IntrusiveList& list) = delete;
+	/**
+	 * Unlinks all the objects, the objects themselves are left untouched.
+	 */
+	~IntrusiveList() {
+		clear();
+	}
+	/**
+	 * Links object to the end of the list, in O(1).
+	 * object must not currently be linked through the same hook.
+	 */
+	void insert(T* object) {
+		Hook* hook = hookOf(object);
+		hook->_prev = _sentinel._prev;
+		hook->_next = &_sentinel;
+		_sentinel._prev->_next = hook;
+		_sentinel._prev = hook;
+	}
+	/**
+	 * Links object to the beginning of the list, in O(1).
+	 */
+	void insertFirst(T* object) {
+		Hook* hook = hookOf(object);
+		hook->_next = _sentinel._next;
+		hook->_prev = &_sentinel;
+		_sentinel._next->_prev = hook;
+		_sentinel._next = hook;
+	}
+	/**
+	 * Unlinks object from the list, in O(1).
+	 */
+	void remove(T* object) {
+		hookOf(object)->unlink();
+	}
+	/**
+	 * Unlinks all the objects from the list.
+	 */
+	void clear() {
+		while(_sentinel._next != &_sentinel) {
+			_sentinel._next->unlink();
+		}
+	}
+	bool empty() const {
+		return _sentinel._next == &_sentinel;
+	}
+	T* front() const {
+		return empty() ? NULL : objectOf(_sentinel._next);
+	}
+	T* back() const {
+		return empty() ? NULL : objectOf(_sentinel._prev);
+	}
+
+	iterator begin() const {
+		return iterator(this, _sentinel._next);
+	}
+
+	iterator end() const {
+		return iterator(this, const_cast<Hook*>(&_sentinel));
+	}
+};
+
+template<class T, class Tag>
+class IntrusiveList intrusiveListTemplate::iterator {
+	const IntrusiveList* _list;
+	Hook* _current;
+	friend class IntrusiveList;
+public:
+	explicit iterator(const IntrusiveList* list = NULL, Hook* current = NULL)
+	: _list(list), _current(current) { }
+	iterator(const iterator& it) : _list(it._list), _current(it._current) { }
+	iterator& operator=(const iterator& it) = default;
+	bool operator==(const iterator& iterator) const {
+		return (_list == iterator._list && _current == iterator._current);
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+	iterator& operator++() {
+		if(*this == _list->end()) {
+			return *this;
+		}
+		_current = _current->_next;
+		return *this;
+	}
+	T& operator*() const {
+		return *objectOf(_current);
+	}
+};
+
+
+#endif /* INTRUSIVE_LIST_H_ */
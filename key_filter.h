@@ -0,0 +1,256 @@
+#ifndef KEY_FILTER_H_
+#define KEY_FILTER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * Approximate membership filters that Tree, MtmMap and HashTable consult
+ * before a search, so that most searches for absent keys end after reading
+ * one cache line instead of walking the container.
+ *
+ * A filter never forgets a key it was given, it only answers "maybe" for
+ * some keys it wasn't given (about 1% of them at the default sizes), so a
+ * container only searches its structure on a "maybe". Keys removed from the
+ * container stay in the filter: they make it answer "maybe" more often, never
+ * wrongly.
+ *
+ * The containers hold a KeyFilter through attachFilter(), and don't own it:
+ * @code
+ * BloomFilter<int> filter(100000);
+ * mtm::MtmMap<int, int> map(0);
+ * map.attachFilter(&filter);
+ * map.containsKey(42); // false without walking the map
+ * @endcode
+ */
+
+/**
+ * Mixes the bits of a std::hash, which is the identity for integers on most
+ * standard libraries.
+ */
+inline uint64_t keyFilterMix(uint64_t hash) {
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	return hash ^ (hash >> 33);
+}
+
+/**
+ * The interface the containers consult, T is the type they search by.
+ */
+template<class T>
+class KeyFilter {
+public:
+	virtual ~KeyFilter() {}
+	/**
+	 * Returns false only if value was never added.
+	 */
+	virtual bool mayContain(const T& value) const = 0;
+	/**
+	 * Adds value to the filter. Returns false if the filter can't take new
+	 * values (it was built for a fixed set), the container then stops
+	 * consulting it.
+	 */
+	virtual bool add(const T& value) = 0;
+};
+
+/**
+ * A blocked Bloom filter, for containers that keep changing: each value
+ * sets one bit in each of the 8 words of a single 32 byte block, so a test
+ * reads one cache line. It can take any amount of values, yet more values
+ * than it was sized for raise the rate of false "maybe"s (about 0.5% at 16
+ * bits per value, 1% at 12 and 2% at 10).
+ */
+template<class T, class Hash = std::hash<T> >
+class BloomFilter : public KeyFilter<T> {
+	struct alignas(32) Block {
+		uint32_t _words[8];
+	};
+	static const uint32_t SALTS[8];
+	std::vector<Block> _blocks;
+	Hash _hasher;
+
+	size_t blockOf(uint64_t hash) const {
+		return (size_t)(((hash >> 32) * _blocks.size()) >> 32);
+	}
+	static uint32_t maskOf(uint64_t hash, int word) {
+		return 1u << (((uint32_t)hash * SALTS[word]) >> 27);
+	}
+public:
+	/**
+	 * Creates an empty filter sized for expectedValues values, of bitsPerValue
+	 * bits each.
+	 */
+	explicit BloomFilter(size_t expectedValues, unsigned int bitsPerValue = 12)
+	: _blocks(std::max<size_t>(1, (expectedValues * bitsPerValue + 255) / 256), Block()) {}
+
+	bool mayContain(const T& value) const {
+		uint64_t hash = keyFilterMix(_hasher(value));
+		const Block& block = _blocks[blockOf(hash)];
+		uint32_t missing = 0;
+		for(int word = 0; word < 8; word++) {
+			missing |= maskOf(hash, word) & ~block._words[word];
+		}
+		return missing == 0;
+	}
+
+	bool add(const T& value) {
+		uint64_t hash = keyFilterMix(_hasher(value));
+		Block& block = _blocks[blockOf(hash)];
+		for(int word = 0; word < 8; word++) {
+			block._words[word] |= maskOf(hash, word);
+		}
+		return true;
+	}
+
+	/**
+	 * Forgets all the values, e.g. to refill the filter after many removals.
+	 */
+	void clear() {
+		std::fill(_blocks.begin(), _blocks.end(), Block());
+	}
+
+	size_t bytes() const {
+		return _blocks.size() * sizeof(Block);
+	}
+};
+
+template<class T, class Hash>
+const uint32_t BloomFilter<T, Hash>::SALTS[8] = { 0x47b6137bU, 0x44974d91U,
+		0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U };
+
+/**
+ * An xor filter, for containers whose keys are fixed (e.g. loaded once and
+ * then only searched): 8 bit fingerprints, about 9.9 bits per value and a
+ * 0.4% rate of false "maybe"s, in exchange for being built at once from all
+ * of its values. Adding a value it wasn't built with fails, and detaches it
+ * from its container.
+ */
+template<class T, class Hash = std::hash<T> >
+class XorFilter : public KeyFilter<T> {
+	static const int MAX_ATTEMPTS = 64;
+	std::vector<uint8_t> _fingerprints;
+	size_t _blockLength;
+	uint64_t _seed;
+	Hash _hasher;
+
+	uint64_t hashOf(const T& value) const {
+		return keyFilterMix(_hasher(value) + _seed);
+	}
+	static uint8_t fingerprintOf(uint64_t hash) {
+		return (uint8_t)(hash ^ (hash >> 32));
+	}
+	size_t slotOf(uint64_t hash, int block) const {
+		uint32_t bits = (uint32_t)((hash << (21 * block)) | (hash >> ((64 - 21 * block) & 63)));
+		return block * _blockLength + (size_t)(((uint64_t)bits * _blockLength) >> 32);
+	}
+	bool build(const std::vector<uint64_t>& hashes);
+public:
+	/**
+	 * Builds the filter of values (which may repeat).
+	 * @throws std::runtime_error if the values can't be placed with any of
+	 * the seeds tried, which is very unlikely
+	 */
+	explicit XorFilter(const std::vector<T>& values);
+
+	bool mayContain(const T& value) const {
+		uint64_t hash = hashOf(value);
+		return fingerprintOf(hash) == (_fingerprints[slotOf(hash, 0)]
+				^ _fingerprints[slotOf(hash, 1)] ^ _fingerprints[slotOf(hash, 2)]);
+	}
+
+	/**
+	 * Succeeds only for values the filter (may) already hold.
+	 */
+	bool add(const T& value) {
+		return mayContain(value);
+	}
+
+	size_t bytes() const {
+		return _fingerprints.size();
+	}
+};
+
+template<class T, class Hash>
+XorFilter<T, Hash>::XorFilter(const std::vector<T>& values)
+: _blockLength((32 + values.size() * 123 / 100) / 3 + 1), _seed(0) {
+	for(int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+		_seed = keyFilterMix(attempt + 1);
+		std::vector<uint64_t> hashes;
+		hashes.reserve(values.size());
+		for(size_t i = 0; i < values.size(); i++) {
+			hashes.push_back(hashOf(values[i]));
+		}
+		std::sort(hashes.begin(), hashes.end());
+		hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+		if(build(hashes)) {
+			return;
+		}
+	}
+	throw std::runtime_error("the values of the xor filter can't be placed");
+}
+
+/**
+ * Peels the 3-partite hypergraph of the hashes: a slot that only one hash
+ * maps to is given to that hash, which is then taken out of its two other
+ * slots, until no hash is left. The fingerprints are then set in reverse
+ * order, each to what makes its hash's three slots xor to its fingerprint.
+ */
+template<class T, class Hash>
+bool XorFilter<T, Hash>::build(const std::vector<uint64_t>& hashes) {
+	const size_t slots = 3 * _blockLength;
+	std::vector<uint32_t> counts(slots, 0);
+	std::vector<uint64_t> xors(slots, 0);
+	for(size_t i = 0; i < hashes.size(); i++) {
+		for(int block = 0; block < 3; block++) {
+			size_t slot = slotOf(hashes[i], block);
+			counts[slot]++;
+			xors[slot] ^= hashes[i];
+		}
+	}
+	std::vector<size_t> singles;
+	for(size_t slot = 0; slot < slots; slot++) {
+		if(counts[slot] == 1) {
+			singles.push_back(slot);
+		}
+	}
+	// the peeled hashes, and the slot each of them was given
+	std::vector<std::pair<uint64_t, size_t> > peeled;
+	peeled.reserve(hashes.size());
+	while(!singles.empty()) {
+		size_t slot = singles.back();
+		singles.pop_back();
+		if(counts[slot] != 1) {
+			continue;
+		}
+		uint64_t hash = xors[slot];
+		peeled.push_back(std::make_pair(hash, slot));
+		for(int block = 0; block < 3; block++) {
+			size_t other = slotOf(hash, block);
+			counts[other]--;
+			xors[other] ^= hash;
+			if(counts[other] == 1) {
+				singles.push_back(other);
+			}
+		}
+	}
+	if(peeled.size() != hashes.size()) {
+		return false;
+	}
+	_fingerprints.assign(slots, 0);
+	for(size_t i = peeled.size(); i > 0; i--) {
+		uint64_t hash = peeled[i - 1].first;
+		size_t slot = peeled[i - 1].second;
+		_fingerprints[slot] = fingerprintOf(hash) ^ _fingerprints[slotOf(hash, 0)]
+				^ _fingerprints[slotOf(hash, 1)] ^ _fingerprints[slotOf(hash, 2)];
+	}
+	return true;
+}
+
+#endif /* KEY_FILTER_H_ */
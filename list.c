@@ -0,0 +1,599 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "list.h"
+
+/** The first node block holds this many nodes, each further block doubles */
+#define FIRST_BLOCK_NODES 16
+/** Largest amount of nodes allocated at once */
+#define MAX_BLOCK_NODES 4096
+/** Smallest amount of elements worth handing to a thread of its own */
+#define MIN_ELEMENTS_PER_THREAD 4096
+
+typedef struct Node_t {
+	ListElement element;
+	struct Node_t* next;
+	struct Node_t* previous;
+} *Node;
+
+/**
+ * Nodes are allocated in blocks and recycled through a free list owned by the
+ * list, so inserting and removing elements rarely reach malloc.
+ */
+typedef struct NodeBlock_t {
+	struct NodeBlock_t* next;
+	int capacity;
+	struct Node_t nodes[];
+} *NodeBlock;
+
+struct List_t {
+	Node head;
+	Node tail;
+	Node current;
+	int size;
+	Node freeNodes;
+	NodeBlock blocks;
+	int nextBlockCapacity;
+	CopyListElement copyElement;
+	FreeListElement freeElement;
+};
+
+static bool listGrowPool(List list) {
+	int capacity = list->nextBlockCapacity;
+	NodeBlock block = malloc(sizeof(*block) + capacity * sizeof(struct Node_t));
+	if(!block) {
+		return false;
+	}
+	block->capacity = capacity;
+	block->next = list->blocks;
+	list->blocks = block;
+	for(int i = 0; i < capacity; i++) {
+		block->nodes[i].next = list->freeNodes;
+		list->freeNodes = &block->nodes[i];
+	}
+	if(capacity < MAX_BLOCK_NODES) {
+		list->nextBlockCapacity = capacity * 2;
+	}
+	return true;
+}
+
+static Node nodeAllocate(List list, ListElement element) {
+	if(!list->freeNodes && !listGrowPool(list)) {
+		return NULL;
+	}
+	Node node = list->freeNodes;
+	list->freeNodes = node->next;
+	node->element = element;
+	node->next = NULL;
+	node->previous = NULL;
+	return node;
+}
+
+static void nodeRelease(List list, Node node) {
+	node->next = list->freeNodes;
+	list->freeNodes = node;
+}
+
+/** Links node right after previous, or first in the list if previous is NULL */
+static void nodeLinkAfter(List list, Node previous, Node node) {
+	Node next = previous ? previous->next : list->head;
+	node->previous = previous;
+	node->next = next;
+	previous ? (previous->next = node) : (list->head = node);
+	next ? (next->previous = node) : (list->tail = node);
+	list->size++;
+}
+
+static void nodeUnlink(List list, Node node) {
+	node->previous ? (node->previous->next = node->next) : (list->head = node->next);
+	node->next ? (node->next->previous = node->previous) : (list->tail = node->previous);
+	list->size--;
+}
+
+/** Links element itself (not a copy) right after previous */
+static ListResult listAdoptAfterNode(List list, Node previous, ListElement element) {
+	Node node = nodeAllocate(list, element);
+	if(!node) {
+		return LIST_OUT_OF_MEMORY;
+	}
+	nodeLinkAfter(list, previous, node);
+	return LIST_SUCCESS;
+}
+
+static ListResult listInsertAfterNode(List list, Node previous, ListElement element) {
+	ListElement copy = list->copyElement(element);
+	if(!copy) {
+		return LIST_OUT_OF_MEMORY;
+	}
+	if(listAdoptAfterNode(list, previous, copy) != LIST_SUCCESS) {
+		list->freeElement(copy);
+		return LIST_OUT_OF_MEMORY;
+	}
+	return LIST_SUCCESS;
+}
+
+List listCreate(CopyListElement copyElement, FreeListElement freeElement) {
+	if(!copyElement || !freeElement) {
+		return NULL;
+	}
+	List list = malloc(sizeof(*list));
+	if(!list) {
+		return NULL;
+	}
+	list->head = NULL;
+	list->tail = NULL;
+	list->current = NULL;
+	list->size = 0;
+	list->freeNodes = NULL;
+	list->blocks = NULL;
+	list->nextBlockCapacity = FIRST_BLOCK_NODES;
+	list->copyElement = copyElement;
+	list->freeElement = freeElement;
+	return list;
+}
+
+List listCopy(List list) {
+	if(!list) {
+		return NULL;
+	}
+	List copy = listCreate(list->copyElement, list->freeElement);
+	if(!copy) {
+		return NULL;
+	}
+	for(Node node = list->head; node; node = node->next) {
+		if(listInsertAfterNode(copy, copy->tail, node->element) != LIST_SUCCESS) {
+			listDestroy(copy);
+			return NULL;
+		}
+		if(node == list->current) {
+			copy->current = copy->tail;
+		}
+	}
+	return copy;
+}
+
+int listGetSize(List list) {
+	if(!list) {
+		return -1;
+	}
+	return list->size;
+}
+
+ListElement listGetFirst(List list) {
+	if(!list) {
+		return NULL;
+	}
+	list->current = list->head;
+	return listGetCurrent(list);
+}
+
+ListElement listGetNext(List list) {
+	if(!list || !list->current) {
+		return NULL;
+	}
+	list->current = list->current->next;
+	return listGetCurrent(list);
+}
+
+ListElement listGetCurrent(List list) {
+	if(!list || !list->current) {
+		return NULL;
+	}
+	return list->current->element;
+}
+
+ListResult listInsertFirst(List list, ListElement element) {
+	if(!list) {
+		return LIST_NULL_ARGUMENT;
+	}
+	return listInsertAfterNode(list, NULL, element);
+}
+
+ListResult listInsertLast(List list, ListElement element) {
+	if(!list) {
+		return LIST_NULL_ARGUMENT;
+	}
+	return listInsertAfterNode(list, list->tail, element);
+}
+
+ListResult listInsertFirstOwned(List list, ListElement element) {
+	if(!list || !element) {
+		return LIST_NULL_ARGUMENT;
+	}
+	return listAdoptAfterNode(list, NULL, element);
+}
+
+ListResult listInsertLastOwned(List list, ListElement element) {
+	if(!list || !element) {
+		return LIST_NULL_ARGUMENT;
+	}
+	return listAdoptAfterNode(list, list->tail, element);
+}
+
+ListResult listInsertBeforeCurrent(List list, ListElement element) {
+	if(!list) {
+		return LIST_NULL_ARGUMENT;
+	}
+	if(!list->current) {
+		return LIST_INVALID_CURRENT;
+	}
+	return listInsertAfterNode(list, list->current->previous, element);
+}
+
+ListResult listInsertAfterCurrent(List list, ListElement element) {
+	if(!list) {
+		return LIST_NULL_ARGUMENT;
+	}
+	if(!list->current) {
+		return LIST_INVALID_CURRENT;
+	}
+	return listInsertAfterNode(list, list->current, element);
+}
+
+ListResult listRemoveCurrent(List list) {
+	if(!list) {
+		return LIST_NULL_ARGUMENT;
+	}
+	if(!list->current) {
+		return LIST_INVALID_CURRENT;
+	}
+	list->freeElement(listExtractCurrent(list));
+	return LIST_SUCCESS;
+}
+
+ListElement listExtractCurrent(List list) {
+	if(!list || !list->current) {
+		return NULL;
+	}
+	Node node = list->current;
+	ListElement element = node->element;
+	nodeUnlink(list, node);
+	nodeRelease(list, node);
+	list->current = NULL;
+	return element;
+}
+
+/**
+ * Stable bottom-up merge sort of a NULL terminated chain of nodes, linked
+ * through next only. Runs of doubling length are merged in place, so no
+ * memory is allocated and the recursion depth is constant.
+ * An element is placed after an element it compares greater than.
+ */
+static Node sortNodes(Node head, CompareListElements compareElement) {
+	for(int runSize = 1; ; runSize *= 2) {
+		Node left = head;
+		Node tail = NULL;
+		int merges = 0;
+		head = NULL;
+		while(left) {
+			merges++;
+			Node right = left;
+			int leftSize = 0;
+			for(int i = 0; i < runSize && right; i++) {
+				leftSize++;
+				right = right->next;
+			}
+			int rightSize = runSize;
+			while(leftSize > 0 || (rightSize > 0 && right)) {
+				Node next;
+				if(leftSize == 0 || (rightSize > 0 && right
+						&& compareElement(left->element, right->element) > 0)) {
+					next = right;
+					right = right->next;
+					rightSize--;
+				} else {
+					next = left;
+					left = left->next;
+					leftSize--;
+				}
+				tail ? (tail->next = next) : (head = next);
+				tail = next;
+			}
+			left = right;
+		}
+		tail->next = NULL;
+		if(merges <= 1) {
+			return head;
+		}
+	}
+}
+
+/** Restores the previous links and the tail after relinking through next */
+static void listRelinkPrevious(List list) {
+	Node previous = NULL;
+	for(Node node = list->head; node; node = node->next) {
+		node->previous = previous;
+		previous = node;
+	}
+	list->tail = previous;
+}
+
+ListResult listSort(List list, CompareListElements compareElement) {
+	if(!list || !compareElement) {
+		return LIST_NULL_ARGUMENT;
+	}
+	list->current = NULL;
+	if(list->size < 2) {
+		return LIST_SUCCESS;
+	}
+	list->head = sortNodes(list->head, compareElement);
+	listRelinkPrevious(list);
+	return LIST_SUCCESS;
+}
+
+List listFilter(List list, FilterListElement filterElement, ListFilterKey key) {
+	if(!list || !filterElement) {
+		return NULL;
+	}
+	List filtered = listCreate(list->copyElement, list->freeElement);
+	if(!filtered) {
+		return NULL;
+	}
+	for(Node node = list->head; node; node = node->next) {
+		if(!filterElement(node->element, key)) {
+			continue;
+		}
+		if(listInsertAfterNode(filtered, filtered->tail, node->element) != LIST_SUCCESS) {
+			listDestroy(filtered);
+			return NULL;
+		}
+	}
+	return filtered;
+}
+
+typedef struct SortTask_t {
+	Node head;
+	Node other;
+	CompareListElements compareElement;
+} *SortTask;
+
+typedef struct FilterTask_t {
+	Node first;
+	int count;
+	FilterListElement filterElement;
+	ListFilterKey key;
+	CopyListElement copyElement;
+	ListElement* passed;
+	int passedCount;
+	bool failed;
+} *FilterTask;
+
+typedef struct Worker_t {
+	pthread_t thread;
+	bool started;
+} *Worker;
+
+/**
+ * Runs work on each of count tasks laid out taskSize bytes apart, one on the
+ * calling thread and each other on a thread of its own. A task whose thread
+ * could not be started runs on the calling thread instead.
+ */
+static void runTasks(void* tasks, size_t taskSize, int count, void* (*work)(void*)) {
+	Worker workers = malloc(count * sizeof(*workers));
+	for(int i = 1; i < count; i++) {
+		void* task = (char*)tasks + i * taskSize;
+		if(workers) {
+			workers[i].started = pthread_create(&workers[i].thread, NULL, work, task) == 0;
+		}
+		if(!workers || !workers[i].started) {
+			work(task);
+		}
+	}
+	work(tasks);
+	if(!workers) {
+		return;
+	}
+	for(int i = 1; i < count; i++) {
+		if(workers[i].started) {
+			pthread_join(workers[i].thread, NULL);
+		}
+	}
+	free(workers);
+}
+
+/** Amount of threads worth using for size elements, at most threads */
+static int listUsefulThreads(int size, int threads) {
+	int useful = size / MIN_ELEMENTS_PER_THREAD;
+	if(useful > threads) {
+		useful = threads;
+	}
+	return useful < 1 ? 1 : useful;
+}
+
+/** Stable merge of two sorted chains linked through next */
+static Node mergeNodes(Node left, Node right, CompareListElements compareElement) {
+	struct Node_t head;
+	Node tail = &head;
+	while(left && right) {
+		if(compareElement(left->element, right->element) > 0) {
+			tail->next = right;
+			right = right->next;
+		} else {
+			tail->next = left;
+			left = left->next;
+		}
+		tail = tail->next;
+	}
+	tail->next = left ? left : right;
+	return head.next;
+}
+
+static void* sortTaskWork(void* argument) {
+	SortTask task = argument;
+	task->head = sortNodes(task->head, task->compareElement);
+	return NULL;
+}
+
+static void* mergeTaskWork(void* argument) {
+	SortTask task = argument;
+	task->head = mergeNodes(task->head, task->other, task->compareElement);
+	return NULL;
+}
+
+ListResult listSortParallel(List list, CompareListElements compareElement,
+		int threads) {
+	if(!list || !compareElement) {
+		return LIST_NULL_ARGUMENT;
+	}
+	int runs = listUsefulThreads(list->size, threads);
+	SortTask tasks = runs > 1 ? malloc(runs * sizeof(*tasks)) : NULL;
+	if(!tasks) {
+		return listSort(list, compareElement);
+	}
+	list->current = NULL;
+	Node node = list->head;
+	for(int i = 0; i < runs; i++) {
+		int runSize = list->size / runs + (i < list->size % runs ? 1 : 0);
+		tasks[i].head = node;
+		tasks[i].compareElement = compareElement;
+		for(int j = 1; j < runSize; j++) {
+			node = node->next;
+		}
+		Node next = node->next;
+		node->next = NULL;
+		node = next;
+	}
+	runTasks(tasks, sizeof(*tasks), runs, sortTaskWork);
+
+	// merge neighbouring runs, so equal elements keep their relative order
+	while(runs > 1) {
+		int merges = runs / 2;
+		for(int i = 0; i < merges; i++) {
+			tasks[i].head = tasks[2 * i].head;
+			tasks[i].other = tasks[2 * i + 1].head;
+		}
+		runTasks(tasks, sizeof(*tasks), merges, mergeTaskWork);
+		if(runs % 2) {
+			tasks[merges].head = tasks[runs - 1].head;
+		}
+		runs = merges + runs % 2;
+	}
+	list->head = tasks[0].head;
+	free(tasks);
+	listRelinkPrevious(list);
+	return LIST_SUCCESS;
+}
+
+static void* filterTaskWork(void* argument) {
+	FilterTask task = argument;
+	int capacity = 0;
+	Node node = task->first;
+	for(int i = 0; i < task->count; i++, node = node->next) {
+		if(!task->filterElement(node->element, task->key)) {
+			continue;
+		}
+		if(task->passedCount == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			ListElement* passed = realloc(task->passed, capacity * sizeof(ListElement));
+			if(!passed) {
+				task->failed = true;
+				return NULL;
+			}
+			task->passed = passed;
+		}
+		ListElement copy = task->copyElement(node->element);
+		if(!copy) {
+			task->failed = true;
+			return NULL;
+		}
+		task->passed[task->passedCount++] = copy;
+	}
+	return NULL;
+}
+
+List listFilterParallel(List list, FilterListElement filterElement,
+		ListFilterKey key, int threads) {
+	if(!list || !filterElement) {
+		return NULL;
+	}
+	int ranges = listUsefulThreads(list->size, threads);
+	FilterTask tasks = ranges > 1 ? malloc(ranges * sizeof(*tasks)) : NULL;
+	if(!tasks) {
+		return listFilter(list, filterElement, key);
+	}
+	Node node = list->head;
+	for(int i = 0; i < ranges; i++) {
+		tasks[i].first = node;
+		tasks[i].count = list->size / ranges + (i < list->size % ranges ? 1 : 0);
+		tasks[i].filterElement = filterElement;
+		tasks[i].key = key;
+		tasks[i].copyElement = list->copyElement;
+		tasks[i].passed = NULL;
+		tasks[i].passedCount = 0;
+		tasks[i].failed = false;
+		for(int j = 0; j < tasks[i].count; j++) {
+			node = node->next;
+		}
+	}
+	runTasks(tasks, sizeof(*tasks), ranges, filterTaskWork);
+
+	List filtered = listCreate(list->copyElement, list->freeElement);
+	bool failed = !filtered;
+	for(int i = 0; i < ranges; i++) {
+		failed = failed || tasks[i].failed;
+	}
+	// the copies are adopted as they are, the ranges are appended in order
+	for(int i = 0; i < ranges; i++) {
+		for(int j = 0; j < tasks[i].passedCount; j++) {
+			if(failed || listAdoptAfterNode(filtered, filtered->tail,
+					tasks[i].passed[j]) != LIST_SUCCESS) {
+				failed = true;
+				list->freeElement(tasks[i].passed[j]);
+			}
+		}
+		free(tasks[i].passed);
+	}
+	free(tasks);
+	if(failed) {
+		listDestroy(filtered);
+		return NULL;
+	}
+	return filtered;
+}
+
+ListResult listClear(List list) {
+	if(!list) {
+		return LIST_NULL_ARGUMENT;
+	}
+	Node node = list->head;
+	while(node) {
+		Node next = node->next;
+		list->freeElement(node->element);
+		nodeRelease(list, node);
+		node = next;
+	}
+	list->head = NULL;
+	list->tail = NULL;
+	list->current = NULL;
+	list->size = 0;
+	return LIST_SUCCESS;
+}
+
+void listDestroy(List list) {
+	if(!list) {
+		return;
+	}
+	listClear(list);
+	while(list->blocks) {
+		NodeBlock next = list->blocks->next;
+		free(list->blocks);
+		list->blocks = next;
+	}
+	free(list);
+}
+
+ListElement listCursorFirst(List list, ListCursor* cursor) {
+	if(!list || !cursor) {
+		return NULL;
+	}
+	cursor->node = list->head;
+	return list->head ? list->head->element : NULL;
+}
+
+ListElement listCursorNext(ListCursor* cursor) {
+	if(!cursor || !cursor->node) {
+		return NULL;
+	}
+	Node node = ((Node)cursor->node)->next;
+	cursor->node = node;
+	return node ? node->element : NULL;
+}
@@ -18,6 +18,10 @@
 *   listGetSize              - Returns the size of a given list
 *   listInsertFirst          - Inserts an element in the beginning of the list
 *   listInsertLast           - Inserts an element in the end of the list
+*   listInsertFirstOwned     - Inserts an element in the beginning of the
+*                              list, taking ownership of it instead of copying
+*   listInsertLastOwned      - Inserts an element in the end of the list,
+*                              taking ownership of it instead of copying
 *   listInsertBeforeCurrent  - Inserts an element right before the place of
 *                              internal iterator
 *   listInsertAfterCurrent   - Inserts an element right after the place of the
@@ -34,7 +38,15 @@
 *   listSort                 - Sorts the list according to a given criteria
 *   listFilter               - Creates a copy of an existing list, filtered by
 *                              a boolean predicate
+*   listSortParallel         - Sorts the list like listSort, using several
+*                              threads
+*   listFilterParallel       - Filters the list like listFilter, using several
+*                              threads
 *   listClear		      	  - Clears all the data from the list
+*   listCursorFirst          - Sets an external cursor to the first element
+*                              and returns it, leaving the list untouched
+*   listCursorNext           - Advances an external cursor and returns the
+*                              next element
 */
 
 /** Type for defining the list */
@@ -51,6 +63,15 @@ typedef enum ListResult_t {
 /** Element data type for list container */
 typedef void* ListElement;
 
+/**
+* An iterator kept outside of the list. Iterating with a cursor does not
+* modify the list, so any number of cursors (and threads) may scan a list at
+* once, as long as the list is not modified meanwhile.
+*/
+typedef struct ListCursor_t {
+	void* node;
+} ListCursor;
+
 /**
 * Type of function for copying an element of the list.
 *
@@ -231,6 +252,38 @@ ListResult listInsertFirst(List list, ListElement element);
 */
 ListResult listInsertLast(List list, ListElement element);
 
+/**
+* Adds an element to the beginning of the list without copying it: the list
+* takes ownership of element and will free it using the stored freeing
+* function. This saves the copy (and the caller's own free) of
+* listInsertFirst when the caller no longer needs the element.
+*
+* @param list The list for which to add an element in its start
+* @param element The element to insert, allocated so that the list's freeing
+* function can free it.
+* @return
+* LIST_NULL_ARGUMENT if a NULL was sent as list or element
+* LIST_OUT_OF_MEMORY if an allocation failed, the caller keeps ownership of
+* element in this case
+* LIST_SUCCESS the element has been inserted successfully
+*/
+ListResult listInsertFirstOwned(List list, ListElement element);
+
+/**
+* Adds an element to the end of the list without copying it, taking ownership
+* of it. See listInsertFirstOwned.
+*
+* @param list The list for which to add an element in its end
+* @param element The element to insert, allocated so that the list's freeing
+* function can free it.
+* @return
+* LIST_NULL_ARGUMENT if a NULL was sent as list or element
+* LIST_OUT_OF_MEMORY if an allocation failed, the caller keeps ownership of
+* element in this case
+* LIST_SUCCESS the element has been inserted successfully
+*/
+ListResult listInsertLastOwned(List list, ListElement element);
+
 /**
 * Adds a new element to the list, the new element will be place right before
 * the current element (As pointed by the inner iterator of the list)
@@ -311,10 +364,11 @@ ListElement listExtractCurrent(List list);
 * CompareListElements. This function should return an integer indicating the
 * relation between two elements in the list
 *
+* The sort is stable and relinks the list's nodes in place, it never allocates
+* memory. The internal iterator is invalid after sorting.
+*
 * @return
 * LIST_NULL_ARGUMENT if list or compareElement are NULL
-* LIST_OUT_OF_MEMORY if a memory allocation failed, the list will be intact
-* in this case.
 * LIST_SUCCESS if sorting completed successfully.
 */
 ListResult listSort(List list, CompareListElements compareElement);
@@ -351,6 +405,49 @@ ListResult listSort(List list, CompareListElements compareElement);
 */
 List listFilter(List list, FilterListElement filterElement, ListFilterKey key);
 
+/**
+* Sorts the list like listSort, splitting it into runs that are sorted
+* concurrently and then merged pairwise, also concurrently.
+*
+* The result is the same stable order listSort produces. compareElement is
+* called from several threads at once and must be safe to do so.
+* Lists too short to benefit from threads are sorted by listSort.
+* Requires linking with -pthread.
+*
+* @param list the target list to sort
+* @param compareElement A comparison function as defined in the type
+* CompareListElements.
+* @param threads The maximal amount of threads to use, including the caller's.
+* @return
+* LIST_NULL_ARGUMENT if list or compareElement are NULL
+* LIST_SUCCESS if sorting completed successfully.
+*/
+ListResult listSortParallel(List list, CompareListElements compareElement,
+		int threads);
+
+/**
+* Creates a new filtered copy of a list like listFilter, evaluating the filter
+* and copying the passing elements concurrently over contiguous ranges of the
+* list.
+*
+* The elements keep their original order in the new list. filterElement and
+* the list's copying function are called from several threads at once and
+* must be safe to do so. Requires linking with -pthread.
+*
+* @param list The list for which a filtered copy will be made
+* @param filterElement The function used for determining whether a given
+* element should be in the resulting list or not.
+* @param key Any extra values that need to be sent to the filtering function
+* when called
+* @param threads The maximal amount of threads to use, including the caller's.
+* @return
+* NULL if list or filterElement are NULL or a memory allocation failed.
+* A List containing only elements from list which filterElement returned true
+* for.
+*/
+List listFilterParallel(List list, FilterListElement filterElement,
+		ListFilterKey key, int threads);
+
 /**
 * Removes all elements from target list.
 *
@@ -371,6 +468,28 @@ ListResult listClear(List list);
 */
 void listDestroy(List list);
 
+/**
+* Sets a cursor to the first element in the list and retrieves it.
+* Unlike listGetFirst, the list's internal iterator is not modified.
+*
+* @param list The list to iterate over.
+* @param cursor The cursor to set.
+* @return
+* NULL if a NULL pointer was sent or the list is empty.
+* The first element of the list otherwise
+*/
+ListElement listCursorFirst(List list, ListCursor* cursor);
+
+/**
+* Advances a cursor to the next element and retrieves it.
+*
+* @param cursor The cursor to advance, set by listCursorFirst.
+* @return
+* NULL if reached the end of the list or a NULL was sent as argument.
+* The next element on the list in case of success
+*/
+ListElement listCursorNext(ListCursor* cursor);
+
 /**
 * Macro for iterating over a list.
 *
@@ -396,4 +515,30 @@ void listDestroy(List list);
 		iterator ;\
 		iterator = listGetNext(list))
 
+/**
+* Macro for iterating over a list with a cursor of its own, without modifying
+* the list. Iterations may be nested and may run in several threads at once.
+* For example:
+* @code
+* void printPairs(List listOfStrings) {
+*   LIST_CURSOR_FOREACH(char*, first, listOfStrings) {
+*     LIST_CURSOR_FOREACH(char*, second, listOfStrings) {
+*       printf("%s %s\\n", first, second);
+*     }
+*   }
+* }
+* @endcode
+*
+* @param type The type of the elements in the list
+* @param iterator The name of the variable to hold the next list element
+* @param list the list to iterate over
+*/
+#define LIST_CURSOR_FOREACH(type,iterator,list) \
+	for(ListCursor iterator##_cursor, *iterator##_once = &iterator##_cursor ; \
+		iterator##_once ; \
+		iterator##_once = NULL) \
+	for(type iterator = listCursorFirst(list, &iterator##_cursor) ; \
+		iterator ;\
+		iterator = listCursorNext(&iterator##_cursor))
+
 #endif /* LIST_H_ */
@@ -2,6 +2,8 @@
 #define LIST_H_
 
 #include <cstdlib>
+#include "intrusive_list.h"
+#include "node_allocation.h"
 
 #define listTemplate <DataType>
 
@@ -11,9 +13,13 @@ class List {
 	class Node;
 	Node* _head;
 	DataType _defaultValue;
+	std::pmr::memory_resource* _resource;
 public:
 	class iterator;
-	List();
+	/**
+	 * Nodes are allocated from, and given back to, resource.
+	 */
+	List(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 	void insert(DataType data);
 	~List();
 
@@ -36,19 +42,19 @@ public:
 };
 
 template<class DataType>
-List listTemplate::List()
-: _head(NULL) {}
+List listTemplate::List(std::pmr::memory_resource* resource)
+: _head(NULL), _resource(resource) {}
 
 template<class DataType>
 void List listTemplate::insert(DataType data) {
 
 	if(!_head) {
-		_head = new Node(data, NULL);
+		_head = allocateNode<Node>(_resource, data);
 		return;
 	}
 
 	Node* temp = _head;
-	Node* toInsert = new Node(data, NULL);
+	Node* toInsert = allocateNode<Node>(_resource, data);
 	while(temp->_next!=NULL) {
 		temp = temp->_next;
 	}
@@ -59,9 +65,13 @@ void List listTemplate::insert(DataType data) {
 
 template<class DataType>
 List listTemplate::~List() {
+	// an arena reclaims all the nodes at once, there is nothing to visit
+	if(releasedWithResource<Node>(_resource)) {
+		return;
+	}
 	while(_head) {
 		Node* temp = _head->_next;
-		delete _head;
+		deallocateNode(_resource, _head);
 		_head = temp;
 	}
 }
@@ -94,4 +104,70 @@ public:
 };
 
 
+/**
+ * Selects the intrusive mode of List: a List<Intrusive<T, Tag> > chains
+ * objects of T through the IntrusiveListHook<Tag> they inherit (see
+ * intrusive_list.h), so insert allocates nothing and remove is O(1). Like
+ * those of a List<T*>, its elements are the addresses of objects it doesn't
+ * own, but dereferencing an iterator returns the address by value.
+ */
+template<class T, class Tag = void>
+struct Intrusive;
+
+template<class T, class Tag>
+class List<Intrusive<T, Tag> > {
+	IntrusiveList<T, Tag> _objects;
+public:
+	class iterator;
+	/**
+	 * Takes a resource like the other Lists, but never allocates.
+	 */
+	List(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) {
+		(void)resource;
+	}
+	/**
+	 * Links data to the end of the list, in O(1). data must not be linked
+	 * into another list through the same hook.
+	 */
+	void insert(T* data) {
+		_objects.insert(data);
+	}
+	/**
+	 * Unlinks data from the list, in O(1).
+	 */
+	void remove(T* data) {
+		_objects.remove(data);
+	}
+
+	iterator begin() const {
+		return iterator(_objects.begin());
+	}
+
+	iterator end() const {
+		return iterator(_objects.end());
+	}
+};
+
+template<class T, class Tag>
+class List<Intrusive<T, Tag> >::iterator {
+	typename IntrusiveList<T, Tag>::iterator _current;
+public:
+	explicit iterator(typename IntrusiveList<T, Tag>::iterator current =
+			typename IntrusiveList<T, Tag>::iterator()) : _current(current) { }
+	bool operator==(const iterator& iterator) const {
+		return _current == iterator._current;
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+	iterator& operator++() {
+		++_current;
+		return *this;
+	}
+	T* operator*() const {
+		return &(*_current);
+	}
+};
+
+
 #endif /* LIST_H_ */
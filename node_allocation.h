@@ -0,0 +1,49 @@
+#ifndef NODE_ALLOCATION_H_
+#define NODE_ALLOCATION_H_
+
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Helpers for the node based containers (Tree, MtmMap, List) that take a
+ * std::pmr::memory_resource to allocate their nodes from.
+ */
+
+/**
+ * Allocates a NodeType from resource and constructs it from args.
+ */
+template<class NodeType, class... Args>
+NodeType* allocateNode(std::pmr::memory_resource* resource, Args&&... args) {
+	void* memory = resource->allocate(sizeof(NodeType), alignof(NodeType));
+	try {
+		return new (memory) NodeType(std::forward<Args>(args)...);
+	} catch(...) {
+		resource->deallocate(memory, sizeof(NodeType), alignof(NodeType));
+		throw;
+	}
+}
+
+/**
+ * Destroys a node made by allocateNode and gives its memory back to resource.
+ */
+template<class NodeType>
+void deallocateNode(std::pmr::memory_resource* resource, NodeType* node) {
+	node->~NodeType();
+	resource->deallocate(node, sizeof(NodeType), alignof(NodeType));
+}
+
+/**
+ * Returns true if the nodes of a container can be dropped without visiting
+ * them: their destructors do nothing and resource is an arena whose
+ * deallocate does nothing, its memory being reclaimed all at once by the
+ * arena's release() or destructor.
+ */
+template<class NodeType>
+bool releasedWithResource(std::pmr::memory_resource* resource) {
+	return std::is_trivially_destructible<NodeType>::value
+			&& dynamic_cast<std::pmr::monotonic_buffer_resource*>(resource) != NULL;
+}
+
+#endif /* NODE_ALLOCATION_H_ */
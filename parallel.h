@@ -0,0 +1,316 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tree.h"
+#include "MtmMap.h"
+
+/**
+ * Parallel traversals of whole containers, for aggregates (totals,
+ * histograms, filtered exports) over Tree and MtmMap (and HashTable, see
+ * hash_table_parallel.h):
+ * parallel_for_each(container, function) calls function on every element,
+ * parallel_reduce(container, identity, transform, reduce) combines the
+ * transform of every element with reduce, like std::transform_reduce.
+ *
+ * A container is cut into PARALLEL_CHUNKS chunks of about the same size,
+ * in the order of its elements: a Tree by its subtrees, an MtmMap at the
+ * split points it keeps from one call to the next (see
+ * MtmMap::splitPoints, at most PARALLEL_CHUNKS of them). The chunks run on
+ * a ThreadPool and on the calling thread.
+ * The chunks only depend on the container, not on the amount of threads,
+ * and parallel_reduce combines their results from the first chunk to the
+ * last: the result is that of the sequential walk whenever reduce is
+ * associative, even if it isn't commutative, and is the same for every run
+ * and amount of threads even when it is not exactly associative (like a
+ * sum of doubles).
+ * @code
+ * double total = parallel_reduce(accounts, 0.0,
+ *		[](const Account& account) { return account._balance; },
+ *		[](double a, double b) { return a + b; });
+ * @endcode
+ * function and transform are called from several threads at once, and the
+ * container must not be modified meanwhile.
+ */
+
+/** The amount of chunks a container is cut into */
+const size_t PARALLEL_CHUNKS = 64;
+
+/**
+ * A fixed set of worker threads that run the chunks of the parallel calls.
+ * A parallel call never waits for a worker: the calling thread runs chunks
+ * too, so parallel calls can be nested, or made from several threads.
+ */
+class ThreadPool {
+	struct Job {
+		std::function<void(size_t)> _task;
+		size_t _count;
+		std::atomic<size_t> _next;
+		size_t _finished;
+		std::exception_ptr _error;
+		std::mutex _mutex;
+		std::condition_variable _done;
+		Job(const std::function<void(size_t)>& task, size_t count)
+		: _task(task), _count(count), _next(0), _finished(0) {}
+	};
+	std::vector<std::thread> _workers;
+	std::deque<std::shared_ptr<Job> > _queue;
+	std::mutex _mutex;
+	std::condition_variable _changed;
+	bool _stopping;
+
+	static void work(Job& job);
+	void workerLoop();
+public:
+	/**
+	 * Starts threads - 1 workers, the calling thread being the last one.
+	 */
+	explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency());
+	ThreadPool(const ThreadPool& pool) = delete;
+	ThreadPool& operator=(const ThreadPool& pool) = delete;
+	~ThreadPool();
+
+	/**
+	 * The amount of threads that run the tasks, with the calling one.
+	 */
+	unsigned int size() const {
+		return (unsigned int)_workers.size() + 1;
+	}
+
+	/**
+	 * Calls task(i) for every i in [0, count), concurrently, and returns when
+	 * all the calls returned. If calls threw, rethrows one of the exceptions.
+	 */
+	void run(size_t count, const std::function<void(size_t)>& task);
+
+	/**
+	 * The pool the parallel calls use by default, with a thread per core.
+	 */
+	static ThreadPool& global() {
+		static ThreadPool pool;
+		return pool;
+	}
+};
+
+inline ThreadPool::ThreadPool(unsigned int threads) : _stopping(false) {
+	for(unsigned int i = 1; i < threads; i++) {
+		_workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+inline ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_changed.notify_all();
+	for(size_t i = 0; i < _workers.size(); i++) {
+		_workers[i].join();
+	}
+}
+
+inline void ThreadPool::work(Job& job) {
+	size_t finished = 0;
+	for(size_t i = job._next++; i < job._count; i = job._next++) {
+		try {
+			job._task(i);
+		} catch(...) {
+			std::lock_guard<std::mutex> lock(job._mutex);
+			if(!job._error) {
+				job._error = std::current_exception();
+			}
+		}
+		finished++;
+	}
+	if(finished > 0) {
+		std::lock_guard<std::mutex> lock(job._mutex);
+		job._finished += finished;
+		if(job._finished == job._count) {
+			job._done.notify_all();
+		}
+	}
+}
+
+inline void ThreadPool::workerLoop() {
+	while(true) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_changed.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+			if(_queue.empty()) {
+				return;
+			}
+			job = _queue.front();
+			_queue.pop_front();
+		}
+		// a worker that comes late finds no index left, and only drops the job
+		work(*job);
+	}
+}
+
+inline void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+	if(count == 0) {
+		return;
+	}
+	std::shared_ptr<Job> job = std::make_shared<Job>(task, count);
+	size_t helpers = std::min(_workers.size(), count - 1);
+	if(helpers > 0) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			for(size_t i = 0; i < helpers; i++) {
+				_queue.push_back(job);
+			}
+		}
+		_changed.notify_all();
+	}
+	work(*job);
+	std::unique_lock<std::mutex> lock(job->_mutex);
+	job->_done.wait(lock, [&job]() { return job->_finished == job->_count; });
+	if(job->_error) {
+		std::rethrow_exception(job->_error);
+	}
+}
+
+/**
+ * Runs chunk(i) for every chunk in [0, chunks) on pool, and combines their
+ * results in order.
+ */
+template<class Result, class Chunk, class Reduce>
+Result parallelCombine(size_t chunks, const Result& identity, Chunk chunk,
+		Reduce reduce, ThreadPool& pool) {
+	std::vector<Result> results(chunks, identity);
+	pool.run(chunks, [&](size_t i) { results[i] = chunk(i); });
+	Result result = identity;
+	for(size_t i = 0; i < chunks; i++) {
+		result = reduce(result, results[i]);
+	}
+	return result;
+}
+
+/**
+ * The chunks of a Tree: the subtrees PARALLEL_CHUNKS levels of fan-out
+ * down, and alone each node above them, in order.
+ */
+template<class T>
+struct TreeChunk {
+	Node<T>* _node;
+	bool _subtree;
+};
+
+template<class T>
+void treeChunksAux(Node<T>* node, size_t fanOut, std::vector<TreeChunk<T> >& chunks) {
+	if(!node) {
+		return;
+	}
+	if(fanOut >= PARALLEL_CHUNKS) {
+		TreeChunk<T> chunk = { node, true };
+		chunks.push_back(chunk);
+		return;
+	}
+	treeChunksAux(node->_left_son, fanOut * 2, chunks);
+	TreeChunk<T> chunk = { node, false };
+	chunks.push_back(chunk);
+	treeChunksAux(node->_right_son, fanOut * 2, chunks);
+}
+
+template<class T, class Function>
+void treeForEachAux(Node<T>* node, Function& function) {
+	while(node) {
+		treeForEachAux(node->_left_son, function);
+		function(node->_value);
+		node = node->_right_son;
+	}
+}
+
+template<class T, class Result, class Transform, class Reduce>
+void treeReduceAux(Node<T>* node, Result& result, Transform& transform, Reduce& reduce) {
+	while(node) {
+		treeReduceAux(node->_left_son, result, transform, reduce);
+		result = reduce(result, transform(node->_value));
+		node = node->_right_son;
+	}
+}
+
+/**
+ * Calls function(T&) on every value of tree.
+ */
+template<class T, class Comp, class Function>
+void parallel_for_each(Tree<T, Comp>& tree, Function function,
+		ThreadPool& pool = ThreadPool::global()) {
+	std::vector<TreeChunk<T> > chunks;
+	treeChunksAux(tree._root, 1, chunks);
+	pool.run(chunks.size(), [&](size_t i) {
+		if(chunks[i]._subtree) {
+			treeForEachAux(chunks[i]._node, function);
+		} else {
+			function(chunks[i]._node->_value);
+		}
+	});
+}
+
+/**
+ * Returns reduce(...reduce(reduce(identity, transform(v1)), transform(v2))...)
+ * over the values of tree in order, computed chunk by chunk.
+ */
+template<class T, class Comp, class Result, class Transform, class Reduce>
+Result parallel_reduce(Tree<T, Comp>& tree, Result identity, Transform transform,
+		Reduce reduce, ThreadPool& pool = ThreadPool::global()) {
+	std::vector<TreeChunk<T> > chunks;
+	treeChunksAux(tree._root, 1, chunks);
+	return parallelCombine(chunks.size(), identity, [&](size_t i) {
+		Result result = identity;
+		if(chunks[i]._subtree) {
+			treeReduceAux(chunks[i]._node, result, transform, reduce);
+		} else {
+			result = reduce(result, transform(chunks[i]._node->_value));
+		}
+		return result;
+	}, reduce, pool);
+}
+
+/**
+ * Calls function(Pair&) on every element of map.
+ */
+template<class KeyType, class ValueType, class CompareFunction, class Function>
+void parallel_for_each(mtm::MtmMap<KeyType, ValueType, CompareFunction>& map,
+		Function function, ThreadPool& pool = ThreadPool::global()) {
+	typedef typename mtm::MtmMap<KeyType, ValueType, CompareFunction>::iterator iterator;
+	std::vector<iterator> splits = map.splitPoints(PARALLEL_CHUNKS);
+	pool.run(splits.size() - 1, [&](size_t i) {
+		for(iterator it = splits[i]; it != splits[i + 1]; ++it) {
+			function(*it);
+		}
+	});
+}
+
+/**
+ * Returns the reduce of the transforms of the elements (Pairs) of map, in
+ * order, computed chunk by chunk.
+ */
+template<class KeyType, class ValueType, class CompareFunction, class Result,
+		class Transform, class Reduce>
+Result parallel_reduce(mtm::MtmMap<KeyType, ValueType, CompareFunction>& map,
+		Result identity, Transform transform, Reduce reduce,
+		ThreadPool& pool = ThreadPool::global()) {
+	typedef typename mtm::MtmMap<KeyType, ValueType, CompareFunction>::iterator iterator;
+	std::vector<iterator> splits = map.splitPoints(PARALLEL_CHUNKS);
+	return parallelCombine(splits.size() - 1, identity, [&](size_t i) {
+		Result result = identity;
+		for(iterator it = splits[i]; it != splits[i + 1]; ++it) {
+			result = reduce(result, transform(*it));
+		}
+		return result;
+	}, reduce, pool);
+}
+
+#endif /* PARALLEL_H_ */
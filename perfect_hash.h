@@ -0,0 +1,230 @@
+#ifndef PERFECT_HASH_H_
+#define PERFECT_HASH_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * A perfect hash table for a key set that is fixed at compile time (e.g.
+ * configuration IDs or opcodes), built by a constexpr PtHash-style search.
+ *
+ * The keys are spread over buckets by their hash, and every bucket gets a
+ * pilot, the first value that sends all of its keys to slots that no other
+ * key took. A find then needs one hash, one pilot and one key comparison,
+ * without any probing and without any allocation: the table is a few
+ * std::arrays that live in read only memory when the table is constexpr.
+ * @code
+ * constexpr PerfectHashEntry<int, const char*> OPCODES[] = {
+ *		{ 0x01, "load" }, { 0x02, "store" }, { 0x10, "add" } };
+ * constexpr auto opcodes = makePerfectHashTable(OPCODES);
+ * static_assert(opcodes.containsKey(0x10), "");
+ * const char* const* name = opcodes.find(opcode);
+ * @endcode
+ * Duplicated keys fail the build (a std::invalid_argument is thrown at
+ * compile time). Keys are integers, enums or std::string_view, or any type
+ * with a constexpr hash given as Hash. Values must be literal types that can
+ * be default constructed.
+ */
+
+/**
+ * The default hashes of the keys, a 64 bit mix of integers and enums and
+ * FNV-1a over the characters of a std::string_view.
+ */
+template<class KeyType, class Enable = void>
+struct PerfectHashKey;
+
+constexpr uint64_t perfectHashMix(uint64_t hash) {
+	hash ^= hash >> 30;
+	hash *= 0xbf58476d1ce4e5b9ULL;
+	hash ^= hash >> 27;
+	hash *= 0x94d049bb133111ebULL;
+	return hash ^ (hash >> 31);
+}
+
+template<class KeyType>
+struct PerfectHashKey<KeyType, typename std::enable_if<std::is_integral<KeyType>::value
+		|| std::is_enum<KeyType>::value>::type> {
+	constexpr uint64_t operator()(KeyType key) const {
+		return perfectHashMix((uint64_t)key);
+	}
+};
+
+template<>
+struct PerfectHashKey<std::string_view> {
+	constexpr uint64_t operator()(std::string_view key) const {
+		uint64_t hash = 14695981039346656037ULL;
+		for(size_t i = 0; i < key.size(); i++) {
+			hash = (hash ^ (unsigned char)key[i]) * 1099511628211ULL;
+		}
+		return perfectHashMix(hash);
+	}
+};
+
+template<class KeyType, class ValueType>
+struct PerfectHashEntry {
+	KeyType _key;
+	ValueType _value;
+};
+
+/**
+ * The amount of slots of a table of n keys, the smallest power of two that
+ * keeps the table at most 80% full.
+ */
+constexpr size_t perfectHashSlots(size_t n) {
+	size_t slots = 2;
+	while(slots * 4 < n * 5) {
+		slots *= 2;
+	}
+	return slots;
+}
+
+#define perfectHashTemplate <KeyType, ValueType, N, Hash>
+
+template<class KeyType, class ValueType, size_t N,
+		class Hash = PerfectHashKey<KeyType> >
+class PerfectHashTable {
+	static_assert(N > 0, "a perfect hash table needs at least one key");
+public:
+	static constexpr size_t SLOTS = perfectHashSlots(N);
+	// about three keys per bucket
+	static constexpr size_t BUCKETS = N / 3 + 1;
+	static constexpr uint32_t MAX_PILOT = UINT16_MAX;
+private:
+	static constexpr unsigned SHIFT = []() {
+		unsigned shift = 64;
+		for(size_t slots = SLOTS; slots > 1; slots /= 2) {
+			shift--;
+		}
+		return shift;
+	}();
+	std::array<uint16_t, BUCKETS> _pilots;
+	/**
+	 * The slots nobody took hold a copy of the first entry: a key that ends
+	 * there is not in the table (the first key has a slot of its own), so
+	 * the comparison of find fails on them like on any other mismatch.
+	 */
+	std::array<KeyType, SLOTS> _keys;
+	std::array<ValueType, SLOTS> _values;
+
+	static constexpr size_t bucketOf(uint64_t hash) {
+		return (size_t)(((hash & 0xffffffffULL) * BUCKETS) >> 32);
+	}
+	static constexpr size_t slotOf(uint64_t hash, uint64_t pilot) {
+		return (size_t)(((hash ^ (pilot * 0x9e3779b97f4a7c15ULL))
+				* 0xd6e8feb86659fd93ULL) >> SHIFT);
+	}
+public:
+	/**
+	 * Builds the table, at compile time when constexpr.
+	 * @throws std::invalid_argument if a key appears twice
+	 * @throws std::length_error if no pilot fits a bucket (the hash sends
+	 * different keys to the same 64 bits)
+	 */
+	constexpr explicit PerfectHashTable(const PerfectHashEntry<KeyType, ValueType> (&entries)[N]);
+
+	/**
+	 * Returns a pointer to the value of key, or NULL if key is not in the
+	 * table.
+	 */
+	constexpr const ValueType* find(const KeyType& key) const {
+		uint64_t hash = Hash()(key);
+		size_t slot = slotOf(hash, _pilots[bucketOf(hash)]);
+		return _keys[slot] == key ? &_values[slot] : NULL;
+	}
+
+	constexpr bool containsKey(const KeyType& key) const {
+		return find(key) != NULL;
+	}
+
+	constexpr size_t size() const {
+		return N;
+	}
+};
+
+template<class KeyType, class ValueType, size_t N, class Hash>
+constexpr PerfectHashTable perfectHashTemplate::PerfectHashTable(
+		const PerfectHashEntry<KeyType, ValueType> (&entries)[N])
+: _pilots(), _keys(), _values() {
+	std::array<uint64_t, N> hashes = {};
+	// the keys sorted by bucket, and where each bucket starts among them
+	std::array<size_t, N> byBucket = {};
+	std::array<size_t, BUCKETS + 1> bucketStarts = {};
+	for(size_t i = 0; i < N; i++) {
+		hashes[i] = Hash()(entries[i]._key);
+		bucketStarts[bucketOf(hashes[i]) + 1]++;
+	}
+	for(size_t b = 0; b < BUCKETS; b++) {
+		bucketStarts[b + 1] += bucketStarts[b];
+	}
+	std::array<size_t, BUCKETS> filled = {};
+	for(size_t i = 0; i < N; i++) {
+		size_t bucket = bucketOf(hashes[i]);
+		byBucket[bucketStarts[bucket] + filled[bucket]++] = i;
+	}
+	// the largest buckets are placed first, while most slots are free
+	size_t largest = 0;
+	for(size_t b = 0; b < BUCKETS; b++) {
+		if(filled[b] > largest) {
+			largest = filled[b];
+		}
+	}
+	std::array<bool, SLOTS> taken = {};
+	std::array<size_t, SLOTS> owners = {};
+	for(size_t bucketSize = largest; bucketSize > 0; bucketSize--) {
+		for(size_t b = 0; b < BUCKETS; b++) {
+			if(filled[b] != bucketSize) {
+				continue;
+			}
+			const size_t first = bucketStarts[b];
+			for(size_t i = first; i < first + bucketSize; i++) {
+				for(size_t j = first; j < i; j++) {
+					if(entries[byBucket[i]]._key == entries[byBucket[j]]._key) {
+						throw std::invalid_argument("perfect hash table with a duplicated key");
+					}
+				}
+			}
+			uint32_t pilot = 0;
+			for(;; pilot++) {
+				if(pilot > MAX_PILOT) {
+					throw std::length_error("no pilot fits a bucket of the perfect hash table");
+				}
+				size_t placed = 0;
+				for(; placed < bucketSize; placed++) {
+					size_t slot = slotOf(hashes[byBucket[first + placed]], pilot);
+					if(taken[slot]) {
+						break;
+					}
+					taken[slot] = true;
+					owners[slot] = byBucket[first + placed];
+				}
+				if(placed == bucketSize) {
+					break;
+				}
+				for(size_t i = 0; i < placed; i++) {
+					taken[slotOf(hashes[byBucket[first + i]], pilot)] = false;
+				}
+			}
+			_pilots[b] = (uint16_t)pilot;
+		}
+	}
+	for(size_t slot = 0; slot < SLOTS; slot++) {
+		size_t owner = taken[slot] ? owners[slot] : 0;
+		_keys[slot] = entries[owner]._key;
+		_values[slot] = entries[owner]._value;
+	}
+}
+
+/**
+ * Builds a PerfectHashTable of the entries, deducing its types and size.
+ */
+template<class KeyType, class ValueType, size_t N>
+constexpr PerfectHashTable<KeyType, ValueType, N> makePerfectHashTable(
+		const PerfectHashEntry<KeyType, ValueType> (&entries)[N]) {
+	return PerfectHashTable<KeyType, ValueType, N>(entries);
+}
+
+#endif /* PERFECT_HASH_H_ */
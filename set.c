@@ -0,0 +1,629 @@
+#include <stdlib.h>
+#include "set.h"
+
+/**
+ * The set is kept as an AVL tree ordered by the comparison function, so
+ * setAdd, setIsIn, setRemove and setExtract are O(log n). Nodes keep a link
+ * to their parent, so setGetNext walks to the in-order successor without a
+ * stack, in O(1) amortised over a full iteration.
+ */
+typedef struct SetNode_t {
+	SetElement element;
+	struct SetNode_t* left;
+	struct SetNode_t* right;
+	struct SetNode_t* parent;
+	int height;
+} *SetNode;
+
+struct Set_t {
+	SetNode root;
+	SetNode current;
+	int size;
+	copySetElements copyElement;
+	freeSetElements freeElement;
+	compareSetElements compareElements;
+};
+
+static int nodeHeight(SetNode node) {
+	return node ? node->height : 0;
+}
+
+static void nodeUpdateHeight(SetNode node) {
+	int left = nodeHeight(node->left);
+	int right = nodeHeight(node->right);
+	node->height = (left > right ? left : right) + 1;
+}
+
+static SetNode nodeCreate(SetElement element, SetNode parent) {
+	SetNode node = malloc(sizeof(*node));
+	if(!node) {
+		return NULL;
+	}
+	node->element = element;
+	node->left = NULL;
+	node->right = NULL;
+	node->parent = parent;
+	node->height = 1;
+	return node;
+}
+
+/** Makes child take node's place under node's parent */
+static void setReplaceChild(Set set, SetNode node, SetNode child) {
+	SetNode parent = node->parent;
+	if(!parent) {
+		set->root = child;
+	} else if(parent->left == node) {
+		parent->left = child;
+	} else {
+		parent->right = child;
+	}
+	if(child) {
+		child->parent = parent;
+	}
+}
+
+static SetNode setRotateLeft(Set set, SetNode node) {
+	SetNode right = node->right;
+	setReplaceChild(set, node, right);
+	node->right = right->left;
+	if(right->left) {
+		right->left->parent = node;
+	}
+	right->left = node;
+	node->parent = right;
+	nodeUpdateHeight(node);
+	nodeUpdateHeight(right);
+	return right;
+}
+
+static SetNode setRotateRight(Set set, SetNode node) {
+	SetNode left = node->left;
+	setReplaceChild(set, node, left);
+	node->left = left->right;
+	if(left->right) {
+		left->right->parent = node;
+	}
+	left->right = node;
+	node->parent = left;
+	nodeUpdateHeight(node);
+	nodeUpdateHeight(left);
+	return left;
+}
+
+/** Restores the AVL balance on the path from node up to the root */
+static void setRebalance(Set set, SetNode node) {
+	while(node) {
+		nodeUpdateHeight(node);
+		int balance = nodeHeight(node->left) - nodeHeight(node->right);
+		if(balance == 2) {
+			if(nodeHeight(node->left->left) < nodeHeight(node->left->right)) {
+				setRotateLeft(set, node->left);
+			}
+			node = setRotateRight(set, node);
+		} else if(balance == -2) {
+			if(nodeHeight(node->right->right) < nodeHeight(node->right->left)) {
+				setRotateRight(set, node->right);
+			}
+			node = setRotateLeft(set, node);
+		}
+		node = node->parent;
+	}
+}
+
+static SetNode nodeMinimum(SetNode node) {
+	while(node && node->left) {
+		node = node->left;
+	}
+	return node;
+}
+
+static SetNode nodeSuccessor(SetNode node) {
+	if(node->right) {
+		return nodeMinimum(node->right);
+	}
+	while(node->parent && node->parent->right == node) {
+		node = node->parent;
+	}
+	return node->parent;
+}
+
+static SetNode setFind(Set set, SetElement element) {
+	SetNode node = set->root;
+	while(node) {
+		int compare = set->compareElements(element, node->element);
+		if(compare == 0) {
+			return node;
+		}
+		node = compare < 0 ? node->left : node->right;
+	}
+	return NULL;
+}
+
+/** Unlinks node from the tree and frees it, returning its element */
+static SetElement setUnlink(Set set, SetNode node) {
+	SetElement element = node->element;
+	if(node->left && node->right) {
+		// the successor has no left son, it takes the removed element's place
+		SetNode successor = nodeMinimum(node->right);
+		node->element = successor->element;
+		node = successor;
+	}
+	SetNode child = node->left ? node->left : node->right;
+	SetNode parent = node->parent;
+	setReplaceChild(set, node, child);
+	free(node);
+	set->size--;
+	setRebalance(set, parent);
+	return element;
+}
+
+static void nodeDestroy(SetNode node, freeSetElements freeElement) {
+	if(!node) {
+		return;
+	}
+	nodeDestroy(node->left, freeElement);
+	nodeDestroy(node->right, freeElement);
+	freeElement(node->element);
+	free(node);
+}
+
+/** Copies the subtree under node, keeping its shape. Returns false on failure */
+static bool nodeCopy(SetNode node, SetNode parent, SetNode* copy,
+		copySetElements copyElement, freeSetElements freeElement) {
+	*copy = NULL;
+	if(!node) {
+		return true;
+	}
+	SetElement element = copyElement(node->element);
+	if(!element) {
+		return false;
+	}
+	*copy = nodeCreate(element, parent);
+	if(!*copy) {
+		freeElement(element);
+		return false;
+	}
+	(*copy)->height = node->height;
+	return nodeCopy(node->left, *copy, &(*copy)->left, copyElement, freeElement)
+			&& nodeCopy(node->right, *copy, &(*copy)->right, copyElement, freeElement);
+}
+
+/**
+ * Flattens the subtree under node into an in-order chain linked through
+ * right, followed by rest. Returns the head of the chain.
+ */
+static SetNode nodeFlatten(SetNode node, SetNode rest) {
+	if(!node) {
+		return rest;
+	}
+	node->right = nodeFlatten(node->right, rest);
+	SetNode left = node->left;
+	node->left = NULL;
+	return nodeFlatten(left, node);
+}
+
+/**
+ * Builds a perfectly balanced tree out of the first count nodes of an in-order
+ * chain linked through right, advancing chain past them. O(count).
+ */
+static SetNode nodeBuild(SetNode* chain, int count) {
+	if(count == 0) {
+		return NULL;
+	}
+	SetNode left = nodeBuild(chain, count / 2);
+	SetNode node = *chain;
+	*chain = node->right;
+	node->left = left;
+	node->right = nodeBuild(chain, count - count / 2 - 1);
+	if(node->left) {
+		node->left->parent = node;
+	}
+	if(node->right) {
+		node->right->parent = node;
+	}
+	nodeUpdateHeight(node);
+	return node;
+}
+
+/** Replaces the content of set with an in-order chain of count nodes */
+static void setBuild(Set set, SetNode chain, int count) {
+	set->root = nodeBuild(&chain, count);
+	if(set->root) {
+		set->root->parent = NULL;
+	}
+	set->size = count;
+	set->current = NULL;
+}
+
+typedef struct Chain_t {
+	SetNode head;
+	SetNode tail;
+	int count;
+} Chain;
+
+static void chainAppend(Chain* chain, SetNode node) {
+	node->left = NULL;
+	node->right = NULL;
+	chain->tail ? (chain->tail->right = node) : (chain->head = node);
+	chain->tail = node;
+	chain->count++;
+}
+
+static void chainDestroy(SetNode node, freeSetElements freeElement) {
+	while(node) {
+		SetNode next = node->right;
+		freeElement(node->element);
+		free(node);
+		node = next;
+	}
+}
+
+/** Appends a node holding a copy of element to chain. Returns false on failure */
+static bool chainAppendCopy(Set set, Chain* chain, SetElement element) {
+	SetElement copy = set->copyElement(element);
+	if(!copy) {
+		return false;
+	}
+	SetNode node = nodeCreate(copy, NULL);
+	if(!node) {
+		set->freeElement(copy);
+		return false;
+	}
+	chainAppend(chain, node);
+	return true;
+}
+
+/** Which elements of a merge of two sets are kept in the result */
+typedef enum SetOperation_t {
+	SET_UNION,
+	SET_INTERSECTION,
+	SET_DIFFERENCE
+} SetOperation;
+
+/**
+ * Merges the ordered elements of set1 and set2 into a new set, copying the
+ * kept elements (from set1 when both sets hold an equal element). O(n + m).
+ */
+static Set setMerge(Set set1, Set set2, SetOperation operation) {
+	if(!set1 || !set2) {
+		return NULL;
+	}
+	Set result = setCreate(set1->copyElement, set1->freeElement, set1->compareElements);
+	if(!result) {
+		return NULL;
+	}
+	Chain chain = { NULL, NULL, 0 };
+	SetNode node1 = nodeMinimum(set1->root);
+	SetNode node2 = nodeMinimum(set2->root);
+	bool success = true;
+	while(success && (node1 || (node2 && operation == SET_UNION))) {
+		int compare = !node2 ? -1 : !node1 ? 1 :
+				set1->compareElements(node1->element, node2->element);
+		SetElement kept = NULL;
+		if(compare < 0) {
+			kept = operation != SET_INTERSECTION ? node1->element : NULL;
+			node1 = nodeSuccessor(node1);
+		} else if(compare > 0) {
+			kept = operation == SET_UNION ? node2->element : NULL;
+			node2 = nodeSuccessor(node2);
+		} else {
+			kept = operation != SET_DIFFERENCE ? node1->element : NULL;
+			node1 = nodeSuccessor(node1);
+			node2 = nodeSuccessor(node2);
+		}
+		if(kept) {
+			success = chainAppendCopy(result, &chain, kept);
+		}
+	}
+	if(!success) {
+		chainDestroy(chain.head, result->freeElement);
+		setDestroy(result);
+		return NULL;
+	}
+	setBuild(result, chain.head, chain.count);
+	return result;
+}
+
+Set setCreate(copySetElements copyElement, freeSetElements freeElement,
+		compareSetElements compareElements) {
+	if(!copyElement || !freeElement || !compareElements) {
+		return NULL;
+	}
+	Set set = malloc(sizeof(*set));
+	if(!set) {
+		return NULL;
+	}
+	set->root = NULL;
+	set->current = NULL;
+	set->size = 0;
+	set->copyElement = copyElement;
+	set->freeElement = freeElement;
+	set->compareElements = compareElements;
+	return set;
+}
+
+Set setCopy(Set set) {
+	if(!set) {
+		return NULL;
+	}
+	Set copy = setCreate(set->copyElement, set->freeElement, set->compareElements);
+	if(!copy) {
+		return NULL;
+	}
+	if(!nodeCopy(set->root, NULL, &copy->root, set->copyElement, set->freeElement)) {
+		setDestroy(copy);
+		return NULL;
+	}
+	copy->size = set->size;
+	return copy;
+}
+
+void setDestroy(Set set) {
+	if(!set) {
+		return;
+	}
+	setClear(set);
+	free(set);
+}
+
+int setGetSize(Set set) {
+	if(!set) {
+		return -1;
+	}
+	return set->size;
+}
+
+bool setIsIn(Set set, SetElement element) {
+	if(!set) {
+		return false;
+	}
+	return setFind(set, element) != NULL;
+}
+
+SetElement setGetFirst(Set set) {
+	if(!set) {
+		return NULL;
+	}
+	set->current = nodeMinimum(set->root);
+	return setGetCurrent(set);
+}
+
+SetElement setGetNext(Set set) {
+	if(!set || !set->current) {
+		return NULL;
+	}
+	set->current = nodeSuccessor(set->current);
+	return setGetCurrent(set);
+}
+
+SetElement setGetCurrent(Set set) {
+	if(!set || !set->current) {
+		return NULL;
+	}
+	return set->current->element;
+}
+
+/**
+ * Adds element, or a copy of it when copy is true, to the set. When element
+ * itself is not added, the caller keeps ownership of it.
+ */
+static SetResult setInsert(Set set, SetElement element, bool copy) {
+	set->current = NULL;
+	SetNode parent = NULL;
+	SetNode* link = &set->root;
+	while(*link) {
+		int compare = set->compareElements(element, (*link)->element);
+		if(compare == 0) {
+			return SET_ITEM_ALREADY_EXISTS;
+		}
+		parent = *link;
+		link = compare < 0 ? &parent->left : &parent->right;
+	}
+	SetElement inserted = copy ? set->copyElement(element) : element;
+	if(!inserted) {
+		return SET_OUT_OF_MEMORY;
+	}
+	*link = nodeCreate(inserted, parent);
+	if(!*link) {
+		if(copy) {
+			set->freeElement(inserted);
+		}
+		return SET_OUT_OF_MEMORY;
+	}
+	set->size++;
+	setRebalance(set, parent);
+	return SET_SUCCESS;
+}
+
+SetResult setAdd(Set set, SetElement element) {
+	if(!set) {
+		return SET_NULL_ARGUMENT;
+	}
+	return setInsert(set, element, true);
+}
+
+SetResult setAddOwned(Set set, SetElement element) {
+	if(!set || !element) {
+		return SET_NULL_ARGUMENT;
+	}
+	return setInsert(set, element, false);
+}
+
+SetResult setRemove(Set set, SetElement element) {
+	if(!set) {
+		return SET_NULL_ARGUMENT;
+	}
+	SetElement extracted = setExtract(set, element);
+	if(!extracted) {
+		return SET_ITEM_DOES_NOT_EXIST;
+	}
+	set->freeElement(extracted);
+	return SET_SUCCESS;
+}
+
+SetElement setExtract(Set set, SetElement element) {
+	if(!set) {
+		return NULL;
+	}
+	set->current = NULL;
+	SetNode node = setFind(set, element);
+	if(!node) {
+		return NULL;
+	}
+	return setUnlink(set, node);
+}
+
+SetResult setClear(Set set) {
+	if(!set) {
+		return SET_NULL_ARGUMENT;
+	}
+	nodeDestroy(set->root, set->freeElement);
+	set->root = NULL;
+	set->current = NULL;
+	set->size = 0;
+	return SET_SUCCESS;
+}
+
+Set setFilter(Set set, logicalCondition condition) {
+	if(!set || !condition) {
+		return NULL;
+	}
+	Set filtered = setCreate(set->copyElement, set->freeElement, set->compareElements);
+	if(!filtered) {
+		return NULL;
+	}
+	Chain chain = { NULL, NULL, 0 };
+	for(SetNode node = nodeMinimum(set->root); node; node = nodeSuccessor(node)) {
+		if(condition(node->element) && !chainAppendCopy(filtered, &chain, node->element)) {
+			chainDestroy(chain.head, filtered->freeElement);
+			setDestroy(filtered);
+			return NULL;
+		}
+	}
+	setBuild(filtered, chain.head, chain.count);
+	return filtered;
+}
+
+Set setUnion(Set set1, Set set2) {
+	return setMerge(set1, set2, SET_UNION);
+}
+
+Set setIntersection(Set set1, Set set2) {
+	return setMerge(set1, set2, SET_INTERSECTION);
+}
+
+Set setDifference(Set set1, Set set2) {
+	return setMerge(set1, set2, SET_DIFFERENCE);
+}
+
+bool setIsSubset(Set set1, Set set2) {
+	if(!set1 || !set2 || set1->size > set2->size) {
+		return false;
+	}
+	SetNode node2 = nodeMinimum(set2->root);
+	for(SetNode node1 = nodeMinimum(set1->root); node1; node1 = nodeSuccessor(node1)) {
+		int compare = 1;
+		while(node2 && (compare = set1->compareElements(node1->element, node2->element)) > 0) {
+			node2 = nodeSuccessor(node2);
+		}
+		if(compare != 0) {
+			return false;
+		}
+		node2 = nodeSuccessor(node2);
+	}
+	return true;
+}
+
+SetResult setUnionInPlace(Set set, Set other) {
+	if(!set || !other) {
+		return SET_NULL_ARGUMENT;
+	}
+	if(set == other) {
+		return SET_SUCCESS;
+	}
+	SetNode node1 = nodeFlatten(set->root, NULL);
+	SetNode node2 = nodeFlatten(other->root, NULL);
+	other->root = NULL;
+	other->current = NULL;
+	other->size = 0;
+	Chain chain = { NULL, NULL, 0 };
+	while(node1 || node2) {
+		int compare = !node2 ? -1 : !node1 ? 1 :
+				set->compareElements(node1->element, node2->element);
+		if(compare <= 0) {
+			SetNode next = node1->right;
+			chainAppend(&chain, node1);
+			node1 = next;
+		}
+		if(compare >= 0) {
+			SetNode next = node2->right;
+			if(compare == 0) {
+				other->freeElement(node2->element);
+				free(node2);
+			} else {
+				chainAppend(&chain, node2);
+			}
+			node2 = next;
+		}
+	}
+	setBuild(set, chain.head, chain.count);
+	return SET_SUCCESS;
+}
+
+/** Keeps in set only the elements whose presence in other equals keepIfIn */
+static SetResult setRetainInPlace(Set set, Set other, bool keepIfIn) {
+	if(!set || !other) {
+		return SET_NULL_ARGUMENT;
+	}
+	if(set == other) {
+		if(!keepIfIn) {
+			setClear(set);
+		}
+		return SET_SUCCESS;
+	}
+	SetNode node1 = nodeFlatten(set->root, NULL);
+	SetNode node2 = nodeMinimum(other->root);
+	Chain chain = { NULL, NULL, 0 };
+	while(node1) {
+		int compare = 1;
+		while(node2 && (compare = set->compareElements(node1->element, node2->element)) > 0) {
+			node2 = nodeSuccessor(node2);
+		}
+		SetNode next = node1->right;
+		if((compare == 0) == keepIfIn) {
+			chainAppend(&chain, node1);
+		} else {
+			set->freeElement(node1->element);
+			free(node1);
+		}
+		node1 = next;
+	}
+	setBuild(set, chain.head, chain.count);
+	return SET_SUCCESS;
+}
+
+SetResult setIntersectionInPlace(Set set, Set other) {
+	return setRetainInPlace(set, other, true);
+}
+
+SetResult setDifferenceInPlace(Set set, Set other) {
+	return setRetainInPlace(set, other, false);
+}
+
+SetElement setCursorFirst(Set set, SetCursor* cursor) {
+	if(!set || !cursor) {
+		return NULL;
+	}
+	SetNode node = nodeMinimum(set->root);
+	cursor->node = node;
+	return node ? node->element : NULL;
+}
+
+SetElement setCursorNext(SetCursor* cursor) {
+	if(!cursor || !cursor->node) {
+		return NULL;
+	}
+	SetNode node = nodeSuccessor(cursor->node);
+	cursor->node = node;
+	return node ? node->element : NULL;
+}
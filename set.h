@@ -23,11 +23,26 @@
 *   setGetNext		- Advances the internal iterator to the next element and
 *   				  returns it.
 *   setAdd			- Adds a new element to the set.
+*   setAddOwned	- Adds a new element to the set, taking ownership of it
+*   				  instead of copying it.
 *   setRemove		- Removes an element which matches a given element (by the
 *   				  compare function). Resets the internal iterator.
 *	 setClear		- Clears the contents of the set. Frees all the elements of
 *	 				  the set using the free function.
+*   setUnion		- Creates a new set of the elements found in either set.
+*   setIntersection	- Creates a new set of the elements found in both sets.
+*   setDifference	- Creates a new set of the elements of the first set that
+*   				  are not in the second.
+*   setIsSubset	- returns weather or not every element of the first set is
+*   				  in the second.
+*   setUnionInPlace, setIntersectionInPlace, setDifferenceInPlace
+*   				- Like the above, storing the result in the first set
+*   				  without copying elements.
 * 	 SET_FOREACH	- A macro for iterating over the set's elements.
+*   setCursorFirst	- Sets an external cursor to the first element, leaving
+*   				  the set untouched.
+*   setCursorNext	- Advances an external cursor to the next element.
+*   SET_CURSOR_FOREACH - A macro for iterating over the set with a cursor.
 */
 
 /** Type for defining the set */
@@ -45,6 +60,15 @@ typedef enum SetResult_t {
 /** Element data type for set container */
 typedef void* SetElement;
 
+/**
+* An iterator kept outside of the set. Iterating with a cursor does not
+* modify the set, so any number of cursors (and threads) may scan a set at
+* once, as long as the set is not modified meanwhile.
+*/
+typedef struct SetCursor_t {
+	void* node;
+} SetCursor;
+
 /** Type of function for copying an element of the set */
 typedef SetElement(*copySetElements)(SetElement);
 
@@ -179,6 +203,25 @@ SetElement setGetCurrent(Set set);
 */
 SetResult setAdd(Set set, SetElement element);
 
+/**
+*	setAddOwned: Adds a new element to the set without copying it: the set
+*  takes ownership of element and will free it using the free function.
+*  This saves the copy (and the caller's own free) of setAdd when the caller
+*  no longer needs the element. It is the counterpart of setExtract.
+*  Iterator's value is undefined after this operation.
+*
+* @param set - The set for which to add an element
+* @param element - The element to insert, allocated so that the set's free
+* 		function can free it.
+* @return
+* 	SET_NULL_ARGUMENT if a NULL was sent as set or element
+* 	SET_OUT_OF_MEMORY if an allocation failed
+*  SET_ITEM_ALREADY_EXISTS if an equal item already exists in the set
+* 	SET_SUCCESS the element has been inserted successfully
+* 	In every case but SET_SUCCESS the caller keeps ownership of element.
+*/
+SetResult setAddOwned(Set set, SetElement element);
+
 /**
 * 	setRemove: Removes an element from the set. The element is found using the
 * 	comparison function given at initialization. Once found, the element is
@@ -236,6 +279,101 @@ SetResult setClear(Set);
 */
 Set setFilter(Set set, logicalCondition condition);
 
+/**
+* setUnion: Creates a new set which contains the elements that are in set1, in
+* set2 or in both. When both sets hold equal elements, set1's is copied.
+* The two ordered sets are merged in a single pass, in O(n + m).
+* The new set uses set1's copy, free and compare functions, the two sets must
+* hold elements of the same type and order them the same way.
+* @return
+*   NULL if a NULL pointer was sent or memory allocation failed,
+*   the new set otherwise.
+*/
+Set setUnion(Set set1, Set set2);
+
+/**
+* setIntersection: Creates a new set which contains copies of the elements of
+* set1 that are also in set2, in O(n + m). See setUnion.
+* @return
+*   NULL if a NULL pointer was sent or memory allocation failed,
+*   the new set otherwise.
+*/
+Set setIntersection(Set set1, Set set2);
+
+/**
+* setDifference: Creates a new set which contains copies of the elements of
+* set1 that are not in set2, in O(n + m). See setUnion.
+* @return
+*   NULL if a NULL pointer was sent or memory allocation failed,
+*   the new set otherwise.
+*/
+Set setDifference(Set set1, Set set2);
+
+/**
+* setIsSubset: Checks if every element of set1 is also in set2, in O(n + m).
+* Does not modify the internal iterators.
+* @return
+*   false - if one of the sets is NULL, or an element of set1 is not in set2.
+*   true - otherwise.
+*/
+bool setIsSubset(Set set1, Set set2);
+
+/**
+* setUnionInPlace: Moves every element of other into set, without copying
+* them. Elements of other that are already in set are freed using other's
+* free function. other is left empty. Both sets must use the same element
+* functions. Iterators' values are undefined after this operation.
+* O(n + m), allocates no memory.
+* @return
+*   SET_NULL_ARGUMENT if a NULL was sent.
+*   SET_SUCCESS otherwise.
+*/
+SetResult setUnionInPlace(Set set, Set other);
+
+/**
+* setIntersectionInPlace: Removes from set the elements that are not in other,
+* freeing them using the free function. other is not modified.
+* Iterator's value is undefined after this operation.
+* O(n + m), allocates no memory.
+* @return
+*   SET_NULL_ARGUMENT if a NULL was sent.
+*   SET_SUCCESS otherwise.
+*/
+SetResult setIntersectionInPlace(Set set, Set other);
+
+/**
+* setDifferenceInPlace: Removes from set the elements that are in other,
+* freeing them using the free function. other is not modified.
+* Iterator's value is undefined after this operation.
+* O(n + m), allocates no memory.
+* @return
+*   SET_NULL_ARGUMENT if a NULL was sent.
+*   SET_SUCCESS otherwise.
+*/
+SetResult setDifferenceInPlace(Set set, Set other);
+
+/**
+*	setCursorFirst: Sets a cursor to the first element in the set, in the
+*	order induced by the comparison function, and returns it.
+*	Unlike setGetFirst, the set's internal iterator is not modified.
+*
+* @param set - The set to iterate over.
+* @param cursor - The cursor to set.
+* @return
+* 	NULL if a NULL pointer was sent or the set is empty.
+* 	The first element of the set otherwise
+*/
+SetElement setCursorFirst(Set set, SetCursor* cursor);
+
+/**
+*	setCursorNext: Advances a cursor to the next element and returns it.
+* @param cursor - The cursor to advance, set by setCursorFirst.
+* @return
+* 	NULL if reached the end of the set or a NULL sent as argument.
+* 	The next element on the set in case of success
+*/
+SetElement setCursorNext(SetCursor* cursor);
+
 /*!
 * Macro for iterating over a set.
 * Declares a new iterator for the loop.
@@ -245,4 +383,17 @@ Set setFilter(Set set, logicalCondition condition);
 		iterator ;\
 		iterator = setGetNext(set))
 
+/*!
+* Macro for iterating over a set with a cursor of its own, without modifying
+* the set. Iterations may be nested and may run in several threads at once.
+* Declares a new iterator for the loop.
+*/
+#define SET_CURSOR_FOREACH(type,iterator,set) \
+	for(SetCursor iterator##_cursor, *iterator##_once = &iterator##_cursor ; \
+		iterator##_once ; \
+		iterator##_once = NULL) \
+	for(type iterator = setCursorFirst(set, &iterator##_cursor) ; \
+		iterator ;\
+		iterator = setCursorNext(&iterator##_cursor))
+
 #endif /* SET_H_ */
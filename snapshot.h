@@ -0,0 +1,569 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tree.h"
+#include "MtmMap.h"
+
+/**
+ * A binary snapshot format for Tree and MtmMap (and HashTable, see
+ * hash_table_snapshot.h), to restart without re-inserting every element.
+ *
+ * A snapshot file is a 64 byte SnapshotHeader followed by the payload: the
+ * elements in sorted order, as flat arrays of their raw bytes. It holds no
+ * pointers, so it can be mapped at any address. Only trivially copyable
+ * element types can be snapshotted.
+ *
+ * Snapshot::open maps a file read-only and validates its header in O(1).
+ * Snapshot::verify checks the payload checksum in O(n), when the file is not
+ * trusted. A TreeSnapshot or MapSnapshot attached to an open Snapshot is a
+ * read-only view that searches the mapped arrays directly, and can restore
+ * itself into a mutable container in O(n).
+ *
+ * For example:
+ * @code
+ * writeSnapshot("scores.snap", tree);
+ * ...
+ * Snapshot snapshot;
+ * TreeSnapshot<int, IntComp> scores;
+ * if(snapshot.open("scores.snap") && scores.attach(snapshot)) {
+ *     const int* found = scores.find(key);
+ * }
+ * @endcode
+ * A snapshot is written in the byte order and type layout of the machine
+ * that wrote it, a file of another byte order is rejected by open.
+ */
+
+const uint32_t SNAPSHOT_VERSION = 1;
+/** Alignment of the header, the payload and each array inside it */
+const uint64_t SNAPSHOT_ALIGNMENT = 64;
+
+/** The container a snapshot was written from */
+enum SnapshotKind {
+	SNAPSHOT_TREE = 1,
+	SNAPSHOT_MAP = 2,
+	SNAPSHOT_HASH_TABLE = 3
+};
+
+struct SnapshotHeader {
+	char _magic[8];
+	uint32_t _version;
+	// SNAPSHOT_BYTE_ORDER as stored by the writer
+	uint32_t _byteOrder;
+	uint32_t _kind;
+	uint32_t _keySize;
+	uint32_t _valueSize;
+	uint32_t _reserved;
+	uint64_t _count;
+	uint64_t _payloadSize;
+	// checksum of the payload
+	uint64_t _checksum;
+	// checksum of all the fields above
+	uint64_t _headerChecksum;
+};
+
+static_assert(sizeof(SnapshotHeader) == SNAPSHOT_ALIGNMENT,
+		"the payload must start right after the header");
+
+const char SNAPSHOT_MAGIC[8] = "GDSSNAP";
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+inline uint64_t snapshotAlign(uint64_t offset) {
+	return (offset + SNAPSHOT_ALIGNMENT - 1) & ~(SNAPSHOT_ALIGNMENT - 1);
+}
+
+/**
+ * 64 bit FNV-1a checksum, fed incrementally.
+ */
+class SnapshotChecksum {
+	uint64_t _hash;
+public:
+	SnapshotChecksum() : _hash(14695981039346656037ULL) {}
+	void update(const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for(size_t i = 0; i < size; i++) {
+			_hash = (_hash ^ bytes[i]) * 1099511628211ULL;
+		}
+	}
+	uint64_t value() const {
+		return _hash;
+	}
+};
+
+inline uint64_t snapshotHeaderChecksum(const SnapshotHeader& header) {
+	SnapshotChecksum checksum;
+	checksum.update(&header, offsetof(SnapshotHeader, _headerChecksum));
+	return checksum.value();
+}
+
+/**
+ * Writes a snapshot file: the payload is streamed through write and pad, and
+ * commit completes the header.
+ * The file is written under a temporary name and renamed over path by
+ * commit, so a crash while writing never leaves a truncated snapshot at path.
+ */
+class SnapshotWriter {
+	std::string _path;
+	std::string _temporaryPath;
+	FILE* _file;
+	SnapshotHeader _header;
+	SnapshotChecksum _checksum;
+	uint64_t _written;
+public:
+	SnapshotWriter(const char* path, SnapshotKind kind, uint32_t keySize,
+			uint32_t valueSize, uint64_t count)
+	: _path(path), _temporaryPath(_path + ".tmp"), _written(0) {
+		std::memset(&_header, 0, sizeof(_header));
+		std::memcpy(_header._magic, SNAPSHOT_MAGIC, sizeof(_header._magic));
+		_header._version = SNAPSHOT_VERSION;
+		_header._byteOrder = SNAPSHOT_BYTE_ORDER;
+		_header._kind = kind;
+		_header._keySize = keySize;
+		_header._valueSize = valueSize;
+		_header._count = count;
+		_file = std::fopen(_temporaryPath.c_str(), "wb");
+		// the real header is written by commit
+		if(_file && std::fwrite(&_header, sizeof(_header), 1, _file) != 1) {
+			abandon();
+		}
+	}
+	SnapshotWriter(const SnapshotWriter& writer) = delete;
+	SnapshotWriter& operator=(const SnapshotWriter& writer) = delete;
+	/**
+	 * An uncommitted snapshot is deleted.
+	 */
+	~SnapshotWriter() {
+		abandon();
+	}
+	void write(const void* data, size_t size) {
+		if(!_file || size == 0) {
+			return;
+		}
+		if(std::fwrite(data, size, 1, _file) != 1) {
+			abandon();
+			return;
+		}
+		_checksum.update(data, size);
+		_written += size;
+	}
+	/**
+	 * Pads the payload with zeros up to the next SNAPSHOT_ALIGNMENT boundary.
+	 */
+	void pad() {
+		static const unsigned char zeros[SNAPSHOT_ALIGNMENT] = { 0 };
+		write(zeros, snapshotAlign(_written) - _written);
+	}
+	/**
+	 * Completes the header and moves the file to its final path.
+	 * Returns false if any write failed, nothing is left at path then.
+	 */
+	bool commit() {
+		if(!_file) {
+			return false;
+		}
+		_header._payloadSize = _written;
+		_header._checksum = _checksum.value();
+		_header._headerChecksum = snapshotHeaderChecksum(_header);
+		if(std::fseek(_file, 0, SEEK_SET) != 0
+				|| std::fwrite(&_header, sizeof(_header), 1, _file) != 1
+				|| std::fflush(_file) != 0 || fsync(fileno(_file)) != 0) {
+			abandon();
+			return false;
+		}
+		std::fclose(_file);
+		_file = NULL;
+		if(std::rename(_temporaryPath.c_str(), _path.c_str()) != 0) {
+			std::remove(_temporaryPath.c_str());
+			return false;
+		}
+		return true;
+	}
+private:
+	void abandon() {
+		if(!_file) {
+			return;
+		}
+		std::fclose(_file);
+		_file = NULL;
+		std::remove(_temporaryPath.c_str());
+	}
+};
+
+/**
+ * A snapshot file mapped read-only into memory.
+ */
+class Snapshot {
+	void* _memory;
+	size_t _length;
+public:
+	Snapshot() : _memory(NULL), _length(0) {}
+	Snapshot(const Snapshot& snapshot) = delete;
+	Snapshot& operator=(const Snapshot& snapshot) = delete;
+	/**
+	 * Unmaps the file, the views attached to it become invalid.
+	 */
+	~Snapshot() {
+		close();
+	}
+	/**
+	 * Maps the file at path and validates its header, in O(1): pages are
+	 * only read from the disk when they are first touched.
+	 * Returns false if the file can't be mapped, or is not a snapshot of
+	 * this version and byte order, or its size doesn't match its header.
+	 */
+	bool open(const char* path) {
+		close();
+		int descriptor = ::open(path, O_RDONLY);
+		if(descriptor < 0) {
+			return false;
+		}
+		struct stat status;
+		if(fstat(descriptor, &status) != 0
+				|| (uint64_t)status.st_size < sizeof(SnapshotHeader)) {
+			::close(descriptor);
+			return false;
+		}
+		_length = status.st_size;
+		_memory = mmap(NULL, _length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		::close(descriptor);
+		if(_memory == MAP_FAILED) {
+			_memory = NULL;
+			_length = 0;
+			return false;
+		}
+		const SnapshotHeader& fileHeader = header();
+		if(std::memcmp(fileHeader._magic, SNAPSHOT_MAGIC, sizeof(fileHeader._magic)) != 0
+				|| fileHeader._version != SNAPSHOT_VERSION
+				|| fileHeader._byteOrder != SNAPSHOT_BYTE_ORDER
+				|| fileHeader._headerChecksum != snapshotHeaderChecksum(fileHeader)
+				|| fileHeader._payloadSize != _length - sizeof(SnapshotHeader)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+	/**
+	 * Checks the payload against the checksum of the header, in O(n).
+	 */
+	bool verify() const {
+		if(!isOpen()) {
+			return false;
+		}
+		SnapshotChecksum checksum;
+		checksum.update(payload(), header()._payloadSize);
+		return checksum.value() == header()._checksum;
+	}
+	void close() {
+		if(_memory) {
+			munmap(_memory, _length);
+		}
+		_memory = NULL;
+		_length = 0;
+	}
+	bool isOpen() const {
+		return _memory != NULL;
+	}
+	const SnapshotHeader& header() const {
+		return *static_cast<const SnapshotHeader*>(_memory);
+	}
+	const unsigned char* payload() const {
+		return static_cast<const unsigned char*>(_memory) + sizeof(SnapshotHeader);
+	}
+	/**
+	 * Returns true if the snapshot is open and was written from a container
+	 * of the given kind and element sizes, holding arrays that end at
+	 * payloadSize at most.
+	 */
+	bool holds(SnapshotKind kind, uint32_t keySize, uint32_t valueSize,
+			uint64_t payloadSize) const {
+		return isOpen() && header()._kind == (uint32_t)kind
+				&& header()._keySize == keySize
+				&& header()._valueSize == valueSize
+				&& payloadSize <= header()._payloadSize;
+	}
+};
+
+#define treeSnapshotTemplate <T, Comp>
+
+/**
+ * A read-only view of a Tree snapshot: the values in increasing order.
+ * Comp must accept const references.
+ */
+template<class T, class Comp>
+class TreeSnapshot {
+	static_assert(std::is_trivially_copyable<T>::value,
+			"only trivially copyable values can be snapshotted");
+	static_assert(alignof(T) <= SNAPSHOT_ALIGNMENT, "over-aligned value type");
+	const T* _values;
+	uint64_t _count;
+	Comp _compare;
+public:
+	TreeSnapshot() : _values(NULL), _count(0), _compare() {}
+	/**
+	 * Attaches the view to snapshot, in O(1).
+	 * Returns false if snapshot doesn't hold a tree of T.
+	 */
+	bool attach(const Snapshot& snapshot);
+	/**
+	 * Binary searches the snapshot for value.
+	 * Returns a pointer into the mapped file, or NULL if value isn't there.
+	 */
+	const T* find(const T& value) const;
+	uint64_t size() const {
+		return _count;
+	}
+	const T* begin() const {
+		return _values;
+	}
+	const T* end() const {
+		return _values + _count;
+	}
+	/**
+	 * Replaces the content of tree with the values of the snapshot, building
+	 * a balanced tree in O(n) without any rotation. A KeyFilter attached to
+	 * tree is given the restored values.
+	 */
+	void restore(Tree<T, Comp>& tree) const;
+private:
+	Node<T>* build(Tree<T, Comp>& tree, uint64_t low, uint64_t high,
+			Node<T>* father) const;
+};
+
+template<class T, class Comp>
+bool TreeSnapshot treeSnapshotTemplate::attach(const Snapshot& snapshot) {
+	// the count is checked first so that the size of the values can't overflow
+	if(!snapshot.isOpen()
+			|| snapshot.header()._count > snapshot.header()._payloadSize / sizeof(T)
+			|| !snapshot.holds(SNAPSHOT_TREE, sizeof(T), 0,
+					snapshot.header()._count * sizeof(T))) {
+		return false;
+	}
+	_values = reinterpret_cast<const T*>(snapshot.payload());
+	_count = snapshot.header()._count;
+	return true;
+}
+
+template<class T, class Comp>
+const T* TreeSnapshot treeSnapshotTemplate::find(const T& value) const {
+	uint64_t low = 0, high = _count;
+	while(low < high) {
+		uint64_t middle = low + (high - low) / 2;
+		int result = _compare(value, _values[middle]);
+		if(result == 0) {
+			return &_values[middle];
+		}
+		if(result > 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return NULL;
+}
+
+template<class T, class Comp>
+void TreeSnapshot treeSnapshotTemplate::restore(Tree<T, Comp>& tree) const {
+	tree.clean();
+	tree._root = build(tree, 0, _count, NULL);
+	tree._node_number = (int)_count;
+	tree.resetExtremes();
+	// the nodes were built behind the tree's back, an attached filter must
+	// be given their values (and is detached if it can't take them)
+	tree.attachFilter(tree._filter);
+}
+
+template<class T, class Comp>
+Node<T>* TreeSnapshot treeSnapshotTemplate::build(Tree<T, Comp>& tree,
+		uint64_t low, uint64_t high, Node<T>* father) const {
+	if(low >= high) {
+		return NULL;
+	}
+	uint64_t middle = low + (high - low) / 2;
+	T value = _values[middle];
+	Node<T>* node = allocateNode<Node<T> >(tree._resource, value, father);
+	node->_left_son = build(tree, low, middle, node);
+	node->_right_son = build(tree, middle + 1, high, node);
+	int leftHeight = node->_left_son ? node->_left_son->_height : 0;
+	int rightHeight = node->_right_son ? node->_right_son->_height : 0;
+	node->_height = (leftHeight > rightHeight ? leftHeight : rightHeight) + 1;
+	return node;
+}
+
+template<class T>
+void writeTreeSnapshotAux(SnapshotWriter& writer, Node<T>* node) {
+	if(!node) return;
+	writeTreeSnapshotAux<T>(writer, node->_left_son);
+	writer.write(&node->_value, sizeof(T));
+	writeTreeSnapshotAux<T>(writer, node->_right_son);
+}
+
+/**
+ * Writes the values of tree to a snapshot file at path, in increasing order.
+ * Returns false if the file couldn't be written.
+ */
+template<class T, class Comp>
+bool writeSnapshot(const char* path, Tree<T, Comp>& tree) {
+	static_assert(std::is_trivially_copyable<T>::value,
+			"only trivially copyable values can be snapshotted");
+	SnapshotWriter writer(path, SNAPSHOT_TREE, sizeof(T), 0, tree.getNodeNumber());
+	writeTreeSnapshotAux<T>(writer, tree._root);
+	return writer.commit();
+}
+
+#define mapSnapshotTemplate <KeyType, ValueType, CompareFunction>
+
+/**
+ * A read-only view of an MtmMap snapshot.
+ * The payload holds the map's default value, then its keys in increasing
+ * order, then the matching values, each array starting at an aligned offset
+ * so that binary searches only touch the pages of the keys.
+ */
+template<class KeyType, class ValueType,
+		class CompareFunction = std::less<KeyType> >
+class MapSnapshot {
+	static_assert(std::is_trivially_copyable<KeyType>::value
+			&& std::is_trivially_copyable<ValueType>::value,
+			"only trivially copyable keys and values can be snapshotted");
+	static_assert(alignof(KeyType) <= SNAPSHOT_ALIGNMENT
+			&& alignof(ValueType) <= SNAPSHOT_ALIGNMENT, "over-aligned type");
+	const ValueType* _defaultValue;
+	const KeyType* _keys;
+	const ValueType* _values;
+	uint64_t _count;
+	CompareFunction compare;
+public:
+	MapSnapshot()
+	: _defaultValue(NULL), _keys(NULL), _values(NULL), _count(0), compare() {}
+	/**
+	 * Offsets, from the start of the payload, of the keys and of the values
+	 * of a map of count elements.
+	 */
+	static uint64_t keysOffset() {
+		return snapshotAlign(sizeof(ValueType));
+	}
+	static uint64_t valuesOffset(uint64_t count) {
+		return snapshotAlign(keysOffset() + count * sizeof(KeyType));
+	}
+	/**
+	 * Attaches the view to snapshot, in O(1).
+	 * Returns false if snapshot doesn't hold a map of KeyType to ValueType.
+	 */
+	bool attach(const Snapshot& snapshot);
+	/**
+	 * Binary searches the snapshot for key.
+	 * Returns a pointer to its value inside the mapped file, or NULL if key
+	 * isn't there.
+	 */
+	const ValueType* find(const KeyType& key) const;
+	bool containsKey(const KeyType& key) const {
+		return find(key) != NULL;
+	}
+	uint64_t size() const {
+		return _count;
+	}
+	/**
+	 * The key and the value of the element at index, in increasing key order.
+	 */
+	const KeyType& keyAt(uint64_t index) const {
+		return _keys[index];
+	}
+	const ValueType& valueAt(uint64_t index) const {
+		return _values[index];
+	}
+	/**
+	 * The default value of the map the snapshot was written from, to
+	 * construct the map to restore into.
+	 */
+	const ValueType& defaultValue() const {
+		return *_defaultValue;
+	}
+	/**
+	 * Replaces the content of map with the elements of the snapshot, in O(n).
+	 */
+	void restore(mtm::MtmMap<KeyType, ValueType, CompareFunction>& map) const;
+};
+
+template<class KeyType, class ValueType, class CompareFunction>
+bool MapSnapshot mapSnapshotTemplate::attach(const Snapshot& snapshot) {
+	if(!snapshot.isOpen()) {
+		return false;
+	}
+	uint64_t count = snapshot.header()._count;
+	// checked first so that the size of the keys and values can't overflow
+	if(count > snapshot.header()._payloadSize / (sizeof(KeyType) + sizeof(ValueType))
+			|| !snapshot.holds(SNAPSHOT_MAP, sizeof(KeyType), sizeof(ValueType),
+					valuesOffset(count) + count * sizeof(ValueType))) {
+		return false;
+	}
+	const unsigned char* payload = snapshot.payload();
+	_defaultValue = reinterpret_cast<const ValueType*>(payload);
+	_keys = reinterpret_cast<const KeyType*>(payload + keysOffset());
+	_values = reinterpret_cast<const ValueType*>(payload + valuesOffset(count));
+	_count = count;
+	return true;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+const ValueType* MapSnapshot mapSnapshotTemplate::find(const KeyType& key) const {
+	uint64_t low = 0, high = _count;
+	while(low < high) {
+		uint64_t middle = low + (high - low) / 2;
+		if(compare(_keys[middle], key)) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if(low < _count && !compare(key, _keys[low])) {
+		return &_values[low];
+	}
+	return NULL;
+}
+
+template<class KeyType, class ValueType, class CompareFunction>
+void MapSnapshot mapSnapshotTemplate::restore(
+		mtm::MtmMap<KeyType, ValueType, CompareFunction>& map) const {
+	map.clear();
+	// each smallest key so far is linked in front of the list, in O(1)
+	for(uint64_t i = _count; i > 0; i--) {
+		map.insert(_keys[i - 1], _values[i - 1]);
+	}
+}
+
+/**
+ * Writes the elements of map, and its default value, to a snapshot file at
+ * path. Returns false if the file couldn't be written.
+ */
+template<class KeyType, class ValueType, class CompareFunction>
+bool writeSnapshot(const char* path,
+		const mtm::MtmMap<KeyType, ValueType, CompareFunction>& map) {
+	static_assert(std::is_trivially_copyable<KeyType>::value
+			&& std::is_trivially_copyable<ValueType>::value,
+			"only trivially copyable keys and values can be snapshotted");
+	typedef typename mtm::MtmMap<KeyType, ValueType, CompareFunction>::iterator
+			iterator;
+	uint64_t count = map.size();
+	SnapshotWriter writer(path, SNAPSHOT_MAP, sizeof(KeyType),
+			sizeof(ValueType), count);
+	writer.write(&map.defaultValue(), sizeof(ValueType));
+	writer.pad();
+	for(iterator it = map.begin(); it != map.end(); ++it) {
+		writer.write(&(*it).first, sizeof(KeyType));
+	}
+	writer.pad();
+	for(iterator it = map.begin(); it != map.end(); ++it) {
+		writer.write(&(*it).second, sizeof(ValueType));
+	}
+	return writer.commit();
+}
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,22 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+/**
+ * Hot path statistics of Tree, HashTable and UnionFind: comparator calls,
+ * descent depths, rotations, chain lengths and Find path lengths, with the
+ * memory footprint of each container.
+ *
+ * The counters are compiled in only when GENERICDS_STATS is defined (e.g.
+ * with -DGENERICDS_STATS), every container then has a getStats() method that
+ * returns a snapshot of its counters, to be scraped periodically, and a
+ * resetStats() method. Otherwise GENERICDS_STAT(...) expands to nothing and
+ * the containers hold no counters at all.
+ * The counters are as thread safe as the containers they belong to.
+ */
+#ifdef GENERICDS_STATS
+#define GENERICDS_STAT(statement) do { statement; } while(0)
+#else
+#define GENERICDS_STAT(statement) do { } while(0)
+#endif
+
+#endif /* STATS_H_ */
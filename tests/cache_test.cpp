@@ -0,0 +1,64 @@
+/**
+ * Regression tests of Cache.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. tests/cache_test.cpp -o cache_test && ./cache_test
+ */
+#include <cstdio>
+#include <random>
+#include "cache.h"
+#include "test.h"
+
+const CachePolicy POLICIES[] = { CACHE_LRU, CACHE_CLOCK, CACHE_S3FIFO };
+
+/**
+ * Growing the charge of a cached key evicts entries to make room, and under
+ * CLOCK and S3-FIFO that used to evict the entry being written.
+ */
+void testUpdateDoesNotEvictItself() {
+	for(int i = 0; i < 3; i++) {
+		Cache<int, int> cache(10, POLICIES[i]);
+		for(int key = 0; key < 10; key++) {
+			CHECK(cache.put(key, key));
+		}
+		for(int key = 1; key < 10; key++) {
+			CHECK(cache.get(key) != NULL);
+		}
+		CHECK(cache.put(0, 100, 3));
+		int* value = cache.get(0);
+		CHECK(value != NULL && *value == 100);
+		CHECK(cache.charge() <= cache.capacity());
+		CHECK(cache.size() == 8);
+	}
+}
+
+/**
+ * Whatever was evicted, a key put successfully is found right after, and
+ * the charges never exceed the capacity.
+ */
+void testPutThenGet() {
+	for(int i = 0; i < 3; i++) {
+		Cache<int, int> cache(100, POLICIES[i]);
+		std::mt19937 random(i + 1);
+		for(int step = 0; step < 200000; step++) {
+			int key = (int)(random() % 300);
+			if(random() % 2) {
+				cache.get(key);
+				continue;
+			}
+			size_t charge = 1 + random() % 20;
+			CHECK(cache.put(key, step, charge));
+			int* value = cache.get(key);
+			CHECK(value != NULL && *value == step);
+			CHECK(cache.charge() <= cache.capacity());
+		}
+	}
+}
+
+int main() {
+	testUpdateDoesNotEvictItself();
+	testPutThenGet();
+	std::printf("cache_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * Stress test of ConcurrentList: threads append, scan and remove at once.
+ *
+ * Build and run from the repository root (add -fsanitize=thread to have
+ * ThreadSanitizer check the run):
+ *
+ *   g++ -std=c++17 -O2 -I. tests/concurrent_list_test.cpp \
+ *       -o concurrent_list_test -pthread && ./concurrent_list_test
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "concurrent_list.h"
+#include "test.h"
+
+const int APPENDERS = 4;
+const int REMOVERS = 2;
+const int READERS = 2;
+const int PER_APPENDER = 4000;
+
+/**
+ * The values of appender a are a * PER_APPENDER + i, appended in increasing
+ * i; remover r removes the even i of appender r.
+ */
+int valueOf(int appender, int i) {
+	return appender * PER_APPENDER + i;
+}
+
+/**
+ * Checks that every value of a scan is one that was appended and that the
+ * values of each appender come in the order they were appended.
+ */
+void checkScan(const ConcurrentList<int>& list) {
+	std::vector<int> last(APPENDERS, -1);
+	for(ConcurrentList<int>::iterator it = list.begin(); it != list.end(); ++it) {
+		int value = *it;
+		CHECK(value >= 0 && value < APPENDERS * PER_APPENDER);
+		int appender = value / PER_APPENDER;
+		CHECK(value % PER_APPENDER > last[appender]);
+		last[appender] = value % PER_APPENDER;
+	}
+}
+
+void testAppendScanRemove() {
+	Watchdog watchdog("testAppendScanRemove", 300);
+	for(int round = 0; round < 3; round++) {
+		ConcurrentList<int> list;
+		std::atomic<int> appending(APPENDERS);
+		std::vector<std::thread> threads;
+		for(int a = 0; a < APPENDERS; a++) {
+			threads.push_back(std::thread([&list, &appending, a]() {
+				for(int i = 0; i < PER_APPENDER; i++) {
+					list.insert(valueOf(a, i));
+				}
+				appending--;
+			}));
+		}
+		for(int r = 0; r < REMOVERS; r++) {
+			threads.push_back(std::thread([&list, r]() {
+				for(int i = 0; i < PER_APPENDER; i += 2) {
+					// the value may not be appended yet
+					while(!list.remove(valueOf(r, i))) {
+						std::this_thread::yield();
+					}
+				}
+			}));
+		}
+		for(int t = 0; t < READERS; t++) {
+			threads.push_back(std::thread([&list, &appending]() {
+				do {
+					checkScan(list);
+				} while(appending.load() > 0);
+			}));
+		}
+		for(size_t t = 0; t < threads.size(); t++) {
+			threads[t].join();
+		}
+
+		CHECK(list.size() == APPENDERS * PER_APPENDER - REMOVERS * PER_APPENDER / 2);
+		checkScan(list);
+		std::vector<int> next(APPENDERS, 0);
+		for(int r = 0; r < REMOVERS; r++) {
+			next[r] = 1;
+		}
+		unsigned int count = 0;
+		for(ConcurrentList<int>::iterator it = list.begin(); it != list.end(); ++it) {
+			int appender = *it / PER_APPENDER;
+			CHECK(*it % PER_APPENDER == next[appender]);
+			next[appender] += appender < REMOVERS ? 2 : 1;
+			count++;
+		}
+		CHECK(count == list.size());
+	}
+}
+
+int main() {
+	testAppendScanRemove();
+	std::printf("concurrent_list_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,176 @@
+/**
+ * Regression tests of DiskMtmMap.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. -Ibenchmark/fixtures tests/disk_mtm_map_test.cpp \
+ *       -o disk_mtm_map_test && ./disk_mtm_map_test
+ */
+#include <cstdio>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <csignal>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "DiskMtmMap.h"
+#include "test.h"
+
+// small pages and the smallest cache, so that pages split and are evicted
+typedef mtm::DiskMtmMap<int, int, std::less<int>, 256> Map;
+const unsigned int CACHE_PAGES = 16;
+
+std::string pathOf(const char* name) {
+	return std::string("disk_mtm_map_test.") + name + "."
+			+ std::to_string(getpid()) + ".map";
+}
+
+void checkSame(const Map& map, const std::map<int, int>& expected) {
+	CHECK(map.size() == expected.size());
+	Map::iterator it = map.begin();
+	for(std::map<int, int>::const_iterator e = expected.begin();
+			e != expected.end(); ++e, ++it) {
+		CHECK(it != map.end());
+		Map::Pair pair = *it;
+		CHECK(pair.first == e->first && pair.second == e->second);
+	}
+	CHECK(it == map.end());
+}
+
+void randomOperations(Map& map, std::map<int, int>& expected,
+		std::mt19937& random, int operations) {
+	std::uniform_int_distribution<int> keys(0, 5000);
+	for(int i = 0; i < operations; i++) {
+		int key = keys(random);
+		if(random() % 3 == 0) {
+			bool present = expected.erase(key) > 0;
+			bool thrown = false;
+			try {
+				map.remove(key);
+			} catch(const mtm::MapElementNotFoundException&) {
+				thrown = true;
+			}
+			CHECK(thrown == !present);
+		} else {
+			map.insert(key, i);
+			expected[key] = i;
+		}
+		int probe = keys(random);
+		std::map<int, int>::iterator found = expected.find(probe);
+		CHECK(map.containsKey(probe) == (found != expected.end()));
+		CHECK(map[probe] == (found == expected.end() ? -1 : found->second));
+	}
+}
+
+/**
+ * Inserts and removes follow a std::map, through splits and evictions, and
+ * the file holds the same elements when it is reopened.
+ */
+void testMatchesStdMap() {
+	std::string path = pathOf("match");
+	std::mt19937 random(7);
+	std::map<int, int> expected;
+	{
+		Map map(path.c_str(), -1, CACHE_PAGES);
+		randomOperations(map, expected, random, 40000);
+		checkSame(map, expected);
+	}
+	{
+		Map map(path.c_str(), -1, CACHE_PAGES);
+		checkSame(map, expected);
+		randomOperations(map, expected, random, 20000);
+		map.flush();
+		checkSame(map, expected);
+	}
+	{
+		Map map(path.c_str(), -1, CACHE_PAGES);
+		checkSame(map, expected);
+		map.clear();
+		expected.clear();
+		checkSame(map, expected);
+		randomOperations(map, expected, random, 5000);
+	}
+	{
+		Map map(path.c_str(), -1, CACHE_PAGES);
+		checkSame(map, expected);
+	}
+	std::remove(path.c_str());
+}
+
+/**
+ * A process that dies after pages were evicted, before flushing, leaves a
+ * file whose header may not match them: opening it must fail rather than
+ * return a map missing the elements of the split root.
+ */
+void testUnflushedFileIsRejected() {
+	std::string path = pathOf("unflushed");
+	pid_t child = fork();
+	CHECK(child >= 0);
+	if(child == 0) {
+		Map* map = new Map(path.c_str(), -1, CACHE_PAGES);
+		for(int key = 0; key < 10000; key++) {
+			map->insert(key, key);
+		}
+		// dies without flushing, like a crash
+		_exit(0);
+	}
+	int status;
+	CHECK(waitpid(child, &status, 0) == child && WIFEXITED(status));
+	bool thrown = false;
+	try {
+		Map map(path.c_str(), -1, CACHE_PAGES);
+	} catch(const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	std::remove(path.c_str());
+}
+
+int openFiles() {
+	int count = 0;
+	DIR* directory = opendir("/proc/self/fd");
+	CHECK(directory != NULL);
+	while(readdir(directory)) {
+		count++;
+	}
+	closedir(directory);
+	return count;
+}
+
+/**
+ * A map that can't write its new file throws from the constructor, and must
+ * close the file and free its cache itself since no destructor runs.
+ */
+void testFailedCreationReleasesTheFile() {
+	std::string path = pathOf("full");
+	struct rlimit limit;
+	CHECK(getrlimit(RLIMIT_FSIZE, &limit) == 0);
+	struct rlimit full = limit;
+	full.rlim_cur = 0;
+	// past the limit, writes fail with EFBIG instead of raising SIGXFSZ
+	std::signal(SIGXFSZ, SIG_IGN);
+	int before = openFiles();
+	CHECK(setrlimit(RLIMIT_FSIZE, &full) == 0);
+	bool thrown = false;
+	try {
+		Map map(path.c_str(), -1, CACHE_PAGES);
+	} catch(const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(setrlimit(RLIMIT_FSIZE, &limit) == 0);
+	std::signal(SIGXFSZ, SIG_DFL);
+	CHECK(thrown);
+	CHECK(openFiles() == before);
+	std::remove(path.c_str());
+}
+
+int main() {
+	testMatchesStdMap();
+	testUnflushedFileIsRejected();
+	testFailedCreationReleasesTheFile();
+	std::printf("disk_mtm_map_test: ok\n");
+	return 0;
+}
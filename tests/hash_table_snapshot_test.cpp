@@ -0,0 +1,133 @@
+/**
+ * Regression tests of HashTableSnapshot and of the size checks of the
+ * snapshot views.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. -Ibenchmark/fixtures \
+ *       tests/hash_table_snapshot_test.cpp -o hash_table_snapshot_test \
+ *       && ./hash_table_snapshot_test
+ */
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "troll.h"
+#include "hash_table_snapshot.h"
+#include "test.h"
+
+struct IntComp {
+	int operator()(int a, int b) const {
+		return a < b ? -1 : (a > b ? 1 : 0);
+	}
+};
+
+std::string pathOf(const char* name) {
+	return std::string("hash_table_snapshot_test.") + name + "."
+			+ std::to_string(getpid()) + ".snap";
+}
+
+/**
+ * Writes a hash table snapshot of the given bucket offsets and IDs, with
+ * a valid header and checksum whatever they hold.
+ */
+void writeRaw(const std::string& path, const std::vector<uint32_t>& offsets,
+		const std::vector<int>& ids, uint64_t count) {
+	SnapshotWriter writer(path.c_str(), SNAPSHOT_HASH_TABLE, sizeof(int), 0, count);
+	writer.write(&offsets[0], offsets.size() * sizeof(uint32_t));
+	writer.pad();
+	if(!ids.empty()) {
+		writer.write(&ids[0], ids.size() * sizeof(int));
+	}
+	CHECK(writer.commit());
+}
+
+void testAttachRejectsBadOffsets() {
+	std::string path = pathOf("offsets");
+	std::vector<int> ids(4, 7);
+	// offsets[SIZE] is right, but a bucket ends past the IDs
+	std::vector<uint32_t> offsets(SIZE + 1, 0);
+	offsets[5] = 1000;
+	offsets[6] = 4;
+	for(int index = 6; index <= SIZE; index++) {
+		offsets[index] = 4;
+	}
+	writeRaw(path, offsets, ids, 4);
+	Snapshot snapshot;
+	CHECK(snapshot.open(path.c_str()));
+	HashTableSnapshot view;
+	CHECK(!view.attach(snapshot));
+	CHECK(!view.contains(5));
+	snapshot.close();
+
+	// non-decreasing offsets within the IDs are accepted
+	offsets[5] = 0;
+	offsets[7] = 4;
+	writeRaw(path, offsets, ids, 4);
+	CHECK(snapshot.open(path.c_str()));
+	CHECK(view.attach(snapshot));
+	CHECK(view.size() == 4);
+	CHECK(!view.contains(-SIZE + 6));
+	std::remove(path.c_str());
+}
+
+void testAttachRejectsHugeCounts() {
+	std::string path = pathOf("count");
+	std::vector<uint32_t> offsets(SIZE + 1, 0);
+	// count * sizeof(int) wraps around to a small size
+	uint64_t count = (uint64_t)1 << 62;
+	offsets[SIZE] = (uint32_t)count;
+	writeRaw(path, offsets, std::vector<int>(), count);
+	Snapshot snapshot;
+	CHECK(snapshot.open(path.c_str()));
+	HashTableSnapshot view;
+	CHECK(!view.attach(snapshot));
+	TreeSnapshot<int, IntComp> treeView;
+	CHECK(!treeView.attach(snapshot));
+	snapshot.close();
+	std::remove(path.c_str());
+
+	path = pathOf("tree");
+	SnapshotWriter writer(path.c_str(), SNAPSHOT_TREE, sizeof(int), 0, count);
+	int value = 1;
+	writer.write(&value, sizeof(value));
+	CHECK(writer.commit());
+	CHECK(snapshot.open(path.c_str()));
+	CHECK(!treeView.attach(snapshot));
+	std::remove(path.c_str());
+}
+
+void testRoundTrip() {
+	std::string path = pathOf("table");
+	std::vector<Troll> trolls;
+	for(int i = 0; i < 100; i++) {
+		trolls.push_back(Troll(i * 37));
+	}
+	HashTable table;
+	for(size_t i = 0; i < trolls.size(); i++) {
+		table.insert(&trolls[i]);
+	}
+	CHECK(writeSnapshot(path.c_str(), table));
+	Snapshot snapshot;
+	CHECK(snapshot.open(path.c_str()));
+	HashTableSnapshot view;
+	CHECK(view.attach(snapshot));
+	CHECK(view.size() == 100);
+	for(int i = 0; i < 100; i++) {
+		CHECK(view.contains(i * 37));
+		CHECK(!view.contains(i * 37 + 1));
+		CHECK(!view.contains(-i * 37 - 1));
+	}
+	for(size_t i = 0; i < trolls.size(); i++) {
+		table.remove(&trolls[i]);
+	}
+	std::remove(path.c_str());
+}
+
+int main() {
+	testAttachRejectsBadOffsets();
+	testAttachRejectsHugeCounts();
+	testRoundTrip();
+	std::printf("hash_table_snapshot_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * Regression tests of IntrusiveList and of the intrusive mode of List.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. tests/intrusive_list_test.cpp -o intrusive_list_test \
+ *       && ./intrusive_list_test
+ */
+#include <cstdio>
+#include <vector>
+#include "intrusive_list.h"
+#include "list_cpp.h"
+#include "test.h"
+
+struct FirstTag;
+struct SecondTag;
+
+/**
+ * A hook that isn't the first base of its object, so the object and the
+ * hook are at different addresses.
+ */
+struct Item : public IntrusiveListHook<FirstTag>, public IntrusiveListHook<SecondTag> {
+	int _value;
+	explicit Item(int value = 0) : _value(value) {}
+};
+
+/**
+ * An object linked in two lists at once is found back from each of its
+ * hooks, in the order of each list.
+ */
+void testTwoListsAtOnce() {
+	std::vector<Item> items;
+	for(int i = 0; i < 10; i++) {
+		items.push_back(Item(i));
+	}
+	IntrusiveList<Item, FirstTag> first;
+	IntrusiveList<Item, SecondTag> second;
+	for(int i = 0; i < 10; i++) {
+		first.insert(&items[i]);
+		second.insertFirst(&items[i]);
+	}
+	first.remove(&items[3]);
+	second.remove(&items[6]);
+	CHECK(first.front() == &items[0] && first.back() == &items[9]);
+	CHECK(second.front() == &items[9] && second.back() == &items[0]);
+	int expected = 0;
+	for(IntrusiveList<Item, FirstTag>::iterator it = first.begin(); it != first.end(); ++it) {
+		if(expected == 3) expected++;
+		CHECK((*it)._value == expected);
+		expected++;
+	}
+	CHECK(expected == 10);
+	expected = 9;
+	for(IntrusiveList<Item, SecondTag>::iterator it = second.begin(); it != second.end(); ++it) {
+		if(expected == 6) expected--;
+		CHECK((*it)._value == expected);
+		expected--;
+	}
+	CHECK(expected == -1);
+	CHECK(!items[3].IntrusiveListHook<FirstTag>::isLinked());
+	CHECK(items[3].IntrusiveListHook<SecondTag>::isLinked());
+	first.clear();
+	CHECK(first.empty() && !second.empty());
+	second.clear();
+}
+
+/**
+ * List<Intrusive<T, Tag> > walks its objects like a List<T*>, without
+ * allocating a node per object.
+ */
+void testIntrusiveList() {
+	std::vector<Item> items;
+	for(int i = 0; i < 5; i++) {
+		items.push_back(Item(i));
+	}
+	List<Intrusive<Item, FirstTag> > list;
+	for(int i = 0; i < 5; i++) {
+		list.insert(&items[i]);
+	}
+	list.remove(&items[0]);
+	int expected = 1;
+	for(List<Intrusive<Item, FirstTag> >::iterator it = list.begin(); it != list.end(); ++it) {
+		CHECK(*it == &items[expected]);
+		expected++;
+	}
+	CHECK(expected == 5);
+}
+
+int main() {
+	testTwoListsAtOnce();
+	testIntrusiveList();
+	std::printf("intrusive_list_test: ok\n");
+	return 0;
+}
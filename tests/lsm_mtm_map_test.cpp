@@ -0,0 +1,43 @@
+/**
+ * Regression tests of LsmMtmMap.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. -Ibenchmark/fixtures tests/lsm_mtm_map_test.cpp \
+ *       -o lsm_mtm_map_test -pthread && ./lsm_mtm_map_test
+ */
+#include <map>
+#include <random>
+#include "LsmMtmMap.h"
+#include "test.h"
+
+/**
+ * A tiny memtable makes many small runs whose merges drop duplicates, which
+ * used to leave no group of one tier to compact at MAX_RUNS runs: the
+ * compaction and the writer then waited for each other forever.
+ */
+void testTinyMemtableDoesNotDeadlock() {
+	Watchdog watchdog("testTinyMemtableDoesNotDeadlock", 300);
+	for(unsigned int seed = 1; seed <= 5; seed++) {
+		mtm::LsmMtmMap<int, int> map(0, 8);
+		std::map<int, int> expected;
+		std::mt19937 random(seed);
+		for(int i = 0; i < 2000000; i++) {
+			int key = (int)(random() % 1000000);
+			map.insert(key, i);
+			expected[key] = i;
+		}
+		CHECK(map.size() == expected.size());
+		std::map<int, int>::const_iterator it = expected.begin();
+		for(mtm::LsmMtmMap<int, int>::iterator element = map.begin();
+				element != map.end(); ++element, ++it) {
+			CHECK((*element).first == it->first && (*element).second == it->second);
+		}
+	}
+}
+
+int main() {
+	testTinyMemtableDoesNotDeadlock();
+	std::printf("lsm_mtm_map_test: ok\n");
+	return 0;
+}
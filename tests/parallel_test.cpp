@@ -0,0 +1,89 @@
+/**
+ * Regression tests of the parallel traversals of MtmMap.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -pthread -I. -Ibenchmark/fixtures tests/parallel_test.cpp \
+ *       -o parallel_test && ./parallel_test
+ */
+#include <cstdio>
+#include <vector>
+#include "parallel.h"
+#include "test.h"
+
+typedef mtm::MtmMap<int, long> Map;
+
+/**
+ * The runs of splitPoints cover the map in order, all of one length but
+ * the last, and there are between chunks / 2 and chunks of them.
+ */
+void checkSplits(const Map& map, size_t chunks) {
+	std::vector<Map::iterator> splits = map.splitPoints(chunks);
+	size_t size = map.size();
+	CHECK(splits.back() == map.end());
+	size_t runs = splits.size() - 1;
+	CHECK(runs <= chunks);
+	CHECK(runs >= (size < chunks ? size : chunks / 2));
+	std::vector<size_t> lengths;
+	Map::iterator it = map.begin();
+	for(size_t i = 0; i < runs; i++) {
+		CHECK(it == splits[i]);
+		size_t length = 0;
+		for(; it != splits[i + 1]; ++it) {
+			length++;
+		}
+		CHECK(length > 0);
+		lengths.push_back(length);
+	}
+	CHECK(it == map.end());
+	for(size_t i = 0; i + 1 < runs; i++) {
+		CHECK(lengths[i] == lengths[0]);
+		CHECK(lengths[i + 1] <= lengths[0]);
+	}
+}
+
+/**
+ * splitPoints is kept from call to call, and must be found again after the
+ * map changes (the old runs would miss or revisit elements).
+ */
+void testSplitPointsFollowTheMap() {
+	Map map(0);
+	checkSplits(map, PARALLEL_CHUNKS);
+	for(int size = 1; size <= 3000; size += 37) {
+		// inserting in decreasing order links each key in front, in O(1)
+		map.clear();
+		for(int i = size; i > 0; i--) {
+			map.insert(i, i);
+		}
+		checkSplits(map, PARALLEL_CHUNKS);
+		checkSplits(map, PARALLEL_CHUNKS);
+		checkSplits(map, 5);
+	}
+	long expected = 0;
+	for(int i = 1; i <= 3000; i++) {
+		map.insert(i, i);
+		expected += i;
+	}
+	CHECK(parallel_reduce(map, 0L, [](const Map::Pair& pair) { return pair.second; },
+			[](long a, long b) { return a + b; }) == expected);
+	map.insert(5000, 5000);
+	map.remove(1);
+	map.remove(1500);
+	expected += 5000 - 1 - 1500;
+	checkSplits(map, PARALLEL_CHUNKS);
+	CHECK(parallel_reduce(map, 0L, [](const Map::Pair& pair) { return pair.second; },
+			[](long a, long b) { return a + b; }) == expected);
+	long visited = 0;
+	std::mutex mutex;
+	parallel_for_each(map, [&](Map::Pair& pair) {
+		std::lock_guard<std::mutex> lock(mutex);
+		visited += pair.second;
+	});
+	CHECK(visited == expected);
+}
+
+int main() {
+	testSplitPointsFollowTheMap();
+	std::printf("parallel_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+/**
+ * The few helpers the regression tests share: a failed CHECK prints where
+ * it failed and exits with 1, and a Watchdog turns a hang into a failure.
+ */
+
+#define CHECK(condition) do { \
+	if(!(condition)) { \
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+		std::exit(1); \
+	} \
+} while(0)
+
+/**
+ * Fails the test if it is still alive seconds after the watchdog was
+ * created (e.g. deadlocked), unless the watchdog was destroyed before.
+ */
+class Watchdog {
+	std::mutex _mutex;
+	std::condition_variable _done;
+	bool _finished;
+	std::thread _thread;
+public:
+	Watchdog(const char* name, int seconds) : _finished(false) {
+		_thread = std::thread([this, name, seconds]() {
+			std::unique_lock<std::mutex> lock(_mutex);
+			if(!_done.wait_for(lock, std::chrono::seconds(seconds),
+					[this]() { return _finished; })) {
+				std::fprintf(stderr, "%s: still running after %d seconds\n", name, seconds);
+				std::_Exit(1);
+			}
+		});
+	}
+	Watchdog(const Watchdog& watchdog) = delete;
+	Watchdog& operator=(const Watchdog& watchdog) = delete;
+	~Watchdog() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_finished = true;
+		}
+		_done.notify_all();
+		_thread.join();
+	}
+};
+
+#endif /* TEST_H_ */
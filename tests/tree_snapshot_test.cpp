@@ -0,0 +1,67 @@
+/**
+ * Regression tests of TreeSnapshot.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. -Ibenchmark/fixtures tests/tree_snapshot_test.cpp \
+ *       -o tree_snapshot_test && ./tree_snapshot_test
+ */
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+#include "snapshot.h"
+#include "key_filter.h"
+#include "test.h"
+
+struct IntComp {
+	int operator()(int a, int b) const {
+		return a < b ? -1 : (a > b ? 1 : 0);
+	}
+};
+
+/**
+ * restore builds the nodes directly, a filter attached to the tree used to
+ * never see the restored values and hid all of them from find.
+ */
+void testRestoreFillsAttachedFilter() {
+	std::string path = "tree_snapshot_test." + std::to_string(getpid()) + ".snap";
+	Tree<int, IntComp> source;
+	for(int i = 0; i < 1000; i++) {
+		int value = i * 7;
+		source.insert(value);
+	}
+	CHECK(writeSnapshot(path.c_str(), source));
+	Snapshot snapshot;
+	CHECK(snapshot.open(path.c_str()));
+	TreeSnapshot<int, IntComp> view;
+	CHECK(view.attach(snapshot));
+
+	BloomFilter<int> bloom(1000);
+	Tree<int, IntComp> tree;
+	CHECK(tree.attachFilter(&bloom));
+	view.restore(tree);
+	CHECK(tree._filter == &bloom);
+	for(int i = 0; i < 1000; i++) {
+		int value = i * 7;
+		CHECK(tree.find(value) != NULL);
+	}
+
+	// a filter that can't take the restored values is detached
+	std::vector<int> others(1, -1);
+	XorFilter<int> fixed(others);
+	Tree<int, IntComp> fixedTree;
+	CHECK(fixedTree.attachFilter(&fixed));
+	view.restore(fixedTree);
+	CHECK(fixedTree._filter == NULL);
+	for(int i = 0; i < 1000; i++) {
+		int value = i * 7;
+		CHECK(fixedTree.find(value) != NULL);
+	}
+	std::remove(path.c_str());
+}
+
+int main() {
+	testRestoreFillsAttachedFilter();
+	std::printf("tree_snapshot_test: ok\n");
+	return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * Regression tests of Tree.
+ *
+ * Build and run from the repository root:
+ *
+ *   g++ -std=c++17 -O2 -I. tests/tree_test.cpp -o tree_test && ./tree_test
+ */
+#include <cstdio>
+#include "tree.h"
+#include "test.h"
+
+struct IntComp {
+	int operator()(int a, int b) const {
+		return a < b ? -1 : (a > b ? 1 : 0);
+	}
+};
+
+/**
+ * Tree(Node<T>*) adopts a root made with new, which used to be given back
+ * to the default memory resource instead of deleted.
+ */
+void testAdoptedRootIsDeleted() {
+	int value = 50;
+	{
+		Tree<int, IntComp> tree(new Node<int>(value, NULL));
+		for(int i = 0; i < 100; i++) {
+			tree.insert(i);
+		}
+		CHECK(tree.min() == 0);
+		CHECK(tree.max() == 99);
+	}
+	{
+		Tree<int, IntComp> tree(new Node<int>(value, NULL));
+		tree.remove(value);
+		CHECK(tree._root == NULL);
+		for(int i = 0; i < 10; i++) {
+			tree.insert(i);
+		}
+	}
+	{
+		Tree<int, IntComp> tree(new Node<int>(value, NULL));
+		for(int i = 0; i < 100; i++) {
+			if(i != value) tree.insert(i);
+		}
+		for(int i = 0; i < 100; i++) {
+			CHECK(tree.min() == i);
+			tree.popMin();
+		}
+		CHECK(tree._root == NULL);
+	}
+}
+
+int main() {
+	testAdoptedRootIsDeleted();
+	std::printf("tree_test: ok\n");
+	return 0;
+}
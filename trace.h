@@ -0,0 +1,269 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include "MtmMap.h"
+
+/**
+ * Recording of the operations done on a container into a binary trace, to
+ * replay real traffic against other backends (see benchmark/replay.cpp).
+ *
+ * A trace file is a TraceHeader followed by one record per operation: the
+ * operation's byte, the raw bytes of the key, and for TRACE_INSERT the raw
+ * bytes of the value. Keys and values must be trivially copyable.
+ *
+ * TracedMap wraps an existing map (MtmMap, or any map with the same API) and
+ * records each call before forwarding it; hash_table_trace.h does the same
+ * for HashTable.
+ * @code
+ * mtm::MtmMap<int, int> scores(0);
+ * TracedMap<int, int> traced(scores, "scores.trace");
+ * traced.insert(1, 100);
+ * @endcode
+ */
+
+const uint32_t TRACE_VERSION = 1;
+
+enum TraceOperation {
+	TRACE_INSERT = 1,
+	TRACE_FIND = 2,
+	TRACE_REMOVE = 3,
+	TRACE_ITERATE = 4
+};
+
+/** The container a trace was recorded from */
+enum TraceKind {
+	TRACE_MAP = 1,
+	TRACE_HASH_TABLE = 2
+};
+
+struct TraceHeader {
+	char _magic[8];
+	uint32_t _version;
+	uint32_t _kind;
+	uint32_t _keySize;
+	uint32_t _valueSize;
+};
+
+const char TRACE_MAGIC[] = "GDSTRACE";
+
+/**
+ * Appends records to a trace file, through a large stdio buffer.
+ */
+class TraceWriter {
+	FILE* _file;
+	uint32_t _keySize;
+	uint32_t _valueSize;
+	static const size_t BUFFER_BYTES = 1 << 20;
+public:
+	/**
+	 * Creates (or truncates) the trace at path. If it can't be written,
+	 * isOpen() is false and the records are dropped.
+	 */
+	TraceWriter(const char* path, TraceKind kind, uint32_t keySize,
+			uint32_t valueSize) : _keySize(keySize), _valueSize(valueSize) {
+		_file = std::fopen(path, "wb");
+		if(!_file) {
+			return;
+		}
+		std::setvbuf(_file, NULL, _IOFBF, BUFFER_BYTES);
+		TraceHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header._magic, TRACE_MAGIC, sizeof(header._magic));
+		header._version = TRACE_VERSION;
+		header._kind = kind;
+		header._keySize = keySize;
+		header._valueSize = valueSize;
+		if(std::fwrite(&header, sizeof(header), 1, _file) != 1) {
+			close();
+		}
+	}
+	TraceWriter(const TraceWriter& writer) = delete;
+	TraceWriter& operator=(const TraceWriter& writer) = delete;
+	~TraceWriter() {
+		close();
+	}
+	bool isOpen() const {
+		return _file != NULL;
+	}
+	/**
+	 * Records an operation. value is only written for TRACE_INSERT.
+	 */
+	void record(TraceOperation operation, const void* key, const void* value = NULL) {
+		if(!_file) {
+			return;
+		}
+		unsigned char code = (unsigned char)operation;
+		std::fwrite(&code, 1, 1, _file);
+		std::fwrite(key, _keySize, 1, _file);
+		if(operation == TRACE_INSERT && _valueSize > 0) {
+			std::fwrite(value, _valueSize, 1, _file);
+		}
+	}
+	/**
+	 * Writes the buffered records to the file.
+	 */
+	void flush() {
+		if(_file) {
+			std::fflush(_file);
+		}
+	}
+	void close() {
+		if(_file) {
+			std::fclose(_file);
+			_file = NULL;
+		}
+	}
+};
+
+/**
+ * Reads the records of a trace file one by one.
+ */
+class TraceReader {
+	FILE* _file;
+	TraceHeader _header;
+public:
+	TraceReader() : _file(NULL) {
+		std::memset(&_header, 0, sizeof(_header));
+	}
+	TraceReader(const TraceReader& reader) = delete;
+	TraceReader& operator=(const TraceReader& reader) = delete;
+	~TraceReader() {
+		if(_file) {
+			std::fclose(_file);
+		}
+	}
+	/**
+	 * Opens the trace at path. Returns false if it can't be read or is not a
+	 * trace of this version.
+	 */
+	bool open(const char* path) {
+		_file = std::fopen(path, "rb");
+		if(!_file) {
+			return false;
+		}
+		if(std::fread(&_header, sizeof(_header), 1, _file) != 1
+				|| std::memcmp(_header._magic, TRACE_MAGIC, sizeof(_header._magic)) != 0
+				|| _header._version != TRACE_VERSION) {
+			std::fclose(_file);
+			_file = NULL;
+			return false;
+		}
+		return true;
+	}
+	const TraceHeader& header() const {
+		return _header;
+	}
+	/**
+	 * Reads the next record, key and value must hold the key and value sizes
+	 * of the header. Returns false at the end of the trace, or on a truncated
+	 * record.
+	 */
+	bool next(TraceOperation* operation, void* key, void* value) {
+		unsigned char code;
+		if(!_file || std::fread(&code, 1, 1, _file) != 1
+				|| code < TRACE_INSERT || code > TRACE_ITERATE
+				|| std::fread(key, _header._keySize, 1, _file) != 1) {
+			return false;
+		}
+		*operation = (TraceOperation)code;
+		if(code == TRACE_INSERT && _header._valueSize > 0
+				&& std::fread(value, _header._valueSize, 1, _file) != 1) {
+			return false;
+		}
+		return true;
+	}
+};
+
+#define tracedMapTemplate <KeyType, ValueType, Map>
+
+/**
+ * Records the insert, find, containsKey, remove, operator[] and begin calls
+ * made on a map, then forwards them to it. The map keeps working as usual, and can be
+ * used directly for the calls that shouldn't be recorded.
+ */
+template<class KeyType, class ValueType, class Map = mtm::MtmMap<KeyType, ValueType> >
+class TracedMap {
+	static_assert(std::is_trivially_copyable<KeyType>::value
+			&& std::is_trivially_copyable<ValueType>::value,
+			"only trivially copyable keys and values can be traced");
+	Map& _map;
+	mutable TraceWriter _writer;
+public:
+	typedef typename Map::iterator iterator;
+	TracedMap(Map& map, const char* path)
+	: _map(map), _writer(path, TRACE_MAP, sizeof(KeyType), sizeof(ValueType)) {}
+	/**
+	 * Returns false if the trace couldn't be created.
+	 */
+	bool isTracing() const {
+		return _writer.isOpen();
+	}
+	Map& map() const {
+		return _map;
+	}
+	void insert(const KeyType& key, const ValueType& value) {
+		_writer.record(TRACE_INSERT, &key, &value);
+		_map.insert(key, value);
+	}
+	void remove(const KeyType& key) {
+		_writer.record(TRACE_REMOVE, &key);
+		_map.remove(key);
+	}
+	iterator find(const KeyType& key) const {
+		_writer.record(TRACE_FIND, &key);
+		return _map.find(key);
+	}
+	bool containsKey(const KeyType& key) const {
+		_writer.record(TRACE_FIND, &key);
+		return _map.containsKey(key);
+	}
+	/**
+	 * Recorded as a find, followed by the insert of the default value when
+	 * the key was absent (the map inserts it).
+	 */
+	ValueType& operator[](const KeyType& key);
+	/**
+	 * Recorded as a find, returns a copy of the value.
+	 */
+	ValueType operator[](const KeyType& key) const {
+		_writer.record(TRACE_FIND, &key);
+		return static_cast<const Map&>(_map)[key];
+	}
+	/**
+	 * Recorded as an iteration over the whole map, with a zeroed key.
+	 */
+	iterator begin() const;
+	iterator end() const {
+		return _map.end();
+	}
+	unsigned int size() const {
+		return _map.size();
+	}
+	void flush() {
+		_writer.flush();
+	}
+};
+
+template<class KeyType, class ValueType, class Map>
+ValueType& TracedMap tracedMapTemplate::operator[](const KeyType& key) {
+	_writer.record(TRACE_FIND, &key);
+	bool present = _map.containsKey(key);
+	ValueType& value = _map[key];
+	if(!present) {
+		_writer.record(TRACE_INSERT, &key, &value);
+	}
+	return value;
+}
+
+template<class KeyType, class ValueType, class Map>
+typename TracedMap tracedMapTemplate::iterator TracedMap tracedMapTemplate::begin() const {
+	unsigned char key[sizeof(KeyType)] = { 0 };
+	_writer.record(TRACE_ITERATE, key);
+	return _map.begin();
+}
+
+#endif /* TRACE_H_ */
@@ -2,6 +2,11 @@
 #define tree_h
 
 #include <iostream>
+#include <cstdint>
+#include <utility>
+#include "key_filter.h"
+#include "node_allocation.h"
+#include "stats.h"
 
 template <class T>
 class Node {
@@ -24,6 +29,26 @@ _left_son(NULL), _right_son(NULL) {}
 template <class T>
 Node<T>::Node(Node<T>* father): _value(), _height(1), _father(father), _left_son(NULL), _right_son(NULL) {}
 
+#ifdef GENERICDS_STATS
+/**
+ * A snapshot of the counters of a Tree (see stats.h). The average depth of
+ * a search is findSteps / finds, the nodes visited by a search including
+ * the one it stops at.
+ */
+struct TreeStats {
+	uint64_t _comparisons;
+	uint64_t _finds;
+	uint64_t _findSteps;
+	uint64_t _inserts;
+	uint64_t _insertSteps;
+	uint64_t _leftRotations;
+	uint64_t _rightRotations;
+	// memory held by the tree and its nodes, not counting what T allocates
+	uint64_t _nodes;
+	uint64_t _bytes;
+};
+#endif
+
 template <class T, class Comp>
 class Tree {
 
@@ -32,13 +57,43 @@ public:
     Node<T> * _root;
     int _node_number;
     Comp _compare;
-
-    Tree();
+    // nodes are allocated from, and given back to, this resource
+    std::pmr::memory_resource* _resource;
+    // consulted by find(T&) before the descent, NULL if none is attached
+    KeyFilter<T>* _filter;
+    // the nodes of the smallest and largest values, NULL if the tree is empty.
+    // a rotation leaves every node at its place in the order, so only insert
+    // and remove move them
+    Node<T> * _min;
+    Node<T> * _max;
+    // the root given to Tree(Node<T>*), which is freed with delete rather
+    // than through _resource. NULL once it is freed, or if there is none
+    Node<T> * _adopted;
+
+    Tree(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // adopts root, which must be allocated with new (its sons, if any,
+    // from the default resource, e.g. with allocateNode)
     Tree(Node<T> * root);
     ~Tree();
     void clean();
 
     Node<T> * find(T& value);
+    // the first node whose value is not smaller than value, NULL if none
+    Node<T> * lower_bound(const T& value);
+    // versions of find, lower_bound and remove taking any key that Comp can
+    // compare with T (as Comp(key, value)), when Comp declares is_transparent,
+    // e.g. a tree of records searched by their ID without building a record
+    template <class K, class C = Comp, class = typename C::is_transparent>
+    Node<T> * find(const K& key);
+    template <class K, class C = Comp, class = typename C::is_transparent>
+    Node<T> * lower_bound(const K& key);
+    template <class K, class C = Comp, class = typename C::is_transparent>
+    void remove(const K& key);
+
+    // makes find(T&) consult filter first, after adding the tree's values to
+    // it, NULL detaches the current filter (which the tree doesn't own).
+    // returns false, and attaches nothing, if the filter can't take them
+    bool attachFilter(KeyFilter<T>* filter);
 
     int getNodeNumber();
     int getHeight();
@@ -46,13 +101,53 @@ public:
     void insert(T& value);
     void remove(T& value);
 
+    // the smallest and largest values in O(1), for a tree used as a priority
+    // queue. the tree must not be empty, and a value changed through them
+    // must keep its place in the order
+    T& min();
+    T& max();
+    // remove the smallest or largest value without searching for it: its
+    // node is unlinked at once, and the rebalancing stops at the first
+    // ancestor whose height doesn't change. do nothing if the tree is empty
+    void popMin();
+    void popMax();
+    // finds _min and _max again, after _root was set directly
+    void resetExtremes();
+
+#ifdef GENERICDS_STATS
+    TreeStats getStats() const {
+        TreeStats stats = _stats;
+        stats._nodes = _node_number;
+        stats._bytes = sizeof(*this) + _node_number * sizeof(Node<T>);
+        return stats;
+    }
+    void resetStats() {
+        _stats = TreeStats();
+    }
+#endif
+
 private:
 
+#ifdef GENERICDS_STATS
+    TreeStats _stats = TreeStats();
+#endif
+    // every comparison of the tree goes through here to be counted
+    template <class A, class B>
+    int compareValues(A&& a, B&& b) {
+        GENERICDS_STAT(_stats._comparisons++);
+        return _compare(std::forward<A>(a), std::forward<B>(b));
+    }
+
     void insertAux(T& value, Node<T>* node);
     void removeAux(T& value, Node<T>* node);
     void cleanAux(Node<T>* node);
+    void unlinkNode(Node<T>* node);
+    void freeNode(Node<T>* node);
+    static Node<T>* nextNode(Node<T>* node);
+    static Node<T>* previousNode(Node<T>* node);
 
     Node<T>* findAux(T& value, Node<T>* node);
+    bool addToFilterAux(Node<T>* node);
 
     T getMinAux(Node<T>* node);
     int getHeightAux(Node<T>* node) ;
@@ -60,14 +155,13 @@ private:
 	void rightRotation(Node<T>* node);
 	void leftRotation(Node<T>* node);
 	void balanceTree(Node<T>* node);
-	void balanceTreeAux(Node<T>* node);
 
 	int getNodeHeight(Node<T>* node);
-	void updateHeight(Node<T>* node);
 };
 
 template <class T, class Comp>
-Tree<T, Comp>::Tree() {
+Tree<T, Comp>::Tree(std::pmr::memory_resource* resource) : _resource(resource),
+_filter(NULL), _min(NULL), _max(NULL), _adopted(NULL) {
 	_root=NULL;
 	_node_number = 0;
 	Comp compare;
@@ -75,11 +169,13 @@ Tree<T, Comp>::Tree() {
 }
 
 template <class T, class Comp>
-Tree<T, Comp>::Tree(Node<T>* root) : _root(root) {
+Tree<T, Comp>::Tree(Node<T>* root) : _root(root),
+_resource(std::pmr::get_default_resource()), _filter(NULL), _adopted(root) {
 	if(!_root) {
 		_node_number = 0;
 	}
 	else _node_number = 1;
+	resetExtremes();
 	Comp compare;
 	_compare = compare;
 }
@@ -94,27 +190,33 @@ void Tree<T, Comp>::cleanAux(Node<T> * p) {
 	if(!p) return;
 	cleanAux(p->_left_son);
 	cleanAux(p->_right_son);
-	delete p;
+	freeNode(p);
 	return;
 }
 
 template <class T, class Comp>
 void Tree<T, Comp>::clean() {
-	cleanAux(_root);
+	// an arena reclaims all the nodes at once, there is nothing to visit
+	if(_adopted || !releasedWithResource<Node<T> >(_resource)) {
+		cleanAux(_root);
+	}
 	_node_number = 0;
 	_root = NULL;
+	_min = NULL;
+	_max = NULL;
 	return;
 }
 
 template <class T, class Comp>
 Node<T> * Tree<T, Comp>::findAux(  T& _value, Node<T> * p){
     if(!p) return NULL;
-    if (_compare(_value,p->_value) == 0) return p;
+    GENERICDS_STAT(_stats._findSteps++);
+    if (compareValues(_value,p->_value) == 0) return p;
 
-    if(_compare(_value,p->_value) > 0) {
+    if(compareValues(_value,p->_value) > 0) {
         return findAux(_value, p->_right_son);
     }
-    if(_compare(_value,p->_value) < 0){
+    if(compareValues(_value,p->_value) < 0){
         return findAux(_value, p->_left_son);
     }
     return NULL;
@@ -122,23 +224,100 @@ Node<T> * Tree<T, Comp>::findAux(  T& _value, Node<T> * p){
 
 template <class T, class Comp>
 Node<T> * Tree<T, Comp>::find(T& value) {
+    GENERICDS_STAT(_stats._finds++);
+    if(_filter && !_filter->mayContain(value)) return NULL;
     return findAux(value, _root);
 }
 
+template <class T, class Comp>
+bool Tree<T, Comp>::addToFilterAux(Node<T>* node) {
+    if(!node) return true;
+    return _filter->add(node->_value) && addToFilterAux(node->_left_son)
+            && addToFilterAux(node->_right_son);
+}
+
+template <class T, class Comp>
+bool Tree<T, Comp>::attachFilter(KeyFilter<T>* filter) {
+    _filter = filter;
+    if(_filter && !addToFilterAux(_root)) {
+        _filter = NULL;
+        return false;
+    }
+    return true;
+}
+
+template <class T, class Comp>
+Node<T> * Tree<T, Comp>::lower_bound(const T& value) {
+    Node<T> * candidate = NULL;
+    Node<T> * p = _root;
+    while(p) {
+        if(compareValues(value, p->_value) <= 0) {
+            candidate = p;
+            p = p->_left_son;
+        } else {
+            p = p->_right_son;
+        }
+    }
+    return candidate;
+}
+
+template <class T, class Comp>
+template <class K, class C, class>
+Node<T> * Tree<T, Comp>::find(const K& key) {
+    GENERICDS_STAT(_stats._finds++);
+    Node<T> * p = _root;
+    while(p) {
+        GENERICDS_STAT(_stats._findSteps++);
+        int result = compareValues(key, p->_value);
+        if(result == 0) return p;
+        p = (result > 0) ? p->_right_son : p->_left_son;
+    }
+    return NULL;
+}
+
+template <class T, class Comp>
+template <class K, class C, class>
+Node<T> * Tree<T, Comp>::lower_bound(const K& key) {
+    Node<T> * candidate = NULL;
+    Node<T> * p = _root;
+    while(p) {
+        if(compareValues(key, p->_value) <= 0) {
+            candidate = p;
+            p = p->_left_son;
+        } else {
+            p = p->_right_son;
+        }
+    }
+    return candidate;
+}
+
+template <class T, class Comp>
+template <class K, class C, class>
+void Tree<T, Comp>::remove(const K& key) {
+    Node<T> * p = find(key);
+    if(!p) return;
+    // the removal overwrites and frees nodes, it must not compare against one
+    T value = p->_value;
+    remove(value);
+}
+
 template <class T, class Comp>
 void Tree<T, Comp>::insertAux(T& value, Node<T>* node) {
-    if(_compare(value,node->_value) > 0) {
+    GENERICDS_STAT(_stats._insertSteps++);
+    if(compareValues(value,node->_value) > 0) {
         if(!node->_right_son) {
-            node->_right_son = new Node<T>(value, node);
+            node->_right_son = allocateNode<Node<T> >(_resource, value, node);
+            if(node == _max) _max = node->_right_son;
             _node_number++;
             balanceTree(node);
             return;
         }
         insertAux(value, node->_right_son);
     }
-    if(_compare(value, node->_value) < 0){
+    if(compareValues(value, node->_value) < 0){
         if(!node->_left_son) {
-            node->_left_son = new Node<T>(value, node);
+            node->_left_son = allocateNode<Node<T> >(_resource, value, node);
+            if(node == _min) _min = node->_left_son;
             _node_number++;
             balanceTree(node);
             return;
@@ -151,8 +330,13 @@ void Tree<T, Comp>::insertAux(T& value, Node<T>* node) {
 
 template <class T, class Comp>
 void Tree<T, Comp>::insert(T& value) {
+    GENERICDS_STAT(_stats._inserts++);
+    // a filter that can't take the value would hide it from find
+    if(_filter && !_filter->add(value)) _filter = NULL;
     if(!_root) {
-        _root=new Node<T>(value, NULL);
+        _root=allocateNode<Node<T> >(_resource, value, (Node<T>*)NULL);
+        _min = _root;
+        _max = _root;
         _node_number++;
         return;
     }
@@ -165,7 +349,9 @@ void Tree<T, Comp>::remove(T& _value) {
 	if(_node_number == 1) {
 		Node<T> * tmp= _root;
 		_root= NULL;
-		delete tmp;
+		_min = NULL;
+		_max = NULL;
+		freeNode(tmp);
 		_node_number = 0;
 		return;
 	}
@@ -176,43 +362,16 @@ void Tree<T, Comp>::remove(T& _value) {
 template <class T, class Comp>
 void Tree<T, Comp>::removeAux(  T& _value, Node<T> * node) {
 	if(!node) return;
-	if(_compare(_value, node->_value) > 0) {
+	if(compareValues(_value, node->_value) > 0) {
 		removeAux(_value, node->_right_son);
 	}
-	if(_compare(_value, node->_value) < 0) {
+	if(compareValues(_value, node->_value) < 0) {
 		removeAux(_value, node->_left_son);
 	}
 
-	if(_compare(_value, node->_value) == 0) {
-		if(!node->_left_son && !node->_right_son) {
-			Node<T> * father = node->_father;
-			(father->_left_son == node)? father->_left_son = NULL : father->_right_son = NULL;
-			delete node;
-			_node_number--;
-			balanceTree(father);
-			return;
-		}
+	if(compareValues(_value, node->_value) == 0) {
 		if(!node->_left_son || !node->_right_son) {
-
-			Node<T> * father = node->_father;
-			if(!father) {
-				_root = (node->_right_son)? node->_right_son : node->_left_son;
-				_root->_father = NULL;
-				delete node;
-				_node_number--;
-				return;
-			}
-			if(father->_left_son == node) {
-				(node->_right_son)? father->_left_son = node->_right_son : father->_left_son = node->_left_son;
-				(node->_right_son)? node->_right_son->_father = father : node->_left_son->_father = father;
-			}
-			if(father->_right_son == node) {
-				(node->_right_son)? father->_right_son = node->_right_son : father->_right_son = node->_left_son;
-				(node->_right_son)? node->_right_son->_father = father : node->_left_son->_father = father;
-			}
-			delete node;
-			_node_number--;
-			balanceTree(father);
+			unlinkNode(node);
 			return;
 		}
 		if(node->_left_son && node->_right_son) {
@@ -222,6 +381,83 @@ void Tree<T, Comp>::removeAux(  T& _value, Node<T> * node) {
 	}
 }
 
+// takes node, which has at most one son, out of the tree and frees it
+template <class T, class Comp>
+void Tree<T, Comp>::unlinkNode(Node<T>* node) {
+	if(node == _min) _min = nextNode(node);
+	if(node == _max) _max = previousNode(node);
+	Node<T> * son = (node->_left_son)? node->_left_son : node->_right_son;
+	Node<T> * father = node->_father;
+	if(son) son->_father = father;
+	if(!father) _root = son;
+	else if(father->_left_son == node) father->_left_son = son;
+	else father->_right_son = son;
+	freeNode(node);
+	_node_number--;
+	balanceTree(father);
+}
+
+template <class T, class Comp>
+void Tree<T, Comp>::freeNode(Node<T>* node) {
+	if(node == _adopted) {
+		_adopted = NULL;
+		delete node;
+		return;
+	}
+	deallocateNode(_resource, node);
+}
+
+template <class T, class Comp>
+Node<T>* Tree<T, Comp>::nextNode(Node<T>* node) {
+	if(node->_right_son) {
+		node = node->_right_son;
+		while(node->_left_son) node = node->_left_son;
+		return node;
+	}
+	while(node->_father && node->_father->_right_son == node) node = node->_father;
+	return node->_father;
+}
+
+template <class T, class Comp>
+Node<T>* Tree<T, Comp>::previousNode(Node<T>* node) {
+	if(node->_left_son) {
+		node = node->_left_son;
+		while(node->_right_son) node = node->_right_son;
+		return node;
+	}
+	while(node->_father && node->_father->_left_son == node) node = node->_father;
+	return node->_father;
+}
+
+template <class T, class Comp>
+T& Tree<T, Comp>::min() {
+	return _min->_value;
+}
+
+template <class T, class Comp>
+T& Tree<T, Comp>::max() {
+	return _max->_value;
+}
+
+template <class T, class Comp>
+void Tree<T, Comp>::popMin() {
+	if(_min) unlinkNode(_min);
+}
+
+template <class T, class Comp>
+void Tree<T, Comp>::popMax() {
+	if(_max) unlinkNode(_max);
+}
+
+template <class T, class Comp>
+void Tree<T, Comp>::resetExtremes() {
+	_min = _root;
+	_max = _root;
+	if(!_root) return;
+	while(_min->_left_son) _min = _min->_left_son;
+	while(_max->_right_son) _max = _max->_right_son;
+}
+
 template <class T, class Comp>
 int Tree<T, Comp>::getNodeNumber()   {
     return _node_number;
@@ -253,6 +489,7 @@ int Tree<T, Comp>::getHeightAux(Node<T> * node) {
 template <class T, class Comp>
 void Tree<T, Comp>::leftRotation(Node<T> * node) {
 	if(!node) return;
+	GENERICDS_STAT(_stats._leftRotations++);
 	Node<T> * a = node;
 	Node<T> * b = node->_right_son;
 
@@ -270,13 +507,13 @@ void Tree<T, Comp>::leftRotation(Node<T> * node) {
 	if(a == _root) _root = b;
 	a->_height = getNodeHeight(a);
 	b->_height = getNodeHeight(b);
-	updateHeight(node);
 	return;
 }
 
 template <class T, class Comp>
 void Tree<T, Comp>::rightRotation(Node<T>* node) {
 	if(!node) return;
+	GENERICDS_STAT(_stats._rightRotations++);
 	Node<T> * b = node;
 	Node<T> * a = node->_left_son;
 
@@ -294,50 +531,46 @@ void Tree<T, Comp>::rightRotation(Node<T>* node) {
 	if(b == _root) _root = a;
 	b->_height = getNodeHeight(b);
 	a->_height = getNodeHeight(a);
-	updateHeight(node);
 	return;
 }
 
+// walks up from node, the lowest node whose subtree changed, fixing heights
+// and rotating where a subtree became unbalanced, and stops at the first
+// subtree whose height is the same as before: nothing above it changed
 template <class T, class Comp>
 void Tree<T, Comp>::balanceTree(Node<T> * node){
-	updateHeight(node);
-	balanceTreeAux(node);
-}
+	while(node) {
+		int old_height = node->_height;
+		node->_height = getNodeHeight(node);
 
-template <class T, class Comp>
-void Tree<T, Comp>::balanceTreeAux(Node<T>* node) {
-	if(!node) return;
-
-	int root_balance = getNodeHeight(node->_left_son) - getNodeHeight(node->_right_son);
+		int root_balance = getNodeHeight(node->_left_son) - getNodeHeight(node->_right_son);
 
-	if(root_balance == 2) {
+		if(root_balance == 2) {
 
-		int left_son_balance = getNodeHeight(node->_left_son->_left_son) - getNodeHeight(node->_left_son->_right_son);
+			int left_son_balance = getNodeHeight(node->_left_son->_left_son) - getNodeHeight(node->_left_son->_right_son);
 
-		if(left_son_balance >= 0) {
-			rightRotation(node);
-		}
-
-		if(left_son_balance == -1) {
-			leftRotation(node->_left_son);
+			if(left_son_balance == -1) {
+				leftRotation(node->_left_son);
+			}
 			rightRotation(node);
+			// the subtree is now rooted at node's father
+			node = node->_father;
 		}
-	}
 
-	if(root_balance == -2) {
+		if(root_balance == -2) {
 
-		int right_son_balance = getNodeHeight(node->_right_son->_left_son) - getNodeHeight(node->_right_son->_right_son);
+			int right_son_balance = getNodeHeight(node->_right_son->_left_son) - getNodeHeight(node->_right_son->_right_son);
 
-		if(right_son_balance <= 0){
+			if(right_son_balance == 1) {
+				rightRotation(node->_right_son);
+			}
 			leftRotation(node);
+			node = node->_father;
 		}
 
-		if(right_son_balance == 1) {
-			rightRotation(node->_right_son);
-			leftRotation(node);
-		}
+		if(node->_height == old_height) return;
+		node = node->_father;
 	}
-	balanceTree(node->_father);
 }
 
 template <class T, class Comp>
@@ -351,11 +584,4 @@ int Tree<T, Comp>::getNodeHeight(Node<T>* node) {
 	return max + 1;
 }
 
-template <class T, class Comp>
-void Tree<T, Comp>::updateHeight(Node<T>* node) {
-	if(!node) return;
-	node->_height = getNodeHeight(node) ;
-	updateHeight(node->_father);
-}
-
 #endif /* tree_h */
@@ -1,14 +1,35 @@
 #ifndef UNION_FIND_H_
 #define UNION_FIND_H_
 
+#include <cstdint>
 #include "team.h"
 #include "group.h"
+#include "stats.h"
+
+#ifdef GENERICDS_STATS
+/**
+ * A snapshot of the counters of a UnionFind (see stats.h). The average path
+ * length of a Find is findSteps / finds, the edges walked up to the root.
+ */
+struct UnionFindStats {
+	uint64_t _finds;
+	uint64_t _findSteps;
+	uint64_t _longestFind;
+	uint64_t _unions;
+	// the teams, their groups that are still allocated and both arrays
+	uint64_t _groups;
+	uint64_t _bytes;
+};
+#endif
 
 class UnionFind {
 public:
 	Team** _teams;
 	Group** _groups;
 	int _size;
+#ifdef GENERICDS_STATS
+	UnionFindStats _stats = UnionFindStats();
+#endif
 
 	UnionFind(int n) : _size(n) {
 		_teams = new Team*[_size];
@@ -21,9 +42,16 @@ public:
 
 	Group* Find(int team) {
 		Team* node = _teams[team];
+		GENERICDS_STAT(_stats._finds++);
+#ifdef GENERICDS_STATS
+		uint64_t steps = 0;
+#endif
 		while(node->_father) {
 			node = node->_father;
+			GENERICDS_STAT(steps++);
 		}
+		GENERICDS_STAT(_stats._findSteps += steps;
+				if(steps > _stats._longestFind) _stats._longestFind = steps);
 		Team* root = node;
 		int index = node->_number;
 
@@ -38,6 +66,7 @@ public:
 	}
 
 	int Union(int team1, int team2) {
+		GENERICDS_STAT(_stats._unions++);
 
 		Team* root1 = _teams[team1];
 		while(root1->_father) {
@@ -75,6 +104,24 @@ public:
 		return group_name;
 	}
 
+#ifdef GENERICDS_STATS
+	UnionFindStats getStats() const {
+		UnionFindStats stats = _stats;
+		stats._groups = 0;
+		for(int i = 0 ; i < _size ; i++) {
+			if(_groups[i]) {
+				stats._groups++;
+			}
+		}
+		stats._bytes = sizeof(*this) + _size * (sizeof(Team) + sizeof(Team*)
+				+ sizeof(Group*)) + stats._groups * sizeof(Group);
+		return stats;
+	}
+	void resetStats() {
+		_stats = UnionFindStats();
+	}
+#endif
+
 	~UnionFind() {
 		for(int i = 0 ; i < _size ; i++) {
 			delete _teams[i];
@@ -0,0 +1,171 @@
+#ifndef UNROLLED_LIST_H_
+#define UNROLLED_LIST_H_
+
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#define unrolledListTemplate <DataType, ChunkBytes>
+
+/**
+ * An unrolled variant of List: elements are stored contiguously in fixed-size
+ * chunks (ChunkBytes bytes of element storage each, e.g. 64 to 4096) that are
+ * linked together, so a scan touches one allocation per chunk instead of one
+ * per element.
+ * Exposes the same iterator interface as List, with O(1) amortised append
+ * and erase that only shifts elements inside the erased element's chunk.
+ */
+template<class DataType, unsigned int ChunkBytes = 512>
+class UnrolledList {
+	class Chunk;
+	Chunk* _head;
+	Chunk* _tail;
+	unsigned int _size;
+public:
+	class iterator;
+	UnrolledList();
+	UnrolledList(const UnrolledList& list) = delete;
+	UnrolledList& operator=(const UnrolledList& list) = delete;
+	~UnrolledList();
+	/**
+	 * Appends a copy of data to the end of the list.
+	 */
+	void insert(DataType data);
+	/**
+	 * Removes the element pointed by position, and returns an iterator to the
+	 * element that followed it. A chunk left empty is de-allocated.
+	 */
+	iterator erase(iterator position);
+	/**
+	 * Returns the amount of elements in the list.
+	 */
+	unsigned int size() const {
+		return _size;
+	}
+
+	iterator begin() const {
+		return iterator(this, _head, 0);
+	}
+
+	iterator end() const {
+		return iterator(this, NULL, 0);
+	}
+};
+
+template<class DataType, unsigned int ChunkBytes>
+class UnrolledList unrolledListTemplate::Chunk {
+public:
+	static const unsigned int CAPACITY = (ChunkBytes / sizeof(DataType)) > 0 ?
+			(ChunkBytes / sizeof(DataType)) : 1;
+private:
+	alignas(DataType) unsigned char _storage[CAPACITY * sizeof(DataType)];
+	unsigned int _count;
+	Chunk* _next;
+	Chunk* _prev;
+	friend class UnrolledList;
+public:
+	Chunk(Chunk* prev = NULL) : _count(0), _next(NULL), _prev(prev) {}
+	~Chunk() {
+		for(unsigned int i = 0; i < _count; i++) {
+			at(i).~DataType();
+		}
+	}
+	DataType& at(unsigned int index) {
+		return reinterpret_cast<DataType*>(_storage)[index];
+	}
+};
+
+template<class DataType, unsigned int ChunkBytes>
+UnrolledList unrolledListTemplate::UnrolledList()
+: _head(NULL), _tail(NULL), _size(0) {}
+
+template<class DataType, unsigned int ChunkBytes>
+void UnrolledList unrolledListTemplate::insert(DataType data) {
+	if(!_tail || _tail->_count == Chunk::CAPACITY) {
+		Chunk* chunk = new Chunk(_tail);
+		if(_tail) {
+			_tail->_next = chunk;
+		} else {
+			_head = chunk;
+		}
+		_tail = chunk;
+	}
+	new (&_tail->at(_tail->_count)) DataType(std::move(data));
+	_tail->_count++;
+	_size++;
+}
+
+template<class DataType, unsigned int ChunkBytes>
+typename UnrolledList unrolledListTemplate::iterator UnrolledList<DataType,
+ChunkBytes>::erase(iterator position) {
+	Chunk* chunk = position._current;
+	if(position._list != this || !chunk) {
+		return end();
+	}
+	unsigned int index = position._index;
+	// the following elements are moved down, not copied
+	for(unsigned int i = index; i + 1 < chunk->_count; i++) {
+		chunk->at(i) = std::move(chunk->at(i + 1));
+	}
+	chunk->at(chunk->_count - 1).~DataType();
+	chunk->_count--;
+	_size--;
+
+	if(chunk->_count > 0) {
+		if(index < chunk->_count) {
+			return iterator(this, chunk, index);
+		}
+		return iterator(this, chunk->_next, 0);
+	}
+	//edge case: the chunk is left empty, unlink it from the list
+	Chunk* next = chunk->_next;
+	(chunk->_prev)? chunk->_prev->_next = next : _head = next;
+	(next)? next->_prev = chunk->_prev : _tail = chunk->_prev;
+	delete chunk;
+	return iterator(this, next, 0);
+}
+
+template<class DataType, unsigned int ChunkBytes>
+UnrolledList unrolledListTemplate::~UnrolledList() {
+	while(_head) {
+		Chunk* temp = _head->_next;
+		delete _head;
+		_head = temp;
+	}
+}
+
+template<class DataType, unsigned int ChunkBytes>
+class UnrolledList unrolledListTemplate::iterator {
+	const UnrolledList* _list;
+	Chunk* _current;
+	unsigned int _index;
+	friend class UnrolledList;
+public:
+	explicit iterator(const UnrolledList* list = NULL, Chunk* current = NULL,
+			unsigned int index = 0) : _list(list), _current(current), _index(index) { }
+	iterator(const iterator& it) : _list(it._list), _current(it._current), _index(it._index) { }
+	iterator& operator=(const iterator& it) = default;
+	bool operator==(const iterator& iterator) const {
+		return (_list == iterator._list && _current == iterator._current
+				&& _index == iterator._index);
+	}
+	bool operator!=(const iterator& iterator) const {
+		return !(*this == iterator);
+	}
+	iterator& operator++() {
+		if(!_current) {
+			return *this;
+		}
+		if(++_index == _current->_count) {
+			_current = _current->_next;
+			_index = 0;
+		}
+		return *this;
+	}
+	DataType& operator*() const {
+		return _current->at(_index);
+	}
+};
+
+
+#endif /* UNROLLED_LIST_H_ */